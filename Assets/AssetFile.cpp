@@ -0,0 +1,29 @@
+#include "AssetFile.h"
+
+namespace Assets
+{
+	// The spans stay valid across moves: the mapping and the vector's heap buffer don't move with the object
+
+	AssetFile::AssetFile(MappedFile file) : _file(std::move(file)), _bytes(_file.getBytes())
+	{
+	}
+
+	AssetFile::AssetFile(std::shared_ptr<const PackArchive> archive, const std::span<const std::byte> bytes)
+		: _archive(std::move(archive)), _bytes(bytes)
+	{
+	}
+
+	AssetFile::AssetFile(std::vector<std::byte> bytes) : _ownedBytes(std::move(bytes)), _bytes(_ownedBytes)
+	{
+	}
+
+	std::span<const std::byte> AssetFile::getBytes() const
+	{
+		return _bytes;
+	}
+
+	size_t AssetFile::getSize() const
+	{
+		return _bytes.size();
+	}
+}
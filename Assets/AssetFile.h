@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PackArchive.h"
+
+namespace Assets
+{
+	/**
+	 * Bytes of an asset wherever they come from: a loose mapped file, an uncompressed pack entry used in place
+	 * (keeps the archive alive) or a decompressed pack entry
+	 */
+	class AssetFile
+	{
+	public:
+		AssetFile() = default;
+
+		explicit AssetFile(MappedFile file);
+
+		AssetFile(std::shared_ptr<const PackArchive> archive, std::span<const std::byte> bytes);
+
+		explicit AssetFile(std::vector<std::byte> bytes);
+
+		AssetFile(AssetFile&&) noexcept = default;
+		AssetFile& operator=(AssetFile&&) noexcept = default;
+
+		AssetFile(const AssetFile&) = delete;
+		AssetFile& operator=(const AssetFile&) = delete;
+
+		[[nodiscard]] std::span<const std::byte> getBytes() const;
+
+		[[nodiscard]] size_t getSize() const;
+
+	private:
+		MappedFile _file;
+		std::shared_ptr<const PackArchive> _archive;
+		std::vector<std::byte> _ownedBytes;
+
+		std::span<const std::byte> _bytes;
+	};
+}
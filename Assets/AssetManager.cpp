@@ -1,48 +1,352 @@
 #include "AssetManager.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+#include <Core/ThreadPool.h>
+
+#include "EmbeddedShaders.h"
 
 namespace Assets
 {
+	namespace
+	{
+		using AssetKey = std::pair<std::type_index, std::string>;
+
+		/**
+		 * Either a live asset (weak, the users own it) or the load producing it
+		 */
+		struct CacheEntry
+		{
+			std::weak_ptr<void> asset;
+			std::shared_future<std::shared_ptr<void>> inFlight;
+		};
+
+		std::mutex cacheMutex;
+		std::map<AssetKey, CacheEntry> cache;
+
+		// Files read by a reload, the pack and the embedded shaders have the version from the last build
+		std::mutex loosePathsMutex;
+		std::set<std::string> loosePaths;
+
+		// Set while a reload runs its reader on this thread
+		thread_local bool isReloading = false;
+
+		/**
+		 * Whether the file on disk has to be read instead of the built-in version (pack or embedded),
+		 * true from the first reload of the file on
+		 */
+		bool isLoosePath(const std::string& path)
+		{
+			std::lock_guard lock(loosePathsMutex);
+			if(isReloading) loosePaths.insert(path);
+			return loosePaths.contains(path);
+		}
+
+		Core::ThreadPool& getLoaderPool()
+		{
+			// Created by the first async load, joined at exit
+			static Core::ThreadPool pool;
+			return pool;
+		}
+
+		/**
+		 * Opened by the first load, nullptr when there is no (valid) pack
+		 */
+		const std::shared_ptr<const PackArchive>& getAssetPack()
+		{
+			static const std::shared_ptr<const PackArchive> pack = []() -> std::shared_ptr<const PackArchive>
+			{
+				if(!std::filesystem::exists(ASSET_PACK_PATH)) return nullptr;
+
+				try
+				{
+					return std::make_shared<const PackArchive>(ASSET_PACK_PATH);
+				}
+				catch(const std::exception& exception)
+				{
+					std::printf("Pack -> %s, using loose files\n", exception.what());
+					return nullptr;
+				}
+			}();
+
+			return pack;
+		}
+
+		void finishLoad(const AssetKey& key, const std::shared_ptr<void>& asset)
+		{
+			std::lock_guard lock(cacheMutex);
+
+			auto& entry = cache[key];
+			entry.inFlight = {};
+			entry.asset = asset;
+		}
+	}
+
+	std::shared_future<std::shared_ptr<void>> AssetManager::request(
+		const std::type_index type, const std::string& filename, const AssetReader reader, const bool isAsync,
+		const bool isReload
+	)
+	{
+		AssetKey key(type, filename);
+
+		std::unique_lock lock(cacheMutex);
+
+		auto& entry = cache[key];
+		if(isReload)
+		{
+			// A load finishing after the reload would put the old file back in the cache
+			while(entry.inFlight.valid())
+			{
+				const auto inFlight = entry.inFlight;
+				lock.unlock();
+				inFlight.wait();
+				lock.lock();
+			}
+		}
+		else
+		{
+			if(auto asset = entry.asset.lock())
+			{
+				std::promise<std::shared_ptr<void>> ready;
+				ready.set_value(std::move(asset));
+				return ready.get_future().share();
+			}
+
+			if(entry.inFlight.valid())
+				return entry.inFlight;
+		}
+
+		const auto promise = std::make_shared<std::promise<std::shared_ptr<void>>>();
+		entry.inFlight = promise->get_future().share();
+		auto future = entry.inFlight;
+
+		lock.unlock();
+
+		auto job = [promise, key = std::move(key), reader, filename, isReload]
+		{
+			// A failed load isn't cached, the next request tries again
+			try
+			{
+				isReloading = isReload;
+				auto asset = reader(filename);
+				isReloading = false;
+
+				finishLoad(key, asset);
+				promise->set_value(std::move(asset));
+			}
+			catch(...)
+			{
+				isReloading = false;
+				finishLoad(key, nullptr);
+				promise->set_exception(std::current_exception());
+			}
+		};
+
+		if(isAsync)
+			(void)getLoaderPool().submit(std::move(job));
+		else
+			job();
+
+		return future;
+	}
+
 	template <>
-	std::shared_ptr<AssetType::Shader> AssetManager::load<AssetType::Shader>(const std::string& filename)
+	std::shared_ptr<AssetType::Shader> AssetManager::read<AssetType::Shader>(const std::string& filename)
 	{
 		auto shader = std::make_shared<AssetType::Shader>();
-		auto file = openFile("Shaders/" + filename + ".spv");
-		auto fileSize = file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0, std::ios::beg);
+		const std::string path = "Shaders/" + filename + ".spv";
 
-		file.read((buffer.data()),
-		          buffer.size());
+#ifdef ENDURA_EMBED_SHADERS
+		if(!isLoosePath(path))
+		{
+			if(const auto spirV = findEmbeddedShader(filename); !spirV.empty())
+			{
+				shader->spirV.assign(spirV.begin(), spirV.end());
+				return shader;
+			}
+		}
+#endif
 
-		shader->spirV.resize(fileSize / sizeof(uint32_t));
+		const auto file = openFile(path);
+		const auto bytes = file.getBytes();
 
-		std::memcpy(shader->spirV.data(), buffer.data(), fileSize);
+		if(bytes.size() % sizeof(uint32_t) != 0)
+			throw std::runtime_error("Failed to load shader: " + filename + " isn't SPIR-V.");
 
-		file.close();
+		shader->spirV.resize(bytes.size() / sizeof(uint32_t));
+		std::memcpy(shader->spirV.data(), bytes.data(), bytes.size());
 
 		return shader;
 	}
 
-	std::ifstream AssetManager::openFile(const std::string& filename)
+	template <>
+	std::shared_ptr<AssetType::Generic> AssetManager::read<AssetType::Generic>(const std::string& filename)
 	{
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		auto generic = std::make_shared<AssetType::Generic>();
+		const auto file = openFile(filename);
+		const auto bytes = file.getBytes();
+
+		generic->bytes.resize(bytes.size());
+		std::memcpy(generic->bytes.data(), bytes.data(), bytes.size());
+
+		return generic;
+	}
+
+	template <>
+	std::shared_ptr<AssetType::Mesh> AssetManager::read<AssetType::Mesh>(const std::string& filename)
+	{
+		auto mesh = std::make_shared<AssetType::Mesh>();
+		mesh->file = openFile("Meshes/" + filename + ".mesh");
+
+		// Nothing is parsed or copied, the streams are views into the file
+		const auto bytes = mesh->file.getBytes();
+		if(bytes.size() < sizeof(MeshFileHeader))
+			throw std::runtime_error("Failed to load mesh: " + filename + " is too small.");
+
+		const auto* header = reinterpret_cast<const MeshFileHeader*>(bytes.data());
+		if(header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION)
+			throw std::runtime_error("Failed to load mesh: " + filename + " isn't a version " + std::to_string(MESH_FILE_VERSION) + " mesh.");
 
-		if (!file.is_open())
+		if(header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t))
+			throw std::runtime_error("Failed to load mesh: " + filename + " has indices that are neither 16 nor 32 bit.");
+
+		const uint64_t vertexBytes = static_cast<uint64_t>(header->vertexCount) * header->vertexStride;
+		const uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * header->indexSize;
+		const uint64_t submeshBytes = static_cast<uint64_t>(header->submeshCount) * sizeof(MeshFileSubmesh);
+		const uint64_t meshletBytes = static_cast<uint64_t>(header->meshletCount) * sizeof(MeshFileMeshlet);
+		const uint64_t meshletVertexBytes = static_cast<uint64_t>(header->meshletVertexCount) * sizeof(uint32_t);
+
+		const auto isInside = [&bytes](const uint64_t offset, const uint64_t size)
+		{
+			return offset % MESH_STREAM_ALIGNMENT == 0 && offset <= bytes.size() && size <= bytes.size() - offset;
+		};
+
+		if(!isInside(header->vertexOffset, vertexBytes) ||
+			!isInside(header->indexOffset, indexBytes) ||
+			!isInside(header->submeshOffset, submeshBytes) ||
+			!isInside(header->meshletOffset, meshletBytes) ||
+			!isInside(header->meshletVertexOffset, meshletVertexBytes) ||
+			!isInside(header->meshletTriangleOffset, header->meshletTriangleSize))
 		{
-			throw std::runtime_error("failed to open file!");
+			throw std::runtime_error("Failed to load mesh: the streams of " + filename + " are outside of the file.");
 		}
 
-		return file;
+		mesh->header = header;
+		mesh->submeshes = {
+			reinterpret_cast<const MeshFileSubmesh*>(bytes.data() + header->submeshOffset),
+			header->submeshCount
+		};
+
+		// Submeshes become indexed draws as they are, their ranges have to stay inside the streams
+		for(const auto& submesh : mesh->submeshes)
+		{
+			if(static_cast<uint64_t>(submesh.firstIndex) + submesh.indexCount > header->indexCount ||
+				submesh.vertexOffset < 0 || static_cast<uint32_t>(submesh.vertexOffset) > header->vertexCount ||
+				static_cast<uint64_t>(submesh.firstMeshlet) + submesh.meshletCount > header->meshletCount)
+			{
+				throw std::runtime_error("Failed to load mesh: a submesh of " + filename + " is outside of the streams.");
+			}
+		}
+
+		mesh->vertices = bytes.subspan(header->vertexOffset, vertexBytes);
+		mesh->indices = bytes.subspan(header->indexOffset, indexBytes);
+		mesh->meshlets = {
+			reinterpret_cast<const MeshFileMeshlet*>(bytes.data() + header->meshletOffset),
+			header->meshletCount
+		};
+		mesh->meshletVertices = {
+			reinterpret_cast<const uint32_t*>(bytes.data() + header->meshletVertexOffset),
+			header->meshletVertexCount
+		};
+		mesh->meshletTriangles = {
+			reinterpret_cast<const uint8_t*>(bytes.data() + header->meshletTriangleOffset),
+			header->meshletTriangleSize
+		};
+
+		return mesh;
 	}
 
-	template <typename T>
-	std::shared_ptr<T> AssetManager::load(const std::string& filename)
+	template <>
+	std::shared_ptr<AssetType::Texture> AssetManager::read<AssetType::Texture>(const std::string& filename)
 	{
-		static_assert(sizeof(T) == 0, "Unsupported asset type in AssetManager::load");
-		return nullptr;
+		auto texture = std::make_shared<AssetType::Texture>();
+		// Only the mips that get streamed in are read, the rest of the file is never paged in
+		texture->file = openFile("Textures/" + filename + ".tex", false);
+
+		const auto bytes = texture->file.getBytes();
+		if(bytes.size() < sizeof(TextureFileHeader))
+			throw std::runtime_error("Failed to load texture: " + filename + " is too small.");
+
+		const auto* header = reinterpret_cast<const TextureFileHeader*>(bytes.data());
+		if(header->magic != TEXTURE_FILE_MAGIC || header->version != TEXTURE_FILE_VERSION)
+			throw std::runtime_error("Failed to load texture: " + filename + " isn't a version " + std::to_string(TEXTURE_FILE_VERSION) + " texture.");
+
+		const uint64_t tableBytes = static_cast<uint64_t>(header->mipCount) * sizeof(TextureFileMip);
+		if(header->mipCount == 0 || header->mipTableOffset % alignof(TextureFileMip) != 0 ||
+			header->mipTableOffset > bytes.size() || tableBytes > bytes.size() - header->mipTableOffset)
+		{
+			throw std::runtime_error("Failed to load texture: the mip table of " + filename + " is outside of the file.");
+		}
+
+		// A full chain ends at 1x1 after floor(log2(max(width, height))) + 1 levels
+		if(header->width == 0 || header->height == 0 ||
+			header->mipCount > static_cast<uint32_t>(std::bit_width(std::max(header->width, header->height))))
+		{
+			throw std::runtime_error("Failed to load texture: " + filename + " has a wrong size or mip count.");
+		}
+
+		texture->header = header;
+		texture->mips = {
+			reinterpret_cast<const TextureFileMip*>(bytes.data() + header->mipTableOffset),
+			header->mipCount
+		};
+
+		// The streamer sizes the image levels and the staging copies from the mip table, it has to describe RGBA8 mips
+		// that halve the previous one
+		uint32_t expectedWidth = header->width;
+		uint32_t expectedHeight = header->height;
+		for(const auto& mip : texture->mips)
+		{
+			if(mip.offset % TEXTURE_MIP_ALIGNMENT != 0 || mip.offset > bytes.size() || mip.size > bytes.size() - mip.offset)
+				throw std::runtime_error("Failed to load texture: a mip of " + filename + " is outside of the file.");
+
+			if(mip.width != expectedWidth || mip.height != expectedHeight ||
+				mip.size != static_cast<uint64_t>(mip.width) * mip.height * 4)
+			{
+				throw std::runtime_error("Failed to load texture: a mip of " + filename + " doesn't match the mip chain.");
+			}
+
+			expectedWidth = std::max(1u, expectedWidth / 2);
+			expectedHeight = std::max(1u, expectedHeight / 2);
+		}
+
+		return texture;
+	}
+
+	AssetFile AssetManager::openFile(const std::string& filename, const bool isReadAhead)
+	{
+		if(const auto& pack = getAssetPack(); pack && !isLoosePath(filename))
+		{
+			if(const auto* entry = pack->find(filename))
+			{
+				// Uncompressed entries are used in place, like a mapped loose file
+				if(entry->flags & PACK_ENTRY_STORED)
+					return AssetFile(pack, pack->view(*entry));
+
+				std::vector<std::byte> bytes(entry->size);
+				pack->read(*entry, bytes);
+				return AssetFile(std::move(bytes));
+			}
+		}
+
+		return AssetFile(MappedFile(filename, isReadAhead));
 	}
 }
@@ -1,7 +1,16 @@
 #pragma once
+#include <chrono>
+#include <future>
 #include <memory>
+#include <span>
+#include <string>
+#include <typeindex>
 #include <vector>
 
+#include "AssetFile.h"
+#include "MeshFormat.h"
+#include "TextureFormat.h"
+
 namespace Assets
 {
 	namespace AssetType
@@ -15,15 +24,171 @@ namespace Assets
 		{
 			std::vector<char> bytes;
 		};
+
+		/**
+		 * Cooked mesh, the streams point into the file (valid as long as the asset lives)
+		 */
+		struct Mesh
+		{
+			AssetFile file;
+
+			const MeshFileHeader* header = nullptr;
+
+			std::span<const std::byte> vertices;
+			std::span<const std::byte> indices;
+			std::span<const MeshFileSubmesh> submeshes;
+
+			std::span<const MeshFileMeshlet> meshlets;
+			std::span<const uint32_t> meshletVertices;
+			std::span<const uint8_t> meshletTriangles;
+		};
+
+		/**
+		 * Cooked texture, the mips point into the file (valid as long as the asset lives)
+		 * Only the mips that get streamed in are ever read from disk (unless the pack entry is compressed).
+		 */
+		struct Texture
+		{
+			AssetFile file;
+
+			const TextureFileHeader* header = nullptr;
+
+			// Largest first
+			std::span<const TextureFileMip> mips;
+
+			[[nodiscard]] std::span<const std::byte> getMipData(uint32_t mip) const
+			{
+				return file.getBytes().subspan(mips[mip].offset, mips[mip].size);
+			}
+		};
 	}
 
+	/**
+	 * Pending or finished load, shared by every request of the same asset
+	 */
+	template<typename T>
+	class AssetHandle
+	{
+	public:
+		AssetHandle() = default;
+
+		explicit AssetHandle(std::shared_future<std::shared_ptr<void>> future) : _future(std::move(future))
+		{
+		}
+
+		/**
+		 * Blocks until the asset is loaded, rethrows the error of a failed load
+		 */
+		[[nodiscard]] std::shared_ptr<T> get() const
+		{
+			return std::static_pointer_cast<T>(_future.get());
+		}
+
+		[[nodiscard]] bool isReady() const
+		{
+			return _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+
+		void wait() const
+		{
+			_future.wait();
+		}
+
+		[[nodiscard]] bool isValid() const
+		{
+			return _future.valid();
+		}
+
+	private:
+		std::shared_future<std::shared_ptr<void>> _future;
+	};
+
+	/**
+	 * Loads assets from the asset pack of the runtime directory, or from loose files when it doesn't contain them.
+	 *
+	 * Assets are cached by type and name without being owned: while anyone holds an asset, loading it again
+	 * returns the same instance, and requests for an asset that is still loading wait for that load
+	 * instead of starting another one.
+	 */
 	class AssetManager
 	{
 	public:
+		/**
+		 * Loads on the calling thread (or waits for the load already in flight)
+		 */
+		template<typename T>
+		[[nodiscard]] static std::shared_ptr<T> load(const std::string& filename)
+		{
+			return AssetHandle<T>(request(typeid(T), filename, &readErased<T>, false)).get();
+		}
+
+		/**
+		 * Loads on the asset worker threads
+		 *
+		 * @return Handle of the load, already finished when the asset is cached
+		 */
+		template<typename T>
+		[[nodiscard]] static AssetHandle<T> loadAsync(const std::string& filename)
+		{
+			return AssetHandle<T>(request(typeid(T), filename, &readErased<T>, true));
+		}
+
+		/**
+		 * Reads the asset again on the calling thread and caches the new instance (users of the old one keep it)
+		 * The file is read from disk even if the asset pack contains it, and so is every later load of it.
+		 */
 		template<typename T>
-		[[nodiscard]] static std::shared_ptr<T> load(const std::string& filename);
+		[[nodiscard]] static std::shared_ptr<T> reload(const std::string& filename)
+		{
+			return AssetHandle<T>(request(typeid(T), filename, &readErased<T>, false, true)).get();
+		}
 
 	private:
-		static std::ifstream openFile(const std::string& filename);
+		using AssetReader = std::shared_ptr<void>(*)(const std::string& filename);
+
+		/**
+		 * Reads the asset from disk, specialized for every asset type
+		 */
+		template<typename T>
+		static std::shared_ptr<T> read(const std::string& filename)
+		{
+			static_assert(sizeof(T) == 0, "Unsupported asset type in AssetManager::load");
+			return nullptr;
+		}
+
+		template<typename T>
+		static std::shared_ptr<void> readErased(const std::string& filename)
+		{
+			return read<T>(filename);
+		}
+
+		/**
+		 * Returns the cached asset, joins the load in flight or starts a new one
+		 *
+		 * @param isAsync Runs a new load on the worker threads instead of the calling thread
+		 * @param isReload Ignores the cached asset and reads the loose file
+		 */
+		static std::shared_future<std::shared_ptr<void>> request(
+			std::type_index type, const std::string& filename, AssetReader reader, bool isAsync, bool isReload = false
+		);
+
+		/**
+		 * Looks the path up in the asset pack first (unless the asset was reloaded), then maps the loose file
+		 *
+		 * @param isReadAhead Whether a loose file is read in right away (see MappedFile)
+		 */
+		static AssetFile openFile(const std::string& filename, bool isReadAhead = true);
 	};
+
+	template<>
+	std::shared_ptr<AssetType::Shader> AssetManager::read<AssetType::Shader>(const std::string& filename);
+
+	template<>
+	std::shared_ptr<AssetType::Generic> AssetManager::read<AssetType::Generic>(const std::string& filename);
+
+	template<>
+	std::shared_ptr<AssetType::Mesh> AssetManager::read<AssetType::Mesh>(const std::string& filename);
+
+	template<>
+	std::shared_ptr<AssetType::Texture> AssetManager::read<AssetType::Texture>(const std::string& filename);
 }
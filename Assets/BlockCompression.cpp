@@ -0,0 +1,171 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace Assets
+{
+	namespace
+	{
+		constexpr size_t MIN_MATCH = 4;
+		constexpr size_t MAX_OFFSET = 65535;
+		constexpr uint32_t HASH_BITS = 16;
+
+		uint32_t read32(const std::byte* data)
+		{
+			uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint32_t hashSequence(const uint32_t sequence)
+		{
+			return (sequence * 2654435761u) >> (32 - HASH_BITS);
+		}
+
+		/**
+		 * Lengths of 15 and more continue in bytes of 255, ended by a smaller byte
+		 */
+		void writeLength(std::vector<std::byte>& output, size_t length)
+		{
+			while(length >= 255)
+			{
+				output.push_back(std::byte{255});
+				length -= 255;
+			}
+			output.push_back(static_cast<std::byte>(length));
+		}
+
+		void writeSequence(
+			std::vector<std::byte>& output, const std::byte* literals, const size_t literalLength,
+			const size_t offset, const size_t matchLength
+		)
+		{
+			const size_t matchCode = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+
+			const auto token = static_cast<uint8_t>(
+				(std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)
+			);
+			output.push_back(static_cast<std::byte>(token));
+
+			if(literalLength >= 15) writeLength(output, literalLength - 15);
+			output.insert(output.end(), literals, literals + literalLength);
+
+			// The last sequence only has literals
+			if(matchLength == 0) return;
+
+			output.push_back(static_cast<std::byte>(offset & 0xFF));
+			output.push_back(static_cast<std::byte>(offset >> 8));
+
+			if(matchCode >= 15) writeLength(output, matchCode - 15);
+		}
+
+		size_t readLength(const std::span<const std::byte> input, size_t& position)
+		{
+			size_t length = 0;
+			uint8_t byte;
+			do
+			{
+				if(position >= input.size())
+					throw std::runtime_error("Failed to decompress block: length past the end of the block.");
+
+				byte = std::to_integer<uint8_t>(input[position++]);
+				length += byte;
+			} while(byte == 255);
+
+			return length;
+		}
+	}
+
+	void compressBlock(const std::span<const std::byte> input, std::vector<std::byte>& output)
+	{
+		output.clear();
+		output.reserve(input.size() + input.size() / 255 + 16);
+
+		const std::byte* data = input.data();
+		const size_t size = input.size();
+
+		std::vector<int64_t> table(size_t{1} << HASH_BITS, -1);
+
+		size_t anchor = 0;
+		size_t position = 0;
+
+		// Greedy: take the first match the hash table remembers
+		while(position + MIN_MATCH <= size)
+		{
+			const uint32_t sequence = read32(data + position);
+			auto& slot = table[hashSequence(sequence)];
+			const int64_t candidate = slot;
+			slot = static_cast<int64_t>(position);
+
+			if(candidate < 0 || position - candidate > MAX_OFFSET || read32(data + candidate) != sequence)
+			{
+				position++;
+				continue;
+			}
+
+			size_t matchLength = MIN_MATCH;
+			while(position + matchLength < size && data[candidate + matchLength] == data[position + matchLength])
+			{
+				matchLength++;
+			}
+
+			writeSequence(output, data + anchor, position - anchor, position - candidate, matchLength);
+
+			position += matchLength;
+			anchor = position;
+		}
+
+		writeSequence(output, data + anchor, size - anchor, 0, 0);
+	}
+
+	void decompressBlock(const std::span<const std::byte> input, const std::span<std::byte> output)
+	{
+		size_t inputPosition = 0;
+		size_t outputPosition = 0;
+
+		while(inputPosition < input.size())
+		{
+			const auto token = std::to_integer<uint8_t>(input[inputPosition++]);
+
+			size_t literalLength = token >> 4;
+			if(literalLength == 15) literalLength += readLength(input, inputPosition);
+
+			if(literalLength > input.size() - inputPosition || literalLength > output.size() - outputPosition)
+				throw std::runtime_error("Failed to decompress block: literals past the end of the block.");
+
+			std::memcpy(output.data() + outputPosition, input.data() + inputPosition, literalLength);
+			inputPosition += literalLength;
+			outputPosition += literalLength;
+
+			if(inputPosition == input.size()) break;
+
+			if(input.size() - inputPosition < 2)
+				throw std::runtime_error("Failed to decompress block: truncated match offset.");
+
+			const size_t offset =
+				std::to_integer<size_t>(input[inputPosition]) | std::to_integer<size_t>(input[inputPosition + 1]) << 8;
+			inputPosition += 2;
+
+			size_t matchLength = (token & 0x0F) + MIN_MATCH;
+			if((token & 0x0F) == 15) matchLength += readLength(input, inputPosition);
+
+			if(offset == 0 || offset > outputPosition || matchLength > output.size() - outputPosition)
+				throw std::runtime_error("Failed to decompress block: match outside of the output.");
+
+			// Byte by byte, the match may overlap the bytes it produces
+			std::byte* destination = output.data() + outputPosition;
+			const std::byte* source = destination - offset;
+			for(size_t i = 0; i < matchLength; i++)
+			{
+				destination[i] = source[i];
+			}
+			outputPosition += matchLength;
+		}
+
+		if(outputPosition != output.size())
+			throw std::runtime_error("Failed to decompress block: size doesn't match.");
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Assets
+{
+	/**
+	 * Byte-oriented LZ77 block codec (LZ4 style sequences: token, literals, 16 bit offset, match length)
+	 * Fast to decode, meant for asset blocks of a few hundred KiB.
+	 */
+
+	/**
+	 * @param input Block to compress
+	 * @param output Replaced by the compressed block
+	 */
+	void compressBlock(std::span<const std::byte> input, std::vector<std::byte>& output);
+
+	/**
+	 * Throws if the block is corrupt or doesn't decompress to exactly output.size() bytes
+	 *
+	 * @param input Compressed block
+	 * @param output Destination, sized to the uncompressed size
+	 */
+	void decompressBlock(std::span<const std::byte> input, std::span<std::byte> output);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "PackFormat.h"
+
+namespace Assets
+{
+	/**
+	 * SPIR-V compiled into the binary (ENDURA_EMBED_SHADERS), named like the asset (e.g. "shader")
+	 */
+	struct EmbeddedShader
+	{
+		std::string_view name;
+		std::span<const uint32_t> spirV;
+	};
+
+	/**
+	 * Open addressing table over the shaders, by the hash of their name (linear probing, -1 is an empty slot)
+	 * At most half full so a lookup is one or two probes, duplicate names don't compile.
+	 */
+	template<size_t Count>
+	consteval auto buildEmbeddedShaderTable(const std::array<EmbeddedShader, Count>& shaders)
+	{
+		std::array<int32_t, std::bit_ceil(Count * 2)> table{};
+		table.fill(-1);
+
+		for(size_t index = 0; index < Count; index++)
+		{
+			size_t slot = hashPackPath(shaders[index].name) & (table.size() - 1);
+			while(table[slot] != -1)
+			{
+				if(shaders[table[slot]].name == shaders[index].name)
+					throw "Shader embedded twice";
+
+				slot = (slot + 1) & (table.size() - 1);
+			}
+
+			table[slot] = static_cast<int32_t>(index);
+		}
+
+		return table;
+	}
+
+	template<size_t Count, size_t Capacity>
+	constexpr std::span<const uint32_t> findInEmbeddedShaderTable(
+		const std::array<EmbeddedShader, Count>& shaders,
+		const std::array<int32_t, Capacity>& table,
+		const std::string_view name
+	)
+	{
+		for(size_t slot = hashPackPath(name) & (Capacity - 1); table[slot] != -1; slot = (slot + 1) & (Capacity - 1))
+		{
+			if(shaders[table[slot]].name == name)
+				return shaders[table[slot]].spirV;
+		}
+
+		return {};
+	}
+
+	/**
+	 * Only defined when the build embeds the shaders (the translation unit is generated by CompileShaders)
+	 *
+	 * @return SPIR-V of the shader, empty if it isn't one of the embedded ones
+	 */
+	[[nodiscard]] std::span<const uint32_t> findEmbeddedShader(std::string_view name);
+}
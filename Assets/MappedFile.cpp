@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace Assets
+{
+	MappedFile::MappedFile(const std::string& filename, const bool isReadAhead)
+	{
+		const int descriptor = open(filename.c_str(), O_RDONLY);
+		if(descriptor < 0)
+			throw std::runtime_error("Failed to map file: can't open " + filename + ".");
+
+		struct stat fileStat{};
+		if(fstat(descriptor, &fileStat) != 0)
+		{
+			close(descriptor);
+			throw std::runtime_error("Failed to map file: can't stat " + filename + ".");
+		}
+
+		_size = static_cast<size_t>(fileStat.st_size);
+		if(_size == 0)
+		{
+			close(descriptor);
+			return;
+		}
+
+		void* mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+		// The mapping keeps its own reference to the file
+		close(descriptor);
+
+		if(mapping == MAP_FAILED)
+		{
+			_size = 0;
+			throw std::runtime_error("Failed to map file: mmap failed for " + filename + ".");
+		}
+
+		// Only for files that are copied in full, partially read ones (texture mips) are paged in as touched
+		if(isReadAhead) madvise(mapping, _size, MADV_WILLNEED);
+
+		_data = static_cast<const std::byte*>(mapping);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		unmap();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if(this != &other)
+		{
+			unmap();
+			_data = std::exchange(other._data, nullptr);
+			_size = std::exchange(other._size, 0);
+		}
+
+		return *this;
+	}
+
+	std::span<const std::byte> MappedFile::getBytes() const
+	{
+		return {_data, _size};
+	}
+
+	size_t MappedFile::getSize() const
+	{
+		return _size;
+	}
+
+	void MappedFile::unmap()
+	{
+		if(_data) munmap(const_cast<std::byte*>(_data), _size);
+
+		_data = nullptr;
+		_size = 0;
+	}
+}
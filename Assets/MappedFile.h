@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace Assets
+{
+	/**
+	 * Read-only memory mapping of a whole file, the pages are only read in when touched
+	 */
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+
+		/**
+		 * @param filename File to map, throws if it can't be opened or mapped
+		 * @param isReadAhead Whether the whole file is read in right away, for files that are read in full
+		 */
+		explicit MappedFile(const std::string& filename, bool isReadAhead = false);
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] std::span<const std::byte> getBytes() const;
+
+		[[nodiscard]] size_t getSize() const;
+
+	private:
+		const std::byte* _data = nullptr;
+		size_t _size = 0;
+
+		void unmap();
+	};
+}
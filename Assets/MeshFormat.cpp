@@ -0,0 +1,222 @@
+#include "MeshFormat.h"
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace Assets
+{
+	namespace
+	{
+		uint64_t alignStream(const uint64_t offset)
+		{
+			return (offset + MESH_STREAM_ALIGNMENT - 1) / MESH_STREAM_ALIGNMENT * MESH_STREAM_ALIGNMENT;
+		}
+
+		struct Position
+		{
+			float values[3] = {0.0f, 0.0f, 0.0f};
+		};
+	}
+
+	void cookMesh(
+		const std::string& filename,
+		const std::span<const std::byte> vertices,
+		const uint32_t vertexStride,
+		const uint32_t positionOffset,
+		const uint32_t positionComponents,
+		const std::span<const std::byte> indices,
+		const uint32_t indexSize,
+		const std::span<const MeshFileSubmesh> submeshes
+	)
+	{
+		if(vertexStride == 0 || vertices.size() % vertexStride != 0)
+			throw std::runtime_error("Failed to cook mesh: the vertex stream isn't a multiple of the stride.");
+		if((indexSize != 2 && indexSize != 4) || indices.size() % indexSize != 0)
+			throw std::runtime_error("Failed to cook mesh: indices must be 16 or 32 bit.");
+		if(positionComponents < 2 || positionComponents > 3 || positionOffset + positionComponents * sizeof(float) > vertexStride)
+			throw std::runtime_error("Failed to cook mesh: the position doesn't fit in the vertex.");
+
+		const auto vertexCount = static_cast<uint32_t>(vertices.size() / vertexStride);
+		const auto indexCount = static_cast<uint32_t>(indices.size() / indexSize);
+
+		const auto readPosition = [&](const uint64_t vertex)
+		{
+			Position position;
+			std::memcpy(position.values, vertices.data() + vertex * vertexStride + positionOffset, positionComponents * sizeof(float));
+			return position;
+		};
+
+		const auto readIndex = [&](const uint32_t index) -> uint64_t
+		{
+			if(indexSize == 2)
+			{
+				uint16_t value;
+				std::memcpy(&value, indices.data() + index * sizeof(uint16_t), sizeof(value));
+				return value;
+			}
+
+			uint32_t value;
+			std::memcpy(&value, indices.data() + index * sizeof(uint32_t), sizeof(value));
+			return value;
+		};
+
+		// Half the index bandwidth whenever the mesh is small enough
+		uint64_t maximumIndex = 0;
+		for(uint32_t i = 0; i < indexCount; i++)
+			maximumIndex = std::max(maximumIndex, readIndex(i));
+
+		const uint32_t storedIndexSize = maximumIndex <= UINT16_MAX ? 2 : 4;
+		std::vector<std::byte> narrowedIndices;
+		std::span<const std::byte> storedIndices = indices;
+		if(storedIndexSize != indexSize)
+		{
+			narrowedIndices.resize(static_cast<size_t>(indexCount) * storedIndexSize);
+			for(uint32_t i = 0; i < indexCount; i++)
+			{
+				const auto index = static_cast<uint16_t>(readIndex(i));
+				std::memcpy(narrowedIndices.data() + i * sizeof(uint16_t), &index, sizeof(index));
+			}
+			storedIndices = narrowedIndices;
+		}
+
+		MeshFileHeader header{};
+		header.magic = MESH_FILE_MAGIC;
+		header.version = MESH_FILE_VERSION;
+		header.vertexStride = vertexStride;
+		header.vertexCount = vertexCount;
+		header.indexSize = storedIndexSize;
+		header.indexCount = indexCount;
+		header.submeshCount = static_cast<uint32_t>(submeshes.size());
+		header.vertexOffset = alignStream(sizeof(MeshFileHeader));
+		header.indexOffset = alignStream(header.vertexOffset + vertices.size());
+		header.submeshOffset = alignStream(header.indexOffset + storedIndices.size());
+
+		std::fill_n(header.boundsMin, 3, vertexCount > 0 ? std::numeric_limits<float>::max() : 0.0f);
+		std::fill_n(header.boundsMax, 3, vertexCount > 0 ? std::numeric_limits<float>::lowest() : 0.0f);
+		for(uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			const Position position = readPosition(vertex);
+			for(uint32_t axis = 0; axis < 3; axis++)
+			{
+				header.boundsMin[axis] = std::min(header.boundsMin[axis], position.values[axis]);
+				header.boundsMax[axis] = std::max(header.boundsMax[axis], position.values[axis]);
+			}
+		}
+
+		std::vector<float> positions(static_cast<size_t>(vertexCount) * 3);
+		for(uint32_t vertex = 0; vertex < vertexCount; vertex++)
+			std::copy_n(readPosition(vertex).values, 3, positions.data() + static_cast<size_t>(vertex) * 3);
+
+		MeshletData meshletData;
+		std::vector<uint32_t> submeshIndices;
+
+		// Center of the box of the referenced vertices, radius to the farthest one
+		std::vector<MeshFileSubmesh> cookedSubmeshes(submeshes.begin(), submeshes.end());
+		for(auto& submesh : cookedSubmeshes)
+		{
+			if(static_cast<uint64_t>(submesh.firstIndex) + submesh.indexCount > indexCount)
+				throw std::runtime_error("Failed to cook mesh: a submesh is outside of the index stream.");
+
+			const auto vertexAt = [&](const uint32_t i)
+			{
+				const int64_t vertex = static_cast<int64_t>(readIndex(submesh.firstIndex + i)) + submesh.vertexOffset;
+				if(vertex < 0 || vertex >= vertexCount)
+					throw std::runtime_error("Failed to cook mesh: an index is outside of the vertex stream.");
+				return readPosition(static_cast<uint64_t>(vertex));
+			};
+
+			float minimum[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+			float maximum[3] = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+			for(uint32_t i = 0; i < submesh.indexCount; i++)
+			{
+				const Position position = vertexAt(i);
+				for(uint32_t axis = 0; axis < 3; axis++)
+				{
+					minimum[axis] = std::min(minimum[axis], position.values[axis]);
+					maximum[axis] = std::max(maximum[axis], position.values[axis]);
+				}
+			}
+
+			float center[3] = {0.0f, 0.0f, 0.0f};
+			if(submesh.indexCount > 0)
+			{
+				for(uint32_t axis = 0; axis < 3; axis++)
+				{
+					center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+				}
+			}
+
+			float radius = 0.0f;
+			for(uint32_t i = 0; i < submesh.indexCount; i++)
+			{
+				const Position position = vertexAt(i);
+				const float dx = position.values[0] - center[0];
+				const float dy = position.values[1] - center[1];
+				const float dz = position.values[2] - center[2];
+				radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+			}
+
+			submesh.boundingSphere[0] = center[0];
+			submesh.boundingSphere[1] = center[1];
+			submesh.boundingSphere[2] = center[2];
+			submesh.boundingSphere[3] = radius;
+
+			// The meshlets index the vertex stream directly, vertexOffset is added here
+			submeshIndices.resize(submesh.indexCount);
+			for(uint32_t i = 0; i < submesh.indexCount; i++)
+				submeshIndices[i] = static_cast<uint32_t>(static_cast<int64_t>(readIndex(submesh.firstIndex + i)) + submesh.vertexOffset);
+
+			std::fill_n(submesh.padding, 3, 0);
+			submesh.firstMeshlet = static_cast<uint32_t>(meshletData.meshlets.size());
+			submesh.meshletCount = buildMeshlets(positions, submeshIndices, meshletData);
+		}
+
+		header.meshletCount = static_cast<uint32_t>(meshletData.meshlets.size());
+		header.meshletVertexCount = static_cast<uint32_t>(meshletData.vertices.size());
+		header.meshletTriangleSize = static_cast<uint32_t>(meshletData.triangles.size());
+		header.meshletOffset = alignStream(header.submeshOffset + cookedSubmeshes.size() * sizeof(MeshFileSubmesh));
+		header.meshletVertexOffset = alignStream(header.meshletOffset + meshletData.meshlets.size() * sizeof(MeshFileMeshlet));
+		header.meshletTriangleOffset = alignStream(header.meshletVertexOffset + meshletData.vertices.size() * sizeof(uint32_t));
+
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if(!file.is_open())
+			throw std::runtime_error("Failed to cook mesh: can't open " + filename + ".");
+
+		const auto writeAt = [&file](const uint64_t offset, const void* data, const size_t size)
+		{
+			// Zero padding up to the aligned start of the stream
+			static constexpr char zeros[MESH_STREAM_ALIGNMENT] = {};
+			const auto position = static_cast<uint64_t>(file.tellp());
+			file.write(zeros, static_cast<std::streamsize>(offset - position));
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.vertexOffset, vertices.data(), vertices.size());
+		writeAt(header.indexOffset, storedIndices.data(), storedIndices.size());
+		writeAt(header.submeshOffset, cookedSubmeshes.data(), cookedSubmeshes.size() * sizeof(MeshFileSubmesh));
+		writeAt(header.meshletOffset, meshletData.meshlets.data(), meshletData.meshlets.size() * sizeof(MeshFileMeshlet));
+		writeAt(header.meshletVertexOffset, meshletData.vertices.data(), meshletData.vertices.size() * sizeof(uint32_t));
+		writeAt(header.meshletTriangleOffset, meshletData.triangles.data(), meshletData.triangles.size());
+
+		if(!file)
+			throw std::runtime_error("Failed to cook mesh: writing " + filename + " failed.");
+
+		std::printf(
+			"Mesh cooked -> %s: %u vertices, %u indices (%u bit), %u submeshes, %u meshlets\n",
+			filename.c_str(),
+			vertexCount,
+			indexCount,
+			storedIndexSize * 8,
+			header.submeshCount,
+			header.meshletCount
+		);
+	}
+}
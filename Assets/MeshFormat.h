@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace Assets
+{
+	constexpr uint32_t MESH_FILE_MAGIC = 0x48534D45; // "EMSH"
+	constexpr uint32_t MESH_FILE_VERSION = 2;
+
+	/**
+	 * Every stream starts at a multiple of this, so it can be copied to the GPU as is
+	 */
+	constexpr uint64_t MESH_STREAM_ALIGNMENT = 16;
+
+	/**
+	 * Meshlet size limits, the ones mesh shading hardware is fastest with
+	 */
+	constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	/**
+	 * Range of the index stream drawn with one drawIndexed, with its bounds in mesh space
+	 */
+	struct MeshFileSubmesh
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+
+		// Filled by cookMesh, the meshlet vertices already have vertexOffset added
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+		uint32_t padding[3];
+
+		float boundingSphere[4];
+	};
+
+	/**
+	 * Cluster of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES triangles of a submesh
+	 * Its triangles index its vertices (one byte per corner), which index the vertex stream.
+	 * The cone holds the normals of every triangle: all of them face away from any camera position where
+	 * dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff (a cutoff of 1 is never culled).
+	 */
+	struct MeshFileMeshlet
+	{
+		// Into the meshlet vertex stream
+		uint32_t firstVertex;
+		// Byte offset into the meshlet triangle stream, a multiple of 4
+		uint32_t firstTriangle;
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+
+		float boundingSphere[4];
+
+		float coneApex[3];
+		float coneCutoff;
+
+		float coneAxis[3];
+		uint32_t padding;
+	};
+
+	/**
+	 * Start of a cooked mesh (.mesh), the streams follow at the given offsets:
+	 * header | vertices | indices | submeshes | meshlets | meshlet vertices | meshlet triangles
+	 */
+	struct MeshFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+
+		// Bytes per index, 2 whenever every index fits
+		uint32_t indexSize;
+		uint32_t indexCount;
+
+		uint32_t submeshCount;
+		uint32_t meshletCount;
+
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t submeshOffset;
+
+		uint64_t meshletOffset;
+		uint64_t meshletVertexOffset;
+		uint64_t meshletTriangleOffset;
+
+		// 32 bit vertex indices
+		uint32_t meshletVertexCount;
+		// Bytes, three per triangle plus the padding of every meshlet to 4 bytes
+		uint32_t meshletTriangleSize;
+
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	static_assert(sizeof(MeshFileSubmesh) == 48);
+	static_assert(sizeof(MeshFileMeshlet) == 64);
+	static_assert(sizeof(MeshFileHeader) == 112);
+
+	/**
+	 * Writes a cooked mesh, the vertices are stored as they are given (the layout is the renderer's)
+	 * The bounds of the mesh, the bounding spheres of the submeshes and the meshlets are computed from the positions,
+	 * 32 bit indices are stored as 16 bit ones when every index fits.
+	 *
+	 * @param filename Output path
+	 * @param vertices Vertex stream, vertexCount * vertexStride bytes
+	 * @param vertexStride Bytes per vertex
+	 * @param positionOffset Offset of the position inside a vertex
+	 * @param positionComponents Floats in the position (2 or 3)
+	 * @param indices Index stream
+	 * @param indexSize Bytes per index, 2 or 4
+	 * @param submeshes Ranges of the index stream, the bounding spheres are filled in
+	 */
+	void cookMesh(
+		const std::string& filename,
+		std::span<const std::byte> vertices,
+		uint32_t vertexStride,
+		uint32_t positionOffset,
+		uint32_t positionComponents,
+		std::span<const std::byte> indices,
+		uint32_t indexSize,
+		std::span<const MeshFileSubmesh> submeshes
+	);
+}
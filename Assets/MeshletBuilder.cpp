@@ -0,0 +1,198 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace Assets
+{
+	namespace
+	{
+		// Below this the normals spread too far for a useful cone (and the apex can't be placed)
+		constexpr float MIN_CONE_DOT = 0.1f;
+
+		constexpr uint8_t NOT_IN_MESHLET = 0xFF;
+
+		static_assert(MESHLET_MAX_VERTICES < NOT_IN_MESHLET);
+
+		struct Vec3
+		{
+			float x = 0.0f;
+			float y = 0.0f;
+			float z = 0.0f;
+
+			Vec3 operator+(const Vec3& other) const { return {x + other.x, y + other.y, z + other.z}; }
+			Vec3 operator-(const Vec3& other) const { return {x - other.x, y - other.y, z - other.z}; }
+			Vec3 operator*(const float scale) const { return {x * scale, y * scale, z * scale}; }
+		};
+
+		float dot(const Vec3& a, const Vec3& b)
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		Vec3 cross(const Vec3& a, const Vec3& b)
+		{
+			return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+		}
+
+		float length(const Vec3& vector)
+		{
+			return std::sqrt(dot(vector, vector));
+		}
+
+		/**
+		 * Fills the bounding sphere and the normal cone of a finished meshlet
+		 */
+		void computeBounds(
+			MeshFileMeshlet& meshlet, const std::span<const float> positions, const MeshletData& meshletData
+		)
+		{
+			const auto positionOf = [&](const uint8_t localVertex)
+			{
+				const uint64_t vertex = meshletData.vertices[meshlet.firstVertex + localVertex];
+				return Vec3{positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]};
+			};
+
+			// Center of the box, radius to the farthest vertex (like the submesh spheres)
+			Vec3 minimum{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+			Vec3 maximum{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+			for(uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				const Vec3 position = positionOf(static_cast<uint8_t>(i));
+				minimum = {std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z)};
+				maximum = {std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z)};
+			}
+
+			const Vec3 center = (minimum + maximum) * 0.5f;
+			float radius = 0.0f;
+			for(uint32_t i = 0; i < meshlet.vertexCount; i++)
+				radius = std::max(radius, length(positionOf(static_cast<uint8_t>(i)) - center));
+
+			meshlet.boundingSphere[0] = center.x;
+			meshlet.boundingSphere[1] = center.y;
+			meshlet.boundingSphere[2] = center.z;
+			meshlet.boundingSphere[3] = radius;
+
+			// Unit normals of the triangles (degenerate ones don't face anywhere), the axis is their average
+			std::vector<std::pair<Vec3, Vec3>> normals;
+			normals.reserve(meshlet.triangleCount);
+
+			Vec3 axis;
+			for(uint32_t triangle = 0; triangle < meshlet.triangleCount; triangle++)
+			{
+				const uint8_t* corners = meshletData.triangles.data() + meshlet.firstTriangle + triangle * 3;
+				const Vec3 a = positionOf(corners[0]);
+				const Vec3 normal = cross(positionOf(corners[1]) - a, positionOf(corners[2]) - a);
+
+				const float area = length(normal);
+				if(area <= std::numeric_limits<float>::min()) continue;
+
+				normals.emplace_back(normal * (1.0f / area), a);
+				axis = axis + normals.back().first;
+			}
+
+			meshlet.coneCutoff = 1.0f;
+			std::fill_n(meshlet.coneApex, 3, 0.0f);
+			std::fill_n(meshlet.coneAxis, 3, 0.0f);
+
+			const float axisLength = length(axis);
+			if(axisLength <= std::numeric_limits<float>::min()) return;
+			axis = axis * (1.0f / axisLength);
+
+			float minimumDot = 1.0f;
+			for(const auto& [normal, corner] : normals)
+				minimumDot = std::min(minimumDot, dot(axis, normal));
+
+			if(minimumDot <= MIN_CONE_DOT) return;
+
+			// The apex is the point on the axis behind the plane of every triangle
+			float apexDistance = 0.0f;
+			for(const auto& [normal, corner] : normals)
+				apexDistance = std::max(apexDistance, dot(center - corner, normal) / dot(axis, normal));
+
+			const Vec3 apex = center - axis * apexDistance;
+
+			// The normals are within acos(minimumDot) of the axis, every triangle faces away once the view
+			// direction is more than 90 degrees past that: cos(angle + 90) = -sin(angle)
+			meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+			meshlet.coneApex[0] = apex.x;
+			meshlet.coneApex[1] = apex.y;
+			meshlet.coneApex[2] = apex.z;
+			meshlet.coneAxis[0] = axis.x;
+			meshlet.coneAxis[1] = axis.y;
+			meshlet.coneAxis[2] = axis.z;
+		}
+	}
+
+	uint32_t buildMeshlets(
+		const std::span<const float> positions, const std::span<const uint32_t> indices, MeshletData& meshletData
+	)
+	{
+		if(indices.size() % 3 != 0)
+			throw std::runtime_error("Failed to build meshlets: the indices aren't a triangle list.");
+
+		const size_t vertexCount = positions.size() / 3;
+		const auto firstMeshlet = static_cast<uint32_t>(meshletData.meshlets.size());
+
+		// Local index of every vertex in the meshlet being built
+		std::vector<uint8_t> localIndices(vertexCount, NOT_IN_MESHLET);
+
+		MeshFileMeshlet meshlet{};
+		meshlet.firstVertex = static_cast<uint32_t>(meshletData.vertices.size());
+		meshlet.firstTriangle = static_cast<uint32_t>(meshletData.triangles.size());
+
+		const auto finishMeshlet = [&]
+		{
+			for(uint32_t i = 0; i < meshlet.vertexCount; i++)
+				localIndices[meshletData.vertices[meshlet.firstVertex + i]] = NOT_IN_MESHLET;
+
+			computeBounds(meshlet, positions, meshletData);
+			meshletData.meshlets.push_back(meshlet);
+
+			// The next meshlet's triangles start word aligned
+			meshletData.triangles.resize((meshletData.triangles.size() + 3) / 4 * 4, 0);
+
+			meshlet = {};
+			meshlet.firstVertex = static_cast<uint32_t>(meshletData.vertices.size());
+			meshlet.firstTriangle = static_cast<uint32_t>(meshletData.triangles.size());
+		};
+
+		for(size_t triangle = 0; triangle < indices.size(); triangle += 3)
+		{
+			const uint32_t corners[3] = {indices[triangle], indices[triangle + 1], indices[triangle + 2]};
+
+			uint32_t newVertices = 0;
+			for(uint32_t i = 0; i < 3; i++)
+			{
+				if(corners[i] >= vertexCount)
+					throw std::runtime_error("Failed to build meshlets: an index is outside of the vertex stream.");
+
+				// A corner repeated within the triangle is only new once
+				const bool isRepeated = (i > 0 && corners[i] == corners[0]) || (i > 1 && corners[i] == corners[1]);
+				if(localIndices[corners[i]] == NOT_IN_MESHLET && !isRepeated) newVertices++;
+			}
+
+			if(meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES || meshlet.triangleCount == MESHLET_MAX_TRIANGLES)
+				finishMeshlet();
+
+			for(const uint32_t corner : corners)
+			{
+				if(localIndices[corner] == NOT_IN_MESHLET)
+				{
+					localIndices[corner] = static_cast<uint8_t>(meshlet.vertexCount++);
+					meshletData.vertices.push_back(corner);
+				}
+
+				meshletData.triangles.push_back(localIndices[corner]);
+			}
+			meshlet.triangleCount++;
+		}
+
+		if(meshlet.triangleCount > 0)
+			finishMeshlet();
+
+		return static_cast<uint32_t>(meshletData.meshlets.size()) - firstMeshlet;
+	}
+}
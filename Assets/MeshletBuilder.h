@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "MeshFormat.h"
+
+namespace Assets
+{
+	/**
+	 * Meshlets with their vertex and triangle streams, as they are stored in a cooked mesh
+	 */
+	struct MeshletData
+	{
+		std::vector<MeshFileMeshlet> meshlets;
+		std::vector<uint32_t> vertices;
+		std::vector<uint8_t> triangles;
+	};
+
+	/**
+	 * Splits a triangle list into meshlets and appends them (with their bounding spheres and normal cones) to meshletData
+	 * Triangles are taken in index order, a meshlet is closed when the next triangle doesn't fit anymore,
+	 * so the clusters are as local as the index order is (optimize the order for the vertex cache first).
+	 *
+	 * @param positions Three floats per vertex
+	 * @param indices Triangle list into positions
+	 * @param meshletData Streams the meshlets are appended to
+	 * @return Number of meshlets appended
+	 */
+	uint32_t buildMeshlets(std::span<const float> positions, std::span<const uint32_t> indices, MeshletData& meshletData);
+}
@@ -0,0 +1,144 @@
+#include "PackArchive.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "BlockCompression.h"
+
+namespace Assets
+{
+	PackArchive::PackArchive(const std::string& filename) : _file(filename)
+	{
+		const auto bytes = _file.getBytes();
+		if(bytes.size() < sizeof(PackHeader))
+			throw std::runtime_error("Failed to open pack: " + filename + " is too small.");
+
+		_header = reinterpret_cast<const PackHeader*>(bytes.data());
+		if(_header->magic != PACK_FILE_MAGIC || _header->version != PACK_FILE_VERSION)
+			throw std::runtime_error("Failed to open pack: " + filename + " isn't a version " + std::to_string(PACK_FILE_VERSION) + " pack.");
+
+		const auto isInside = [&bytes](const uint64_t offset, const uint64_t size)
+		{
+			return offset <= bytes.size() && size <= bytes.size() - offset;
+		};
+
+		const uint64_t tocBytes = static_cast<uint64_t>(_header->tocCapacity) * sizeof(PackEntry);
+		const uint64_t blockBytes = _header->blockCount * sizeof(PackBlock);
+
+		if(_header->tocCapacity == 0 || (_header->tocCapacity & (_header->tocCapacity - 1)) != 0 ||
+			_header->tocOffset % alignof(PackEntry) != 0 || !isInside(_header->tocOffset, tocBytes) ||
+			_header->blockTableOffset % alignof(PackBlock) != 0 || !isInside(_header->blockTableOffset, blockBytes) ||
+			!isInside(_header->nameTableOffset, _header->nameTableSize))
+		{
+			throw std::runtime_error("Failed to open pack: the tables of " + filename + " are outside of the file.");
+		}
+
+		_toc = {reinterpret_cast<const PackEntry*>(bytes.data() + _header->tocOffset), _header->tocCapacity};
+		_blocks = {reinterpret_cast<const PackBlock*>(bytes.data() + _header->blockTableOffset), _header->blockCount};
+		_names = {reinterpret_cast<const char*>(bytes.data() + _header->nameTableOffset), _header->nameTableSize};
+
+		// Validated once here, reads don't check again
+		uint32_t usedEntries = 0;
+		for(const auto& entry : _toc)
+		{
+			if(!(entry.flags & PACK_ENTRY_USED)) continue;
+			usedEntries++;
+
+			bool isValid = entry.firstBlock <= _blocks.size() && entry.blockCount <= _blocks.size() - entry.firstBlock &&
+				entry.nameOffset <= _names.size() && entry.nameLength <= _names.size() - entry.nameOffset;
+
+			uint64_t size = 0;
+			for(uint32_t i = 0; isValid && i < entry.blockCount; i++)
+			{
+				const auto& block = _blocks[entry.firstBlock + i];
+				// Only the last block may be short, blocks are found by their index
+				const bool isLast = i + 1 == entry.blockCount;
+				isValid = (isLast ? block.size <= PACK_BLOCK_SIZE : block.size == PACK_BLOCK_SIZE) &&
+					block.compressedSize <= block.size && isInside(block.offset, block.compressedSize);
+				size += block.size;
+			}
+
+			// Stored entries are viewed as one range, in place and aligned like a loose file
+			if(isValid && (entry.flags & PACK_ENTRY_STORED) && entry.blockCount != 0)
+			{
+				const uint64_t offset = _blocks[entry.firstBlock].offset;
+				isValid = offset % PACK_ENTRY_ALIGNMENT == 0 && isInside(offset, entry.size);
+			}
+
+			if(!isValid || size != entry.size)
+				throw std::runtime_error("Failed to open pack: an entry of " + filename + " is outside of the file.");
+		}
+
+		// find() stops at the first empty slot, a full table would never end a miss
+		if(usedEntries != _header->entryCount || usedEntries >= _toc.size())
+			throw std::runtime_error("Failed to open pack: the table of contents of " + filename + " is corrupt.");
+
+		_decompressionPool = std::make_unique<Core::ThreadPool>();
+
+		std::printf("Pack -> %s: %u entries\n", filename.c_str(), _header->entryCount);
+	}
+
+	const PackEntry* PackArchive::find(const std::string_view path) const
+	{
+		const uint64_t hash = hashPackPath(path);
+		const uint64_t mask = _toc.size() - 1;
+
+		for(uint64_t slot = hash & mask; ; slot = (slot + 1) & mask)
+		{
+			const auto& entry = _toc[slot];
+
+			// The table is never full, an empty slot ends the probe
+			if(!(entry.flags & PACK_ENTRY_USED)) return nullptr;
+
+			if(entry.pathHash == hash && _names.substr(entry.nameOffset, entry.nameLength) == path)
+				return &entry;
+		}
+	}
+
+	std::span<const std::byte> PackArchive::view(const PackEntry& entry) const
+	{
+		if(!(entry.flags & PACK_ENTRY_STORED)) return {};
+		if(entry.blockCount == 0) return _file.getBytes().subspan(0, 0);
+
+		return _file.getBytes().subspan(_blocks[entry.firstBlock].offset, entry.size);
+	}
+
+	void PackArchive::read(const PackEntry& entry, const std::span<std::byte> destination) const
+	{
+		if(destination.size() != entry.size)
+			throw std::runtime_error("Failed to read pack entry: the destination isn't the size of the entry.");
+
+		const auto bytes = _file.getBytes();
+		const auto blocks = _blocks.subspan(entry.firstBlock, entry.blockCount);
+
+		const auto decode = [&](const uint32_t index)
+		{
+			const auto& block = blocks[index];
+			const auto source = bytes.subspan(block.offset, block.compressedSize);
+			const auto target = destination.subspan(static_cast<size_t>(index) * PACK_BLOCK_SIZE, block.size);
+
+			if(block.compressedSize == block.size)
+				std::memcpy(target.data(), source.data(), block.size);
+			else
+				decompressBlock(source, target);
+		};
+
+		if(blocks.size() <= 1)
+		{
+			for(uint32_t i = 0; i < blocks.size(); i++) decode(i);
+			return;
+		}
+
+		_decompressionPool->parallelFor(static_cast<uint32_t>(blocks.size()), _decompressionPool->getThreadCount(),
+			[&](uint32_t, const uint32_t begin, const uint32_t end)
+			{
+				for(uint32_t i = begin; i < end; i++) decode(i);
+			});
+	}
+
+	uint32_t PackArchive::getEntryCount() const
+	{
+		return _header->entryCount;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <Core/ThreadPool.h>
+
+#include "MappedFile.h"
+#include "PackFormat.h"
+
+namespace Assets
+{
+	/**
+	 * Read-only view of a pack file (see PackFormat.h), the archive stays mapped while it lives
+	 */
+	class PackArchive
+	{
+	public:
+		/**
+		 * @param filename Pack to map, throws if it isn't a valid archive
+		 */
+		explicit PackArchive(const std::string& filename);
+
+		PackArchive(const PackArchive&) = delete;
+		PackArchive& operator=(const PackArchive&) = delete;
+
+		/**
+		 * @return Entry of the path, nullptr if the archive doesn't contain it
+		 */
+		[[nodiscard]] const PackEntry* find(std::string_view path) const;
+
+		/**
+		 * Data of an uncompressed entry, straight from the mapping (valid as long as the archive lives)
+		 * Empty if the entry has compressed blocks.
+		 */
+		[[nodiscard]] std::span<const std::byte> view(const PackEntry& entry) const;
+
+		/**
+		 * Decompresses every block of the entry, the blocks are decoded in parallel
+		 *
+		 * @param destination Sized to entry.size
+		 */
+		void read(const PackEntry& entry, std::span<std::byte> destination) const;
+
+		[[nodiscard]] uint32_t getEntryCount() const;
+
+	private:
+		MappedFile _file;
+
+		const PackHeader* _header = nullptr;
+		std::span<const PackEntry> _toc;
+		std::span<const PackBlock> _blocks;
+		std::string_view _names;
+
+		// Its own workers: loads already running on the asset workers wait on these
+		std::unique_ptr<Core::ThreadPool> _decompressionPool;
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Assets
+{
+	constexpr uint32_t PACK_FILE_MAGIC = 0x4B415045; // "EPAK"
+	constexpr uint32_t PACK_FILE_VERSION = 1;
+
+	/**
+	 * Entries are split into blocks of this size, compressed (and decompressed in parallel) independently
+	 */
+	constexpr uint32_t PACK_BLOCK_SIZE = 256 * 1024;
+
+	/**
+	 * Every entry starts at a multiple of this, so stored entries can be used in place like a mapped file
+	 */
+	constexpr uint64_t PACK_ENTRY_ALIGNMENT = 16;
+
+	/**
+	 * Archive the runtime reads assets from before falling back to loose files
+	 */
+	constexpr auto ASSET_PACK_PATH = "assets.pak";
+
+	enum PackEntryFlags : uint32_t
+	{
+		PACK_ENTRY_USED = 1 << 0,
+		// Every block is stored uncompressed, the data is contiguous
+		PACK_ENTRY_STORED = 1 << 1
+	};
+
+	/**
+	 * Slot of the table of contents, an open addressing hash table (linear probing) of the paths
+	 */
+	struct PackEntry
+	{
+		uint64_t pathHash;
+		uint64_t size;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+		uint32_t firstBlock;
+		uint32_t blockCount;
+		uint32_t flags;
+		uint32_t padding;
+	};
+
+	/**
+	 * A block is stored uncompressed when compressedSize == size
+	 */
+	struct PackBlock
+	{
+		uint64_t offset;
+		uint32_t compressedSize;
+		uint32_t size;
+	};
+
+	/**
+	 * header | entry data | block table | names | table of contents
+	 */
+	struct PackHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		uint32_t entryCount;
+		// Power of two
+		uint32_t tocCapacity;
+
+		uint64_t tocOffset;
+		uint64_t blockTableOffset;
+		uint64_t blockCount;
+		uint64_t nameTableOffset;
+		uint64_t nameTableSize;
+	};
+
+	static_assert(sizeof(PackEntry) == 40);
+	static_assert(sizeof(PackBlock) == 16);
+	static_assert(sizeof(PackHeader) == 56);
+
+	/**
+	 * FNV-1a of the path as written in the archive ('/' separated, relative to the runtime directory)
+	 */
+	constexpr uint64_t hashPackPath(const std::string_view path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for(const char character : path)
+		{
+			hash ^= static_cast<uint8_t>(character);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,147 @@
+#include "PackWriter.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "BlockCompression.h"
+
+namespace Assets
+{
+	namespace
+	{
+		uint64_t alignEntry(const uint64_t offset)
+		{
+			return (offset + PACK_ENTRY_ALIGNMENT - 1) / PACK_ENTRY_ALIGNMENT * PACK_ENTRY_ALIGNMENT;
+		}
+
+		std::vector<std::byte> readSource(const std::string& filename)
+		{
+			std::ifstream file(filename, std::ios::ate | std::ios::binary);
+			if(!file.is_open())
+				throw std::runtime_error("Failed to write pack: can't open " + filename + ".");
+
+			std::vector<std::byte> bytes(static_cast<size_t>(file.tellg()));
+			file.seekg(0, std::ios::beg);
+			file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+			return bytes;
+		}
+
+		void writePadding(std::ofstream& file, const uint64_t offset)
+		{
+			constexpr char zeros[PACK_ENTRY_ALIGNMENT] = {};
+			file.write(zeros, static_cast<std::streamsize>(alignEntry(offset) - offset));
+		}
+	}
+
+	void writePack(const std::string& filename, const std::vector<PackInput>& inputs)
+	{
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if(!file.is_open())
+			throw std::runtime_error("Failed to write pack: can't create " + filename + ".");
+
+		PackHeader header{};
+		header.magic = PACK_FILE_MAGIC;
+		header.version = PACK_FILE_VERSION;
+		header.entryCount = static_cast<uint32_t>(inputs.size());
+		// At most half full, probes stay short
+		header.tocCapacity = std::bit_ceil(std::max<uint32_t>(2 * header.entryCount, 1));
+
+		// Written again with the final offsets at the end
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		std::vector<PackEntry> toc(header.tocCapacity, PackEntry{});
+		std::vector<PackBlock> blocks;
+		std::string names;
+
+		uint64_t offset = sizeof(PackHeader);
+		uint64_t packedSize = 0;
+		uint64_t totalSize = 0;
+
+		std::vector<std::byte> compressed;
+		for(const auto& input : inputs)
+		{
+			const auto data = readSource(input.sourcePath);
+
+			writePadding(file, offset);
+			offset = alignEntry(offset);
+
+			PackEntry entry{};
+			entry.pathHash = hashPackPath(input.name);
+			entry.size = data.size();
+			entry.nameOffset = static_cast<uint32_t>(names.size());
+			entry.nameLength = static_cast<uint32_t>(input.name.size());
+			entry.firstBlock = static_cast<uint32_t>(blocks.size());
+			entry.flags = PACK_ENTRY_USED | PACK_ENTRY_STORED;
+
+			names += input.name;
+
+			for(size_t begin = 0; begin < data.size(); begin += PACK_BLOCK_SIZE)
+			{
+				const auto source = std::span(data).subspan(begin, std::min<size_t>(PACK_BLOCK_SIZE, data.size() - begin));
+				compressBlock(source, compressed);
+
+				PackBlock block{};
+				block.offset = offset;
+				block.size = static_cast<uint32_t>(source.size());
+
+				// Incompressible blocks (already compressed images, ...) are kept as they are
+				if(compressed.size() < source.size())
+				{
+					block.compressedSize = static_cast<uint32_t>(compressed.size());
+					file.write(reinterpret_cast<const char*>(compressed.data()), static_cast<std::streamsize>(compressed.size()));
+					entry.flags &= ~PACK_ENTRY_STORED;
+				}
+				else
+				{
+					block.compressedSize = block.size;
+					file.write(reinterpret_cast<const char*>(source.data()), static_cast<std::streamsize>(source.size()));
+				}
+
+				offset += block.compressedSize;
+				packedSize += block.compressedSize;
+				blocks.push_back(block);
+			}
+
+			entry.blockCount = static_cast<uint32_t>(blocks.size()) - entry.firstBlock;
+
+			uint64_t slot = entry.pathHash & (header.tocCapacity - 1);
+			while(toc[slot].flags & PACK_ENTRY_USED)
+			{
+				if(toc[slot].pathHash == entry.pathHash)
+					throw std::runtime_error("Failed to write pack: " + input.name + " collides with another entry.");
+				slot = (slot + 1) & (header.tocCapacity - 1);
+			}
+			toc[slot] = entry;
+
+			totalSize += data.size();
+		}
+
+		writePadding(file, offset);
+		header.blockTableOffset = alignEntry(offset);
+		header.blockCount = blocks.size();
+		file.write(reinterpret_cast<const char*>(blocks.data()), static_cast<std::streamsize>(blocks.size() * sizeof(PackBlock)));
+
+		header.nameTableOffset = header.blockTableOffset + blocks.size() * sizeof(PackBlock);
+		header.nameTableSize = names.size();
+		file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+		offset = header.nameTableOffset + names.size();
+		writePadding(file, offset);
+		header.tocOffset = alignEntry(offset);
+		file.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(PackEntry)));
+
+		file.seekp(0, std::ios::beg);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		if(!file)
+			throw std::runtime_error("Failed to write pack: " + filename + ".");
+
+		std::printf("Pack -> %s: %u entries, %llu KiB -> %llu KiB\n",
+			filename.c_str(), header.entryCount,
+			static_cast<unsigned long long>(totalSize / 1024), static_cast<unsigned long long>(packedSize / 1024));
+	}
+}
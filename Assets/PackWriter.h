@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PackFormat.h"
+
+namespace Assets
+{
+	struct PackInput
+	{
+		// Path the runtime asks for, e.g. "Shaders/shader.spv"
+		std::string name;
+		// File the data is read from
+		std::string sourcePath;
+	};
+
+	/**
+	 * Builds an archive, blocks that don't shrink are stored uncompressed
+	 *
+	 * @param filename Output path
+	 * @param inputs Files to pack, names must be unique
+	 */
+	void writePack(const std::string& filename, const std::vector<PackInput>& inputs);
+}
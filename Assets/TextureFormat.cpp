@@ -0,0 +1,121 @@
+#include "TextureFormat.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace Assets
+{
+	namespace
+	{
+		constexpr uint32_t TEXTURE_PIXEL_SIZE = 4;
+
+		uint64_t alignMip(const uint64_t offset)
+		{
+			return (offset + TEXTURE_MIP_ALIGNMENT - 1) / TEXTURE_MIP_ALIGNMENT * TEXTURE_MIP_ALIGNMENT;
+		}
+
+		/**
+		 * Averages 2x2 blocks (clamped at odd edges) of the previous mip
+		 */
+		std::vector<std::byte> downsample(
+			const std::vector<std::byte>& source, const uint32_t width, const uint32_t height,
+			const uint32_t mipWidth, const uint32_t mipHeight
+		)
+		{
+			std::vector<std::byte> mip(static_cast<size_t>(mipWidth) * mipHeight * TEXTURE_PIXEL_SIZE);
+
+			for(uint32_t y = 0; y < mipHeight; y++)
+			{
+				for(uint32_t x = 0; x < mipWidth; x++)
+				{
+					const uint32_t x0 = std::min(x * 2, width - 1);
+					const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+					const uint32_t y0 = std::min(y * 2, height - 1);
+					const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+
+					for(uint32_t channel = 0; channel < TEXTURE_PIXEL_SIZE; channel++)
+					{
+						const auto texel = [&](const uint32_t sx, const uint32_t sy)
+						{
+							return std::to_integer<uint32_t>(source[(static_cast<size_t>(sy) * width + sx) * TEXTURE_PIXEL_SIZE + channel]);
+						};
+
+						const uint32_t sum = texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1);
+						mip[(static_cast<size_t>(y) * mipWidth + x) * TEXTURE_PIXEL_SIZE + channel] = static_cast<std::byte>((sum + 2) / 4);
+					}
+				}
+			}
+
+			return mip;
+		}
+	}
+
+	void cookTexture(
+		const std::string& filename,
+		const std::span<const std::byte> pixels,
+		const uint32_t width,
+		const uint32_t height,
+		const TextureFileFormat format
+	)
+	{
+		if(width == 0 || height == 0 || pixels.size() != static_cast<size_t>(width) * height * TEXTURE_PIXEL_SIZE)
+			throw std::runtime_error("Failed to cook texture: the pixels don't match the size.");
+
+		std::vector<std::vector<std::byte>> mipData;
+		std::vector<TextureFileMip> mips;
+
+		mipData.emplace_back(pixels.begin(), pixels.end());
+		mips.push_back({0, pixels.size(), width, height});
+
+		while(mips.back().width > 1 || mips.back().height > 1)
+		{
+			const auto& previous = mips.back();
+			const uint32_t mipWidth = std::max(1u, previous.width / 2);
+			const uint32_t mipHeight = std::max(1u, previous.height / 2);
+
+			mipData.push_back(downsample(mipData.back(), previous.width, previous.height, mipWidth, mipHeight));
+			mips.push_back({0, mipData.back().size(), mipWidth, mipHeight});
+		}
+
+		TextureFileHeader header{};
+		header.magic = TEXTURE_FILE_MAGIC;
+		header.version = TEXTURE_FILE_VERSION;
+		header.format = format;
+		header.width = width;
+		header.height = height;
+		header.mipCount = static_cast<uint32_t>(mips.size());
+		header.mipTableOffset = sizeof(TextureFileHeader);
+
+		uint64_t offset = header.mipTableOffset + mips.size() * sizeof(TextureFileMip);
+		for(auto& mip : mips)
+		{
+			mip.offset = alignMip(offset);
+			offset = mip.offset + mip.size;
+		}
+
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		if(!file.is_open())
+			throw std::runtime_error("Failed to cook texture: can't open " + filename + ".");
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mips.data()), static_cast<std::streamsize>(mips.size() * sizeof(TextureFileMip)));
+
+		for(size_t i = 0; i < mips.size(); i++)
+		{
+			// Zero padding up to the aligned start of the mip
+			static constexpr char zeros[TEXTURE_MIP_ALIGNMENT] = {};
+			const auto position = static_cast<uint64_t>(file.tellp());
+			file.write(zeros, static_cast<std::streamsize>(mips[i].offset - position));
+			file.write(reinterpret_cast<const char*>(mipData[i].data()), static_cast<std::streamsize>(mipData[i].size()));
+		}
+
+		if(!file)
+			throw std::runtime_error("Failed to cook texture: writing " + filename + " failed.");
+
+		std::printf("Texture cooked -> %s: %ux%u, %u mips\n", filename.c_str(), width, height, header.mipCount);
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace Assets
+{
+	constexpr uint32_t TEXTURE_FILE_MAGIC = 0x58455445; // "ETEX"
+	constexpr uint32_t TEXTURE_FILE_VERSION = 1;
+
+	/**
+	 * Every mip starts at a multiple of this, so it can be copied to the GPU as is
+	 */
+	constexpr uint64_t TEXTURE_MIP_ALIGNMENT = 16;
+
+	enum class TextureFileFormat : uint32_t
+	{
+		Rgba8Srgb,
+		Rgba8Unorm
+	};
+
+	struct TextureFileMip
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	/**
+	 * Start of a cooked texture (.tex), the mip table follows the header and the mips follow the table,
+	 * largest first: header | mip table | mip 0 | mip 1 | ...
+	 */
+	struct TextureFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+
+		TextureFileFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipCount;
+
+		uint64_t mipTableOffset;
+	};
+
+	static_assert(sizeof(TextureFileMip) == 24);
+	static_assert(sizeof(TextureFileHeader) == 32);
+
+	/**
+	 * Writes a cooked texture with its full mip chain, every mip is box filtered from the previous one
+	 *
+	 * @param filename Output path
+	 * @param pixels RGBA8 pixels of mip 0, width * height * 4 bytes
+	 * @param width Width of mip 0
+	 * @param height Height of mip 0
+	 * @param format How the pixels are sampled
+	 */
+	void cookTexture(
+		const std::string& filename,
+		std::span<const std::byte> pixels,
+		uint32_t width,
+		uint32_t height,
+		TextureFileFormat format = TextureFileFormat::Rgba8Srgb
+	);
+}
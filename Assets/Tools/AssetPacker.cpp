@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "PackWriter.h"
+
+/**
+ * AssetPacker <output.pak> <root directory> <folders...>
+ *
+ * Packs every file under the folders, named by their path relative to the root ("Shaders/shader.spv")
+ */
+int main(const int argc, char** argv)
+{
+	if(argc < 4)
+	{
+		std::printf("Usage: %s <output.pak> <root directory> <folders...>\n", argv[0]);
+		return 1;
+	}
+
+	const std::filesystem::path root = argv[2];
+
+	std::vector<Assets::PackInput> inputs;
+	for(int i = 3; i < argc; i++)
+	{
+		const auto folder = root / argv[i];
+		if(!std::filesystem::is_directory(folder)) continue;
+
+		for(const auto& file : std::filesystem::recursive_directory_iterator(folder))
+		{
+			if(!file.is_regular_file()) continue;
+
+			inputs.push_back({
+				std::filesystem::relative(file.path(), root).generic_string(),
+				file.path().string()
+			});
+		}
+	}
+
+	// Same archive for the same files, whatever order the directories list them in
+	std::ranges::sort(inputs, {}, &Assets::PackInput::name);
+
+	try
+	{
+		Assets::writePack(argv[1], inputs);
+	}
+	catch(const std::exception& exception)
+	{
+		std::printf("%s\n", exception.what());
+		return 1;
+	}
+
+	return 0;
+}
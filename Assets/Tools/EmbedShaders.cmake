@@ -0,0 +1,58 @@
+# Generates the translation unit behind Assets::findEmbeddedShader: the SPIR-V of every shader as a constexpr
+# word array and a compile-time table over their names
+#
+# cmake -DSHADERS="a.spv|b.spv" -DOUTPUT=EmbeddedShaders.cpp -P EmbedShaders.cmake
+# (the list is '|' separated, a ';' wouldn't survive the custom command)
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(WORDS_PER_LINE 8)
+string(REPEAT "0x........u," ${WORDS_PER_LINE} LINE_PATTERN)
+
+set(ARRAYS "")
+set(ENTRIES "")
+set(SHADER_COUNT 0)
+
+foreach(SHADER ${SHADERS})
+    get_filename_component(NAME ${SHADER} NAME_WE)
+    string(MAKE_C_IDENTIFIER ${NAME} IDENTIFIER)
+
+    file(READ ${SHADER} HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR PARTIAL_WORD "${HEX_LENGTH} % 8")
+    if(HEX_LENGTH EQUAL 0 OR NOT PARTIAL_WORD EQUAL 0)
+        message(FATAL_ERROR "Failed to embed shader: ${SHADER} isn't SPIR-V.")
+    endif()
+
+    # SPIR-V is little endian words, the bytes of each are reversed into the literal
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u," WORDS "${HEX}")
+    string(REGEX REPLACE "(${LINE_PATTERN})" "\\1\n\t\t\t" WORDS "${WORDS}")
+    string(REPLACE "u,0x" "u, 0x" WORDS "${WORDS}")
+    string(STRIP "${WORDS}" WORDS)
+
+    string(APPEND ARRAYS "\t\talignas(16) constexpr uint32_t SPIRV_${IDENTIFIER}[] = {\n\t\t\t${WORDS}\n\t\t};\n\n")
+    string(APPEND ENTRIES "\t\t\tEmbeddedShader{\"${NAME}\", SPIRV_${IDENTIFIER}},\n")
+    math(EXPR SHADER_COUNT "${SHADER_COUNT} + 1")
+endforeach()
+
+file(WRITE ${OUTPUT}
+"// Generated by Assets/Tools/EmbedShaders.cmake from the compiled shaders, don't edit
+
+#include \"EmbeddedShaders.h\"
+
+namespace Assets
+{
+\tnamespace
+\t{
+${ARRAYS}\t\tconstexpr std::array<EmbeddedShader, ${SHADER_COUNT}> EMBEDDED_SHADERS = {
+${ENTRIES}\t\t};
+
+\t\tconstexpr auto EMBEDDED_SHADER_TABLE = buildEmbeddedShaderTable(EMBEDDED_SHADERS);
+\t}
+
+\tstd::span<const uint32_t> findEmbeddedShader(const std::string_view name)
+\t{
+\t\treturn findInEmbeddedShaderTable(EMBEDDED_SHADERS, EMBEDDED_SHADER_TABLE, name);
+\t}
+}
+")
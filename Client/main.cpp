@@ -1,15 +1,89 @@
 #include <iostream>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <span>
+#include <string>
+#include <string_view>
+#include <Core/FrameLimiter.h>
 #include <Core/Window.h>
 #include <Renderer/VulkanContext.h>
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include "UI/UiManager.h"
 
-int main()
+int main(int argc, char** argv)
 {
 	uint32_t frames = 0;
 	float timer = 0.0f;
 
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	// Renders this many frames offscreen and exits, 0 opens the window
+	uint32_t headlessFrames = 0;
+	// Copies of the quad drawn as one instanced batch
+	uint32_t instanceCount = 0;
+	// Cooked mesh loaded from Meshes/ instead of the built-in quad
+	std::string meshName;
+	// Writes the built-in quad as a cooked mesh to this path and exits
+	std::string cookPath;
+	// Cooked texture loaded from Textures/ and streamed at the window's size
+	std::string textureName;
+	// Writes a checkerboard as a cooked texture to this path and exits
+	std::string cookTexturePath;
+	// Rebuilds the pipelines when the shaders change
+	bool isHotReloadEnabled = false;
+	Renderer::PresentPolicy presentPolicy = Renderer::PresentPolicy::Mailbox;
+	// Frames per second the loop is paced to, 0 doesn't limit
+	double frameRateLimit = 0.0;
+	// Waits for the previous frame to be on screen before reading input
+	bool isPresentWaitEnabled = false;
+	// Segments of a wave rewritten every frame through dynamic geometry, 0 doesn't draw it
+	uint32_t waveSegments = 0;
+	// Capacity of the GPU particle fountain, 0 doesn't create it
+	uint32_t particleCount = 0;
+	for(int i = 1; i < argc; i++)
+	{
+		const std::string_view argument = argv[i];
+		if(argument == "--frames-in-flight" && i + 1 < argc)
+			framesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if(argument == "--headless" && i + 1 < argc)
+			headlessFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if(argument == "--instances" && i + 1 < argc)
+			instanceCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if(argument == "--mesh" && i + 1 < argc)
+			meshName = argv[++i];
+		else if(argument == "--cook-mesh" && i + 1 < argc)
+			cookPath = argv[++i];
+		else if(argument == "--texture" && i + 1 < argc)
+			textureName = argv[++i];
+		else if(argument == "--cook-texture" && i + 1 < argc)
+			cookTexturePath = argv[++i];
+		else if(argument == "--hot-reload")
+			isHotReloadEnabled = true;
+		else if(argument == "--present-mode" && i + 1 < argc)
+		{
+			const std::string_view mode = argv[++i];
+			if(mode == "immediate")
+				presentPolicy = Renderer::PresentPolicy::Immediate;
+			else if(mode == "mailbox")
+				presentPolicy = Renderer::PresentPolicy::Mailbox;
+			else if(mode == "fifo")
+				presentPolicy = Renderer::PresentPolicy::Fifo;
+			else if(mode == "fifo-relaxed")
+				presentPolicy = Renderer::PresentPolicy::FifoRelaxed;
+		}
+		else if(argument == "--fps-limit" && i + 1 < argc)
+			frameRateLimit = std::strtod(argv[++i], nullptr);
+		else if(argument == "--present-wait")
+			isPresentWaitEnabled = true;
+		else if(argument == "--dynamic" && i + 1 < argc)
+			waveSegments = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if(argument == "--particles" && i + 1 < argc)
+			particleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+	}
+
 	const std::vector<Renderer::Vertex> vertices = {
 		{{-0.9f, -0.9f}, {1.0f, 0.0f, 0.0f}},
 		{{0.9f, -0.9f}, {0.0f, 1.0f, 0.0f}},
@@ -17,13 +91,190 @@ int main()
 		{{-0.9f, 0.9f}, {1.0f, 1.0f, 1.0f}}
 	};
 
-	const std::vector<uint16_t> indices = {
+	const std::vector<uint32_t> indices = {
 		0, 1, 2, 2, 3, 0
 	};
 
-	const auto window = std::make_shared<Core::Window>();
+	if(!cookPath.empty())
+	{
+		// Meshlets and bounds are filled in by the cook, the indices are stored as 16 bit
+		const Assets::MeshFileSubmesh submesh = {.indexCount = static_cast<uint32_t>(indices.size())};
+
+		Assets::cookMesh(
+			cookPath,
+			std::as_bytes(std::span(vertices)),
+			sizeof(Renderer::Vertex),
+			offsetof(Renderer::Vertex, pos),
+			2,
+			std::as_bytes(std::span(indices)),
+			sizeof(uint32_t),
+			std::span(&submesh, 1)
+		);
+		return 0;
+	}
+
+	if(!cookTexturePath.empty())
+	{
+		constexpr uint32_t textureSize = 2048;
+		constexpr uint32_t checkerSize = 64;
+
+		std::vector<std::byte> pixels(textureSize * textureSize * 4);
+		for(uint32_t y = 0; y < textureSize; y++)
+		{
+			for(uint32_t x = 0; x < textureSize; x++)
+			{
+				const bool isLight = ((x / checkerSize) + (y / checkerSize)) % 2 == 0;
+				const auto value = static_cast<std::byte>(isLight ? 230 : 25);
+				std::byte* pixel = pixels.data() + (static_cast<size_t>(y) * textureSize + x) * 4;
+				pixel[0] = value;
+				pixel[1] = value;
+				pixel[2] = value;
+				pixel[3] = std::byte{255};
+			}
+		}
+
+		Assets::cookTexture(cookTexturePath, pixels, textureSize, textureSize);
+		return 0;
+	}
+
 	const auto vkContext = std::make_shared<Renderer::VulkanContext>();
 
+	vkContext->setFramesInFlight(framesInFlight);
+	vkContext->setPresentPolicy(presentPolicy);
+	if(meshName.empty())
+		vkContext->fillVertices(vertices, indices);
+	else
+		vkContext->setMesh(Assets::AssetManager::load<Assets::AssetType::Mesh>(meshName));
+
+	if(instanceCount > 0)
+	{
+		// Square grid of small quads over the first one
+		const auto gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+		const float spacing = 2.0f / static_cast<float>(gridSize);
+
+		std::vector<Renderer::InstanceData> instances;
+		instances.reserve(instanceCount);
+		for(uint32_t i = 0; i < instanceCount; i++)
+		{
+			const glm::vec3 position(
+				-1.0f + spacing * (static_cast<float>(i % gridSize) + 0.5f),
+				-1.0f + spacing * (static_cast<float>(i / gridSize) + 0.5f),
+				0.01f
+			);
+			const glm::mat4 model = glm::scale(
+				glm::translate(glm::mat4(1.0f), position),
+				glm::vec3(spacing * 0.4f)
+			);
+			const float shade = static_cast<float>(i) / static_cast<float>(instanceCount);
+			instances.push_back({model, {shade, 1.0f - shade, 1.0f, 1.0f}});
+		}
+
+		vkContext->addInstanceBatch(0, instances);
+	}
+
+	// Loaded while Vulkan initializes
+	Assets::AssetHandle<Assets::AssetType::Texture> textureLoad;
+	if(!textureName.empty())
+		textureLoad = Assets::AssetManager::loadAsync<Assets::AssetType::Texture>(textureName);
+
+	Renderer::TextureId texture = Renderer::INVALID_TEXTURE;
+	const auto addTexture = [&]
+	{
+		if(textureLoad.isValid())
+			texture = vkContext->getTextureStreamer().addTexture(textureLoad.get());
+	};
+	// The texture belongs to the quad, its bounding sphere (the quad spins around the origin) sizes the request
+	const float quadRadius = std::sqrt(2.0f) * 0.9f;
+	const auto requestTexture = [&]
+	{
+		if(texture != Renderer::INVALID_TEXTURE)
+			vkContext->getTextureStreamer().requestSize(texture, vkContext->getProjectedSize(glm::vec3(0.0f), quadRadius));
+	};
+
+	// The indices are written once, the vertices every frame
+	Renderer::DynamicGeometry* wave = nullptr;
+	std::vector<Renderer::SceneVertexLayout::Packed> waveVertices;
+	const auto createWave = [&]
+	{
+		if(waveSegments == 0) return;
+
+		wave = &vkContext->createDynamicGeometry((waveSegments + 1) * 2, waveSegments * 6);
+		waveVertices.resize((waveSegments + 1) * 2);
+
+		std::vector<uint32_t> waveIndices;
+		waveIndices.reserve(waveSegments * 6);
+		for(uint32_t i = 0; i < waveSegments; i++)
+		{
+			const uint32_t corner = i * 2;
+			waveIndices.insert(waveIndices.end(), {corner, corner + 2, corner + 3, corner + 3, corner + 1, corner});
+		}
+
+		wave->writeIndices(0, waveIndices);
+		wave->setIndexCount(static_cast<uint32_t>(waveIndices.size()));
+	};
+	const auto updateWave = [&](const float time)
+	{
+		if(!wave) return;
+
+		for(uint32_t i = 0; i <= waveSegments; i++)
+		{
+			const float x = -0.9f + 1.8f * static_cast<float>(i) / static_cast<float>(waveSegments);
+			const float y = 0.2f * std::sin(x * 6.0f + time * 3.0f);
+			const glm::vec3 color(0.5f + 0.5f * std::sin(x * 3.0f + time), 0.8f, 1.0f);
+
+			waveVertices[i * 2] = Renderer::Vertex{{x, y - 0.03f}, color}.pack();
+			waveVertices[i * 2 + 1] = Renderer::Vertex{{x, y + 0.03f}, color}.pack();
+		}
+
+		wave->writeVertices(0, std::span<const Renderer::SceneVertexLayout::Packed>(waveVertices));
+	};
+
+	// Emits as fast as the particles die, so the capacity stays about full
+	const auto createParticles = [&]
+	{
+		if(particleCount == 0) return;
+
+		auto& particles = vkContext->createParticleSystem(particleCount);
+
+		Renderer::ParticleEmitterSettings emitter = particles.getEmitter();
+		emitter.particlesPerSecond = static_cast<float>(particleCount) / emitter.lifetime;
+		particles.setEmitter(emitter);
+	};
+
+	if(headlessFrames > 0)
+	{
+		vkContext->InitializeHeadless({800, 600});
+		addTexture();
+		createWave();
+		createParticles();
+
+		const auto benchmarkStart = std::chrono::steady_clock::now();
+		for(uint32_t i = 0; i < headlessFrames; i++)
+		{
+			requestTexture();
+			updateWave(static_cast<float>(i) / 60.0f);
+			vkContext->drawFrame();
+		}
+		vkContext->waitIdle();
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - benchmarkStart).count();
+		const auto pacing = vkContext->getFramePacingStats();
+
+		printf(
+			"Headless: %u frames in %.3f s, FPS: %f, CPU wait on GPU avg %.3f ms, max %.3f ms\n",
+			headlessFrames,
+			seconds,
+			headlessFrames / seconds,
+			pacing.totalWaitMs / static_cast<double>(pacing.frameCount),
+			pacing.maxWaitMs
+		);
+		vkContext->getGpuProfiler().printStats();
+
+		vkContext->Cleanup();
+		return 0;
+	}
+
+	const auto window = std::make_shared<Core::Window>();
 	const auto uiManager = std::make_shared<UI::UIManager>();
 
 	window->create({800, 600, "Endura"});
@@ -32,9 +283,18 @@ int main()
 	uiManager->initImGUI(vkContext);
 
 
-	vkContext->fillVertices(vertices, indices);
 	vkContext->InitializeVulkan(window->getGLFWWindow());
+	addTexture();
+	createWave();
+	createParticles();
+
+	if(isHotReloadEnabled)
+		vkContext->enableShaderHotReload();
+
+	if(isPresentWaitEnabled && !vkContext->isPresentWaitSupported())
+		printf("Present wait isn't supported, frames are only paced by the limiter and the swapchain\n");
 
+	Core::FrameLimiter frameLimiter(frameRateLimit);
 
 	while(true)
 	{
@@ -42,7 +302,13 @@ int main()
 		{
 			const double timeStart = glfwGetTime();
 
+			// Both block before the input is read, the frame is built from the freshest input
+			frameLimiter.wait();
+			if(isPresentWaitEnabled) vkContext->waitForPresent();
+
 			window->pollEvents();
+			requestTexture();
+			updateWave(static_cast<float>(timeStart));
 			vkContext->drawFrame();
 			frames++;
 
@@ -51,6 +317,33 @@ int main()
 			if(timer >= 1.0f)
 			{
 				printf("FPS: %f\n", frames / timer);
+
+				const auto pacing = vkContext->getFramePacingStats();
+				if(pacing.frameCount > 0)
+					printf(
+						"CPU wait on GPU (%u frames in flight): avg %.3f ms, max %.3f ms\n",
+						vkContext->getFramesInFlight(),
+						pacing.totalWaitMs / static_cast<double>(pacing.frameCount),
+						pacing.maxWaitMs
+					);
+				vkContext->resetFramePacingStats();
+
+				vkContext->getGpuProfiler().printStats();
+				vkContext->getGpuProfiler().resetStats();
+
+				if(texture != Renderer::INVALID_TEXTURE)
+				{
+					const auto streaming = vkContext->getTextureStreamer().getStats();
+					printf(
+						"Textures: %u, resident %.2f / %.2f MB, mip %u, %llu mips streamed, %llu evicted\n",
+						streaming.textureCount,
+						static_cast<double>(streaming.residentBytes) / (1024.0 * 1024.0),
+						static_cast<double>(streaming.budgetBytes) / (1024.0 * 1024.0),
+						vkContext->getTextureStreamer().getResidentMip(texture),
+						static_cast<unsigned long long>(streaming.streamedMips),
+						static_cast<unsigned long long>(streaming.evictedMips)
+					);
+				}
 				timer = 0.0f;
 				frames = 0;
 			}
@@ -0,0 +1,65 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace Core
+{
+    FileWatcher::FileWatcher()
+    {
+        _descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_descriptor < 0)
+            throw std::runtime_error("Failed to create file watcher: inotify_init1 failed.");
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        close(_descriptor);
+    }
+
+    void FileWatcher::watch(const std::string& directory)
+    {
+        // Editors and compilers either write the file in place or move a temporary file over it
+        const int watch = inotify_add_watch(_descriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch < 0)
+            throw std::runtime_error("Failed to watch directory: inotify_add_watch failed for " + directory + ".");
+
+        _directories.emplace_back(watch, directory);
+    }
+
+    std::vector<std::string> FileWatcher::poll(const int timeoutMs)
+    {
+        std::vector<std::string> changedFiles;
+
+        pollfd descriptor{_descriptor, POLLIN, 0};
+        if (::poll(&descriptor, 1, timeoutMs) <= 0)
+            return changedFiles;
+
+        alignas(inotify_event) char buffer[4096];
+        while (true)
+        {
+            const ssize_t size = read(_descriptor, buffer, sizeof(buffer));
+            if (size <= 0) break;
+
+            for (ssize_t offset = 0; offset < size;)
+            {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                if (event->len == 0) continue;
+
+                const auto directory = std::ranges::find(_directories, event->wd, &std::pair<int, std::string>::first);
+                if (directory == _directories.end()) continue;
+
+                std::string path = directory->second + "/" + event->name;
+                if (std::ranges::find(changedFiles, path) == changedFiles.end())
+                    changedFiles.push_back(std::move(path));
+            }
+        }
+
+        return changedFiles;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Core
+{
+    /**
+     * Reports files written in a set of directories (inotify, not recursive).
+     */
+    class FileWatcher
+    {
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        /**
+         * Starts watching a directory, throws if it doesn't exist.
+         *
+         * @param directory Directory whose files are reported
+         */
+        void watch(const std::string& directory);
+
+        /**
+         * Waits for changes.
+         *
+         * @param timeoutMs Longest wait, 0 only collects the changes already queued
+         * @return Paths ("directory/name") of the files closed after writing or moved into a directory since the last call
+         */
+        [[nodiscard]] std::vector<std::string> poll(int timeoutMs);
+
+    private:
+        int _descriptor = -1;
+
+        // Watch descriptor -> directory
+        std::vector<std::pair<int, std::string>> _directories;
+    };
+}
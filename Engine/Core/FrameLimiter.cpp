@@ -0,0 +1,66 @@
+#include "FrameLimiter.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace Core
+{
+    namespace
+    {
+        // Sleeps are issued in slices of this so the overshoot is measured often
+        constexpr auto SLEEP_SLICE = std::chrono::milliseconds(1);
+
+        constexpr auto MAX_SLEEP_OVERSHOOT = std::chrono::milliseconds(4);
+    }
+
+    FrameLimiter::FrameLimiter(const double framesPerSecond)
+    {
+        setFrameRate(framesPerSecond);
+    }
+
+    void FrameLimiter::setFrameRate(const double framesPerSecond)
+    {
+        _framesPerSecond = std::max(framesPerSecond, 0.0);
+        _period = _framesPerSecond > 0.0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _framesPerSecond))
+            : Clock::duration::zero();
+        _deadline = Clock::time_point{};
+    }
+
+    double FrameLimiter::getFrameRate() const
+    {
+        return _framesPerSecond;
+    }
+
+    void FrameLimiter::wait()
+    {
+        if (_period == Clock::duration::zero())
+            return;
+
+        const auto now = Clock::now();
+        if (_deadline == Clock::time_point{} || now - _deadline > _period)
+        {
+            _deadline = now + _period;
+            return;
+        }
+
+        while (_deadline - Clock::now() > _sleepOvershoot + SLEEP_SLICE)
+        {
+            const auto sleepStart = Clock::now();
+            std::this_thread::sleep_for(SLEEP_SLICE);
+
+            // Decays slowly so one late wake up doesn't turn the rest of the run into spinning
+            const auto overshoot = Clock::now() - sleepStart - SLEEP_SLICE;
+            _sleepOvershoot = std::clamp(
+                std::max<Clock::duration>(overshoot, _sleepOvershoot * 15 / 16),
+                Clock::duration(std::chrono::microseconds(50)),
+                Clock::duration(MAX_SLEEP_OVERSHOOT)
+            );
+        }
+
+        while (Clock::now() < _deadline)
+            std::this_thread::yield();
+
+        _deadline += _period;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+
+namespace Core
+{
+    /**
+     * Paces a loop to a frame rate: sleeps while the deadline is far and spins the last stretch,
+     * since a sleep can wake up well after it was asked to.
+     */
+    class FrameLimiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @param framesPerSecond Target rate, 0 doesn't limit
+         */
+        explicit FrameLimiter(double framesPerSecond = 0.0);
+
+        /**
+         * @param framesPerSecond Target rate, 0 doesn't limit
+         */
+        void setFrameRate(double framesPerSecond);
+
+        [[nodiscard]] double getFrameRate() const;
+
+        /**
+         * Blocks until the next frame is due. The deadlines keep a fixed cadence, a frame that ran late
+         * only moves them when it missed a whole period (no burst of catch-up frames).
+         */
+        void wait();
+
+    private:
+        double _framesPerSecond = 0.0;
+        Clock::duration _period{};
+        Clock::time_point _deadline{};
+
+        // Longest a sleep overshot recently, the spin covers this much before the deadline
+        Clock::duration _sleepOvershoot = std::chrono::microseconds(200);
+    };
+}
@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace Core
+{
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        _workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+            _workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(_mutex);
+            _isStopping = true;
+        }
+        _condition.notify_all();
+
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    void ThreadPool::parallelFor(const uint32_t count, const uint32_t taskCount,
+                                 const std::function<void(uint32_t, uint32_t, uint32_t)>& job)
+    {
+        if (count == 0) return;
+
+        const uint32_t tasks = std::clamp(taskCount, 1u, count);
+        const uint32_t itemsPerTask = (count + tasks - 1) / tasks;
+
+        std::vector<std::future<void>> futures;
+        futures.reserve(tasks);
+
+        for (uint32_t task = 0; task < tasks; task++)
+        {
+            const uint32_t begin = task * itemsPerTask;
+            const uint32_t end = std::min(count, begin + itemsPerTask);
+            if (begin >= end) break;
+
+            futures.push_back(submit([&job, task, begin, end] { job(task, begin, end); }));
+        }
+
+        // Every range has to finish before returning, they all reference job and whatever it captured
+        std::exception_ptr firstError;
+        for (auto& future : futures)
+        {
+            try
+            {
+                future.get();
+            }
+            catch (...)
+            {
+                if (!firstError) firstError = std::current_exception();
+            }
+        }
+
+        if (firstError) std::rethrow_exception(firstError);
+    }
+
+    uint32_t ThreadPool::getThreadCount() const
+    {
+        return static_cast<uint32_t>(_workers.size());
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(_mutex);
+                _condition.wait(lock, [this] { return _isStopping || !_jobs.empty(); });
+
+                if (_isStopping && _jobs.empty()) return;
+
+                job = std::move(_jobs.front());
+                _jobs.pop();
+            }
+
+            job();
+        }
+    }
+}
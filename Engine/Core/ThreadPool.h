@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Core
+{
+    /**
+     * Fixed set of worker threads consuming a shared FIFO of jobs.
+     */
+    class ThreadPool
+    {
+    public:
+        /**
+         * @param threadCount Number of workers, 0 picks hardware concurrency minus the calling thread
+         */
+        explicit ThreadPool(uint32_t threadCount = 0);
+
+        /**
+         * Finishes the queued jobs and joins the workers.
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * Queues a job.
+         *
+         * @param job Callable without arguments
+         * @return Future with the result of the job (exceptions are forwarded through it)
+         */
+        template <typename F>
+        auto submit(F&& job) -> std::future<std::invoke_result_t<F>>
+        {
+            using Result = std::invoke_result_t<F>;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+            auto future = task->get_future();
+
+            {
+                std::lock_guard lock(_mutex);
+                _jobs.emplace([task] { (*task)(); });
+            }
+            _condition.notify_one();
+
+            return future;
+        }
+
+        /**
+         * Splits [0, count) into at most taskCount contiguous ranges and runs them on the workers,
+         * blocking until every range is done. The first exception of a range is rethrown once all of them finished.
+         *
+         * @param count Number of items
+         * @param taskCount Maximum number of ranges
+         * @param job Called with (task index, begin, end)
+         */
+        void parallelFor(uint32_t count, uint32_t taskCount,
+                         const std::function<void(uint32_t, uint32_t, uint32_t)>& job);
+
+        /**
+         * @return Number of worker threads.
+         */
+        [[nodiscard]] uint32_t getThreadCount() const;
+
+    private:
+        std::vector<std::thread> _workers;
+        std::queue<std::function<void()>> _jobs;
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+
+        bool _isStopping = false;
+
+        void workerLoop();
+    };
+}
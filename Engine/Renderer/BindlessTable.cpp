@@ -0,0 +1,248 @@
+#include "BindlessTable.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace Renderer
+{
+	namespace
+	{
+		constexpr vk::ShaderStageFlags BINDLESS_SHADER_STAGES =
+			vk::ShaderStageFlagBits::eVertex |
+			vk::ShaderStageFlagBits::eFragment |
+			vk::ShaderStageFlagBits::eCompute;
+	}
+
+	BindlessTable::BindlessTable(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device)
+		: _device(device)
+	{
+		const auto properties = physicalDevice.getProperties2<
+			vk::PhysicalDeviceProperties2,
+			vk::PhysicalDeviceVulkan12Properties
+		>();
+		const auto& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+
+		// Every stage sees the whole set, so the per stage limits are the ones that bind
+		_handles[BINDLESS_STORAGE_BUFFER_BINDING].capacity = std::min(
+			BINDLESS_MAX_STORAGE_BUFFERS,
+			limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers
+		);
+		_handles[BINDLESS_SAMPLED_IMAGE_BINDING].capacity = std::min(
+			BINDLESS_MAX_SAMPLED_IMAGES,
+			limits.maxPerStageDescriptorUpdateAfterBindSampledImages
+		);
+		_handles[BINDLESS_SAMPLER_BINDING].capacity = std::min(
+			BINDLESS_MAX_SAMPLERS,
+			limits.maxPerStageDescriptorUpdateAfterBindSamplers
+		);
+
+		const auto bindings = getLayoutBindings();
+
+		// Unused slots stay unwritten, free slots can be written while the set is bound by frames in flight
+		constexpr vk::DescriptorBindingFlags bindingFlag =
+			vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+			vk::DescriptorBindingFlagBits::ePartiallyBound |
+			vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+		const std::array<vk::DescriptorBindingFlags, 3> bindingFlags = {bindingFlag, bindingFlag, bindingFlag};
+
+		const vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo(
+			static_cast<uint32_t>(bindingFlags.size()),
+			bindingFlags.data()
+		);
+
+		const vk::DescriptorSetLayoutCreateInfo layoutInfo(
+			vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+			static_cast<uint32_t>(bindings.size()),
+			bindings.data(),
+			&bindingFlagsInfo
+		);
+		_layout = vk::raii::DescriptorSetLayout(_device, layoutInfo);
+
+		const vk::DescriptorPoolSize poolSizes[] = {
+			{vk::DescriptorType::eStorageBuffer, _handles[BINDLESS_STORAGE_BUFFER_BINDING].capacity},
+			{vk::DescriptorType::eSampledImage, _handles[BINDLESS_SAMPLED_IMAGE_BINDING].capacity},
+			{vk::DescriptorType::eSampler, _handles[BINDLESS_SAMPLER_BINDING].capacity}
+		};
+
+		const vk::DescriptorPoolCreateInfo poolInfo(
+			vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet | vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+			1,
+			3,
+			poolSizes
+		);
+		_pool = vk::raii::DescriptorPool(_device, poolInfo);
+
+		const vk::DescriptorSetAllocateInfo allocInfo(
+			_pool,
+			1,
+			&*_layout
+		);
+		_set = std::move(_device.allocateDescriptorSets(allocInfo).front());
+
+		std::printf(
+			"Bindless table -> %u storage buffers, %u sampled images, %u samplers\n",
+			_handles[BINDLESS_STORAGE_BUFFER_BINDING].capacity,
+			_handles[BINDLESS_SAMPLED_IMAGE_BINDING].capacity,
+			_handles[BINDLESS_SAMPLER_BINDING].capacity
+		);
+	}
+
+	BindlessHandle BindlessTable::addStorageBuffer(
+		const vk::Buffer buffer, const vk::DeviceSize offset, const vk::DeviceSize range
+	)
+	{
+		const BindlessHandle handle = allocateHandle(BINDLESS_STORAGE_BUFFER_BINDING);
+
+		const vk::DescriptorBufferInfo bufferInfo(buffer, offset, range);
+		const vk::WriteDescriptorSet descriptorWrite(
+			*_set,
+			BINDLESS_STORAGE_BUFFER_BINDING,
+			handle,
+			1,
+			vk::DescriptorType::eStorageBuffer,
+			{},
+			&bufferInfo
+		);
+		_device.updateDescriptorSets(descriptorWrite, {});
+
+		return handle;
+	}
+
+	BindlessHandle BindlessTable::addSampledImage(const vk::ImageView view, const vk::ImageLayout layout)
+	{
+		const BindlessHandle handle = allocateHandle(BINDLESS_SAMPLED_IMAGE_BINDING);
+		writeImage(handle, view, layout);
+		return handle;
+	}
+
+	BindlessHandle BindlessTable::addSampler(const vk::Sampler sampler)
+	{
+		const BindlessHandle handle = allocateHandle(BINDLESS_SAMPLER_BINDING);
+
+		const vk::DescriptorImageInfo imageInfo(sampler, {}, vk::ImageLayout::eUndefined);
+		const vk::WriteDescriptorSet descriptorWrite(
+			*_set,
+			BINDLESS_SAMPLER_BINDING,
+			handle,
+			1,
+			vk::DescriptorType::eSampler,
+			&imageInfo
+		);
+		_device.updateDescriptorSets(descriptorWrite, {});
+
+		return handle;
+	}
+
+	void BindlessTable::updateSampledImage(
+		const BindlessHandle handle, const vk::ImageView view, const vk::ImageLayout layout
+	)
+	{
+		writeImage(handle, view, layout);
+	}
+
+	void BindlessTable::writeImage(const BindlessHandle handle, const vk::ImageView view, const vk::ImageLayout layout) const
+	{
+		const vk::DescriptorImageInfo imageInfo({}, view, layout);
+		const vk::WriteDescriptorSet descriptorWrite(
+			*_set,
+			BINDLESS_SAMPLED_IMAGE_BINDING,
+			handle,
+			1,
+			vk::DescriptorType::eSampledImage,
+			&imageInfo
+		);
+		_device.updateDescriptorSets(descriptorWrite, {});
+	}
+
+	void BindlessTable::removeStorageBuffer(const BindlessHandle handle, const uint64_t lastUsedFrame)
+	{
+		retireHandle(BINDLESS_STORAGE_BUFFER_BINDING, handle, lastUsedFrame);
+	}
+
+	void BindlessTable::removeSampledImage(const BindlessHandle handle, const uint64_t lastUsedFrame)
+	{
+		retireHandle(BINDLESS_SAMPLED_IMAGE_BINDING, handle, lastUsedFrame);
+	}
+
+	void BindlessTable::removeSampler(const BindlessHandle handle, const uint64_t lastUsedFrame)
+	{
+		retireHandle(BINDLESS_SAMPLER_BINDING, handle, lastUsedFrame);
+	}
+
+	void BindlessTable::reclaim(const uint64_t completedFrameNumber)
+	{
+		std::lock_guard lock(_mutex);
+
+		for(auto& handles : _handles)
+		{
+			while(!handles.retired.empty() && handles.retired.front().first <= completedFrameNumber)
+			{
+				handles.free.push_back(handles.retired.front().second);
+				handles.retired.pop_front();
+			}
+		}
+	}
+
+	const vk::raii::DescriptorSetLayout& BindlessTable::getLayout() const
+	{
+		return _layout;
+	}
+
+	std::vector<vk::DescriptorSetLayoutBinding> BindlessTable::getLayoutBindings() const
+	{
+		return {
+			vk::DescriptorSetLayoutBinding(
+				BINDLESS_STORAGE_BUFFER_BINDING,
+				vk::DescriptorType::eStorageBuffer,
+				_handles[BINDLESS_STORAGE_BUFFER_BINDING].capacity,
+				BINDLESS_SHADER_STAGES
+			),
+			vk::DescriptorSetLayoutBinding(
+				BINDLESS_SAMPLED_IMAGE_BINDING,
+				vk::DescriptorType::eSampledImage,
+				_handles[BINDLESS_SAMPLED_IMAGE_BINDING].capacity,
+				BINDLESS_SHADER_STAGES
+			),
+			vk::DescriptorSetLayoutBinding(
+				BINDLESS_SAMPLER_BINDING,
+				vk::DescriptorType::eSampler,
+				_handles[BINDLESS_SAMPLER_BINDING].capacity,
+				BINDLESS_SHADER_STAGES
+			)
+		};
+	}
+
+	void BindlessTable::bind(
+		const vk::raii::CommandBuffer& commandBuffer, const vk::PipelineBindPoint bindPoint, const vk::PipelineLayout layout
+	) const
+	{
+		commandBuffer.bindDescriptorSets(bindPoint, layout, 0, *_set, {});
+	}
+
+	BindlessHandle BindlessTable::allocateHandle(const uint32_t binding)
+	{
+		std::lock_guard lock(_mutex);
+
+		auto& handles = _handles[binding];
+		if(!handles.free.empty())
+		{
+			const BindlessHandle handle = handles.free.back();
+			handles.free.pop_back();
+			return handle;
+		}
+
+		if(handles.next >= handles.capacity)
+			throw std::runtime_error("Failed to add bindless resource: the descriptor array is full.");
+
+		return handles.next++;
+	}
+
+	void BindlessTable::retireHandle(const uint32_t binding, const BindlessHandle handle, const uint64_t lastUsedFrame)
+	{
+		if(handle == INVALID_BINDLESS_HANDLE) return;
+
+		std::lock_guard lock(_mutex);
+		_handles[binding].retired.emplace_back(lastUsedFrame, handle);
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer
+{
+	/**
+	 * Index of a resource inside its bindless array, what shaders receive through push constants
+	 */
+	using BindlessHandle = uint32_t;
+
+	constexpr BindlessHandle INVALID_BINDLESS_HANDLE = UINT32_MAX;
+
+	/**
+	 * Bindings of the bindless set (set 0), the arrays are clamped to the device limits
+	 */
+	constexpr uint32_t BINDLESS_STORAGE_BUFFER_BINDING = 0;
+	constexpr uint32_t BINDLESS_SAMPLED_IMAGE_BINDING = 1;
+	constexpr uint32_t BINDLESS_SAMPLER_BINDING = 2;
+
+	constexpr uint32_t BINDLESS_MAX_STORAGE_BUFFERS = 16384;
+	constexpr uint32_t BINDLESS_MAX_SAMPLED_IMAGES = 16384;
+	constexpr uint32_t BINDLESS_MAX_SAMPLERS = 256;
+
+	/**
+	 * One descriptor set of large update-after-bind arrays that holds every buffer, image and sampler.
+	 * It's bound once per command buffer, draws only push the handles they use. Descriptors are written once
+	 * when a resource is added, removed handles are only reused after the frames that could use them completed.
+	 */
+	class BindlessTable
+	{
+	public:
+		/**
+		 * @param physicalDevice Used for the descriptor indexing limits
+		 * @param device Logical device (with the descriptor indexing features enabled)
+		 */
+		BindlessTable(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device);
+		~BindlessTable() = default;
+
+		BindlessTable(const BindlessTable&) = delete;
+		BindlessTable& operator=(const BindlessTable&) = delete;
+
+		/**
+		 * @return Handle of the range, addressed in bytes by the shaders
+		 */
+		BindlessHandle addStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = vk::WholeSize);
+
+		BindlessHandle addSampledImage(vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		BindlessHandle addSampler(vk::Sampler sampler);
+
+		/**
+		 * Points an existing handle to another resource (e.g. a texture that streamed in a new mip)
+		 * The old resource may still be read by frames in flight, it has to outlive them.
+		 */
+		void updateSampledImage(BindlessHandle handle, vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		/**
+		 * Frees the handles, they are reused once the frame is completed
+		 *
+		 * @param lastUsedFrame Last frame number that may read the handle
+		 */
+		void removeStorageBuffer(BindlessHandle handle, uint64_t lastUsedFrame);
+		void removeSampledImage(BindlessHandle handle, uint64_t lastUsedFrame);
+		void removeSampler(BindlessHandle handle, uint64_t lastUsedFrame);
+
+		/**
+		 * Makes the handles removed up to the frame available again
+		 *
+		 * @param completedFrameNumber Last frame number the GPU has finished
+		 */
+		void reclaim(uint64_t completedFrameNumber);
+
+		[[nodiscard]] const vk::raii::DescriptorSetLayout& getLayout() const;
+
+		/**
+		 * @return Bindings the layout was created with, what shaders are checked against
+		 */
+		[[nodiscard]] std::vector<vk::DescriptorSetLayoutBinding> getLayoutBindings() const;
+
+		/**
+		 * Binds the set at index 0 of the layout
+		 */
+		void bind(const vk::raii::CommandBuffer& commandBuffer, vk::PipelineBindPoint bindPoint, vk::PipelineLayout layout) const;
+
+	private:
+		/**
+		 * Handle allocation of one binding
+		 */
+		struct HandleArray
+		{
+			uint32_t capacity = 0;
+			uint32_t next = 0;
+			std::vector<BindlessHandle> free;
+			std::deque<std::pair<uint64_t, BindlessHandle>> retired;
+		};
+
+		const vk::raii::Device& _device;
+
+		vk::raii::DescriptorSetLayout _layout = VK_NULL_HANDLE;
+		vk::raii::DescriptorPool _pool = VK_NULL_HANDLE;
+		vk::raii::DescriptorSet _set = VK_NULL_HANDLE;
+
+		std::array<HandleArray, 3> _handles;
+
+		std::mutex _mutex;
+
+		BindlessHandle allocateHandle(uint32_t binding);
+
+		void retireHandle(uint32_t binding, BindlessHandle handle, uint64_t lastUsedFrame);
+
+		void writeImage(BindlessHandle handle, vk::ImageView view, vk::ImageLayout layout) const;
+	};
+}
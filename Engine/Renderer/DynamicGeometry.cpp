@@ -0,0 +1,206 @@
+#include "DynamicGeometry.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Renderer
+{
+	namespace
+	{
+		vk::raii::Buffer createBuffer(
+			const vk::raii::Device& device, const vk::DeviceSize size, const vk::BufferUsageFlags usage
+		)
+		{
+			// Only the graphics queue touches them: the copies are recorded into the frame's command buffer
+			const vk::BufferCreateInfo bufferInfo({}, size, usage | vk::BufferUsageFlagBits::eTransferDst);
+			return {device, bufferInfo};
+		}
+	}
+
+	DynamicGeometry::DynamicGeometry(
+		const vk::raii::Device& device, MemoryAllocator& allocator, RingBuffer& frameRing, const uint32_t slotCount,
+		const uint32_t vertexStride, const uint32_t vertexCapacity, const uint32_t indexCapacity
+	) : _frameRing(frameRing), _vertexStride(vertexStride), _vertexCapacity(vertexCapacity),
+		_indexCapacity(indexCapacity)
+	{
+		if(slotCount == 0 || vertexStride == 0 || vertexCapacity == 0 || indexCapacity == 0)
+			throw std::runtime_error("Failed to create dynamic geometry: every count has to be above zero.");
+
+		// Index 0xFFFF is a valid vertex as long as primitive restart is off
+		_indexType = vertexCapacity <= UINT16_MAX + 1u ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+
+		_vertices.resize(getVertexBufferSize());
+		_indices.resize(getIndexBufferSize());
+
+		_slots.resize(slotCount);
+		for(auto& slot : _slots)
+		{
+			slot.vertexBuffer = createBuffer(device, getVertexBufferSize(), vk::BufferUsageFlagBits::eVertexBuffer);
+			slot.vertexAllocation = allocator.allocateForBuffer(
+				slot.vertexBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal
+			);
+
+			slot.indexBuffer = createBuffer(device, getIndexBufferSize(), vk::BufferUsageFlagBits::eIndexBuffer);
+			slot.indexAllocation = allocator.allocateForBuffer(
+				slot.indexBuffer,
+				vk::MemoryPropertyFlagBits::eDeviceLocal
+			);
+		}
+	}
+
+	void DynamicGeometry::writeVertexBytes(const uint32_t firstVertex, const std::span<const std::byte> bytes)
+	{
+		if(bytes.size() % _vertexStride != 0)
+			throw std::runtime_error("Failed to write dynamic vertices: the data isn't a whole number of vertices.");
+
+		const vk::DeviceSize begin = static_cast<vk::DeviceSize>(firstVertex) * _vertexStride;
+		if(begin + bytes.size() > _vertices.size())
+			throw std::runtime_error("Failed to write dynamic vertices: the range is outside of the capacity.");
+
+		if(bytes.empty()) return;
+
+		std::memcpy(_vertices.data() + begin, bytes.data(), bytes.size());
+		markDirty(&Slot::dirtyVertices, {begin, begin + bytes.size()});
+	}
+
+	void DynamicGeometry::writeIndices(const uint32_t firstIndex, const std::span<const uint32_t> indices)
+	{
+		if(static_cast<uint64_t>(firstIndex) + indices.size() > _indexCapacity)
+			throw std::runtime_error("Failed to write dynamic indices: the range is outside of the capacity.");
+
+		if(indices.empty()) return;
+
+		const vk::DeviceSize indexSize = _indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		std::byte* destination = _indices.data() + firstIndex * indexSize;
+
+		for(const uint32_t index : indices)
+		{
+			if(index >= _vertexCapacity)
+				throw std::runtime_error("Failed to write dynamic indices: an index is outside of the vertex capacity.");
+
+			if(_indexType == vk::IndexType::eUint16)
+			{
+				const auto narrowed = static_cast<uint16_t>(index);
+				std::memcpy(destination, &narrowed, sizeof(narrowed));
+			}
+			else
+			{
+				std::memcpy(destination, &index, sizeof(index));
+			}
+			destination += indexSize;
+		}
+
+		const vk::DeviceSize begin = firstIndex * indexSize;
+		markDirty(&Slot::dirtyIndices, {begin, begin + indices.size() * indexSize});
+	}
+
+	void DynamicGeometry::setIndexCount(const uint32_t indexCount)
+	{
+		if(indexCount > _indexCapacity)
+			throw std::runtime_error("Failed to set dynamic index count: it's above the index capacity.");
+
+		_indexCount = indexCount;
+	}
+
+	uint32_t DynamicGeometry::getIndexCount() const
+	{
+		return _indexCount;
+	}
+
+	uint32_t DynamicGeometry::getVertexCapacity() const
+	{
+		return _vertexCapacity;
+	}
+
+	uint32_t DynamicGeometry::getIndexCapacity() const
+	{
+		return _indexCapacity;
+	}
+
+	vk::IndexType DynamicGeometry::getIndexType() const
+	{
+		return _indexType;
+	}
+
+	void DynamicGeometry::update(const vk::raii::CommandBuffer& commandBuffer, const uint32_t slot)
+	{
+		auto& target = _slots.at(slot);
+
+		uploadRanges(commandBuffer, _vertices, target.dirtyVertices, *target.vertexBuffer);
+		uploadRanges(commandBuffer, _indices, target.dirtyIndices, *target.indexBuffer);
+	}
+
+	vk::Buffer DynamicGeometry::getVertexBuffer(const uint32_t slot) const
+	{
+		return *_slots.at(slot).vertexBuffer;
+	}
+
+	vk::Buffer DynamicGeometry::getIndexBuffer(const uint32_t slot) const
+	{
+		return *_slots.at(slot).indexBuffer;
+	}
+
+	vk::DeviceSize DynamicGeometry::getVertexBufferSize() const
+	{
+		return static_cast<vk::DeviceSize>(_vertexCapacity) * _vertexStride;
+	}
+
+	vk::DeviceSize DynamicGeometry::getIndexBufferSize() const
+	{
+		const vk::DeviceSize indexSize = _indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		return _indexCapacity * indexSize;
+	}
+
+	void DynamicGeometry::markDirty(std::vector<DirtyRange> Slot::* ranges, const DirtyRange range)
+	{
+		for(auto& slot : _slots)
+		{
+			auto& dirty = slot.*ranges;
+
+			// Every range that overlaps the new one or is within the merge gap of it becomes one range
+			auto first = std::ranges::lower_bound(
+				dirty,
+				range.begin,
+				{},
+				[](const DirtyRange& other) { return other.end + DYNAMIC_GEOMETRY_MERGE_GAP; }
+			);
+
+			DirtyRange merged = range;
+			auto last = first;
+			for(; last != dirty.end() && last->begin <= range.end + DYNAMIC_GEOMETRY_MERGE_GAP; ++last)
+			{
+				merged.begin = std::min(merged.begin, last->begin);
+				merged.end = std::max(merged.end, last->end);
+			}
+
+			first = dirty.erase(first, last);
+			dirty.insert(first, merged);
+		}
+	}
+
+	void DynamicGeometry::uploadRanges(
+		const vk::raii::CommandBuffer& commandBuffer, const std::vector<std::byte>& data,
+		std::vector<DirtyRange>& ranges, const vk::Buffer buffer
+	)
+	{
+		std::vector<vk::BufferCopy> regions;
+		regions.reserve(ranges.size());
+
+		size_t uploaded = 0;
+		for(; uploaded < ranges.size(); uploaded++)
+		{
+			const auto& range = ranges[uploaded];
+			const vk::DeviceSize size = range.end - range.begin;
+
+			const auto staging = _frameRing.write(data.data() + range.begin, size);
+			if(!staging) break;
+
+			regions.emplace_back(staging.offset, range.begin, size);
+		}
+
+		if(!regions.empty()) commandBuffer.copyBuffer(_frameRing.getBuffer(), buffer, regions);
+
+		ranges.erase(ranges.begin(), ranges.begin() + static_cast<std::ptrdiff_t>(uploaded));
+	}
+}
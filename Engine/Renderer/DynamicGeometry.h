@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "MemoryAllocator.h"
+#include "RingBuffer.h"
+
+namespace Renderer
+{
+	/**
+	 * Dirty ranges closer than this are uploaded as one copy, re-sending a few unchanged bytes is cheaper than a region
+	 */
+	constexpr vk::DeviceSize DYNAMIC_GEOMETRY_MERGE_GAP = 256;
+
+	/**
+	 * Vertices and indices that game code rewrites while frames are in flight (deformed meshes, trails, debug lines)
+	 * Every frame in flight has its own vertex and index buffer, so a write never lands in a buffer the GPU may still
+	 * read. Writes go to a CPU copy and mark their byte range dirty in every slot; when a slot is used again only its
+	 * dirty ranges are copied from the frame ring, unchanged data is never sent twice to the same buffer.
+	 */
+	class DynamicGeometry
+	{
+	public:
+		/**
+		 * @param device Logical device
+		 * @param allocator Allocator of the device local buffers
+		 * @param frameRing Staging memory of the uploads
+		 * @param slotCount Frames in flight, one copy of the buffers each
+		 * @param vertexStride Bytes per vertex
+		 * @param vertexCapacity Vertices every copy holds, the indices are 16 bit when they all fit
+		 * @param indexCapacity Indices every copy holds
+		 */
+		DynamicGeometry(
+			const vk::raii::Device& device,
+			MemoryAllocator& allocator,
+			RingBuffer& frameRing,
+			uint32_t slotCount,
+			uint32_t vertexStride,
+			uint32_t vertexCapacity,
+			uint32_t indexCapacity
+		);
+		~DynamicGeometry() = default;
+
+		DynamicGeometry(const DynamicGeometry&) = delete;
+		DynamicGeometry& operator=(const DynamicGeometry&) = delete;
+
+		/**
+		 * Overwrites vertices starting at firstVertex, the size of VertexType has to be the stride
+		 */
+		template<typename VertexType>
+		void writeVertices(const uint32_t firstVertex, const std::span<const VertexType> vertices)
+		{
+			if(sizeof(VertexType) != _vertexStride)
+				throw std::runtime_error("Failed to write dynamic vertices: the vertex size doesn't match the stride.");
+
+			writeVertexBytes(firstVertex, std::as_bytes(vertices));
+		}
+
+		/**
+		 * Overwrites vertices starting at firstVertex with already packed data (a multiple of the stride)
+		 */
+		void writeVertexBytes(uint32_t firstVertex, std::span<const std::byte> bytes);
+
+		/**
+		 * Overwrites indices starting at firstIndex, they are narrowed to the index type on write
+		 */
+		void writeIndices(uint32_t firstIndex, std::span<const uint32_t> indices);
+
+		/**
+		 * Sets how many indices (from the first one) are drawn, 0 draws nothing
+		 */
+		void setIndexCount(uint32_t indexCount);
+
+		[[nodiscard]] uint32_t getIndexCount() const;
+
+		[[nodiscard]] uint32_t getVertexCapacity() const;
+
+		[[nodiscard]] uint32_t getIndexCapacity() const;
+
+		[[nodiscard]] vk::IndexType getIndexType() const;
+
+		/**
+		 * Records the copies of the ranges written since this slot was last updated
+		 * Ranges that don't fit in the ring stay dirty and go out the next time the slot is used.
+		 * The caller orders the copies before the vertex input (e.g. through the render graph).
+		 *
+		 * @param slot Frame in flight being recorded, its previous frame must have completed
+		 */
+		void update(const vk::raii::CommandBuffer& commandBuffer, uint32_t slot);
+
+		[[nodiscard]] vk::Buffer getVertexBuffer(uint32_t slot) const;
+
+		[[nodiscard]] vk::Buffer getIndexBuffer(uint32_t slot) const;
+
+		[[nodiscard]] vk::DeviceSize getVertexBufferSize() const;
+
+		[[nodiscard]] vk::DeviceSize getIndexBufferSize() const;
+
+	private:
+		// Byte range [begin, end)
+		struct DirtyRange
+		{
+			vk::DeviceSize begin = 0;
+			vk::DeviceSize end = 0;
+		};
+
+		struct Slot
+		{
+			Allocation vertexAllocation;
+			vk::raii::Buffer vertexBuffer = VK_NULL_HANDLE;
+
+			Allocation indexAllocation;
+			vk::raii::Buffer indexBuffer = VK_NULL_HANDLE;
+
+			// Sorted and disjoint
+			std::vector<DirtyRange> dirtyVertices;
+			std::vector<DirtyRange> dirtyIndices;
+		};
+
+		RingBuffer& _frameRing;
+
+		uint32_t _vertexStride = 0;
+		uint32_t _vertexCapacity = 0;
+		uint32_t _indexCapacity = 0;
+		uint32_t _indexCount = 0;
+		vk::IndexType _indexType = vk::IndexType::eUint32;
+
+		// What every slot converges to, indices are stored in the index type already
+		std::vector<std::byte> _vertices;
+		std::vector<std::byte> _indices;
+
+		std::vector<Slot> _slots;
+
+		/**
+		 * Adds the range to every slot
+		 */
+		void markDirty(std::vector<DirtyRange> Slot::* ranges, DirtyRange range);
+
+		/**
+		 * Copies the dirty ranges of data into buffer, the copied ones are removed
+		 */
+		void uploadRanges(
+			const vk::raii::CommandBuffer& commandBuffer,
+			const std::vector<std::byte>& data,
+			std::vector<DirtyRange>& ranges,
+			vk::Buffer buffer
+		);
+	};
+}
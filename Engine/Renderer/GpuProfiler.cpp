@@ -0,0 +1,156 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace Renderer
+{
+	GpuProfiler::GpuProfiler(
+		const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device,
+		const uint32_t queueFamilyIndex, const uint32_t framesInFlight
+	)
+	{
+		const uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+		if(validBits == 0)
+		{
+			std::printf("GPU profiler -> queue family %u has no timestamp support, profiling disabled\n", queueFamilyIndex);
+			return;
+		}
+
+		_timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+		_timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+
+		const vk::QueryPoolCreateInfo queryPoolInfo(
+			{},
+			vk::QueryType::eTimestamp,
+			framesInFlight * GPU_PROFILER_MAX_SCOPES * 2
+		);
+		_queryPool = vk::raii::QueryPool(device, queryPoolInfo);
+
+		_frames.resize(framesInFlight);
+		for(uint32_t i = 0; i < framesInFlight; i++)
+		{
+			_frames[i].frameIndex = i;
+		}
+	}
+
+	void GpuProfiler::beginFrame(const vk::raii::CommandBuffer& commandBuffer, const uint32_t frameIndex)
+	{
+		if(!isEnabled()) return;
+
+		auto& frame = _frames[frameIndex];
+		if(frame.isPending) collect(frame);
+
+		frame.scopes.clear();
+		_currentFrame = &frame;
+
+		commandBuffer.resetQueryPool(_queryPool, frameIndex * GPU_PROFILER_MAX_SCOPES * 2, GPU_PROFILER_MAX_SCOPES * 2);
+	}
+
+	uint32_t GpuProfiler::beginScope(const vk::raii::CommandBuffer& commandBuffer, const std::string& name)
+	{
+		if(!isEnabled() || !_currentFrame || _currentFrame->scopes.size() >= GPU_PROFILER_MAX_SCOPES) return UINT32_MAX;
+
+		auto [entry, isNew] = _scopeIndices.try_emplace(name, static_cast<uint32_t>(_stats.size()));
+		if(isNew) _stats.push_back({name});
+
+		const auto scope = static_cast<uint32_t>(_currentFrame->scopes.size());
+		_currentFrame->scopes.push_back(entry->second);
+		_currentFrame->isPending = true;
+
+		const uint32_t query = (_currentFrame->frameIndex * GPU_PROFILER_MAX_SCOPES + scope) * 2;
+		commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, _queryPool, query);
+
+		return scope;
+	}
+
+	void GpuProfiler::endScope(const vk::raii::CommandBuffer& commandBuffer, const uint32_t scope)
+	{
+		if(scope == UINT32_MAX || !_currentFrame) return;
+
+		const uint32_t query = (_currentFrame->frameIndex * GPU_PROFILER_MAX_SCOPES + scope) * 2 + 1;
+		commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, _queryPool, query);
+	}
+
+	void GpuProfiler::collect(FrameQueries& frame)
+	{
+		frame.isPending = false;
+		if(frame.scopes.empty()) return;
+
+		const auto queryCount = static_cast<uint32_t>(frame.scopes.size() * 2);
+
+		// The slot's fence has been waited on, so this doesn't block
+		const auto [result, timestamps] = _queryPool.getResults<uint64_t>(
+			frame.frameIndex * GPU_PROFILER_MAX_SCOPES * 2,
+			queryCount,
+			queryCount * sizeof(uint64_t),
+			sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64
+		);
+
+		if(result != vk::Result::eSuccess) return;
+
+		for(size_t i = 0; i < frame.scopes.size(); i++)
+		{
+			const uint64_t begin = timestamps[i * 2] & _timestampMask;
+			const uint64_t end = timestamps[i * 2 + 1] & _timestampMask;
+			const double milliseconds = static_cast<double>((end - begin) & _timestampMask) * _timestampPeriod / 1e6;
+
+			auto& stats = _stats[frame.scopes[i]];
+			stats.lastMs = milliseconds;
+			stats.minMs = stats.samples == 0 ? milliseconds : std::min(stats.minMs, milliseconds);
+			stats.maxMs = stats.samples == 0 ? milliseconds : std::max(stats.maxMs, milliseconds);
+			stats.averageMs += (milliseconds - stats.averageMs) / static_cast<double>(stats.samples + 1);
+			stats.samples++;
+		}
+	}
+
+	std::vector<GpuScopeStats> GpuProfiler::getStats() const
+	{
+		return _stats;
+	}
+
+	void GpuProfiler::resetStats()
+	{
+		for(auto& stats : _stats)
+		{
+			stats.averageMs = 0.0;
+			stats.minMs = 0.0;
+			stats.maxMs = 0.0;
+			stats.samples = 0;
+		}
+	}
+
+	void GpuProfiler::printStats() const
+	{
+		for(const auto& stats : _stats)
+		{
+			if(stats.samples == 0) continue;
+
+			std::printf(
+				"GPU %-20s avg: %.3f ms, min: %.3f ms, max: %.3f ms\n",
+				stats.name.c_str(),
+				stats.averageMs,
+				stats.minMs,
+				stats.maxMs
+			);
+		}
+	}
+
+	bool GpuProfiler::isEnabled() const
+	{
+		return _timestampMask != 0;
+	}
+
+	GpuProfileScope::GpuProfileScope(
+		GpuProfiler& profiler, const vk::raii::CommandBuffer& commandBuffer, const std::string& name
+	) : _profiler(profiler), _commandBuffer(commandBuffer)
+	{
+		_scope = _profiler.beginScope(_commandBuffer, name);
+	}
+
+	GpuProfileScope::~GpuProfileScope()
+	{
+		_profiler.endScope(_commandBuffer, _scope);
+	}
+}
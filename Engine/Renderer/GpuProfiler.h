@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer
+{
+	/**
+	 * Maximum number of scopes recorded in a single frame
+	 */
+	constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 64;
+
+	/**
+	 * Timing of one named scope, accumulated since the last resetStats()
+	 */
+	struct GpuScopeStats
+	{
+		std::string name;
+		double lastMs = 0.0;
+		double averageMs = 0.0;
+		double minMs = 0.0;
+		double maxMs = 0.0;
+		uint64_t samples = 0;
+	};
+
+	/**
+	 * Timestamp query based GPU profiler.
+	 * Every frame in flight owns a range of the query pool; results are read back when the frame's slot comes around
+	 * again (its fence has been waited on), so reading never stalls the GPU.
+	 */
+	class GpuProfiler
+	{
+	public:
+		/**
+		 * @param physicalDevice Used for timestampPeriod and the queue's timestamp support
+		 * @param device Logical device
+		 * @param queueFamilyIndex Family the profiled command buffers are submitted to
+		 * @param framesInFlight Number of frames that can be in flight
+		 */
+		GpuProfiler(
+			const vk::raii::PhysicalDevice& physicalDevice,
+			const vk::raii::Device& device,
+			uint32_t queueFamilyIndex,
+			uint32_t framesInFlight
+		);
+		~GpuProfiler() = default;
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		/**
+		 * Collects the results of the frame previously recorded in this slot and resets its queries.
+		 * Call at the start of recording, outside of rendering, after the slot's fence was waited on.
+		 */
+		void beginFrame(const vk::raii::CommandBuffer& commandBuffer, uint32_t frameIndex);
+
+		/**
+		 * Writes the start timestamp of a scope
+		 *
+		 * @return Scope handle for endScope (UINT32_MAX when the profiler is disabled or full)
+		 */
+		uint32_t beginScope(const vk::raii::CommandBuffer& commandBuffer, const std::string& name);
+
+		/**
+		 * Writes the end timestamp of a scope
+		 */
+		void endScope(const vk::raii::CommandBuffer& commandBuffer, uint32_t scope);
+
+		/**
+		 * @return Stats of every scope seen so far
+		 */
+		[[nodiscard]] std::vector<GpuScopeStats> getStats() const;
+
+		/**
+		 * Starts a new averaging window (last values are kept)
+		 */
+		void resetStats();
+
+		/**
+		 * Prints average/min/max of every scope to stdout
+		 */
+		void printStats() const;
+
+		[[nodiscard]] bool isEnabled() const;
+
+	private:
+		struct FrameQueries
+		{
+			std::vector<uint32_t> scopes; // index into _stats, in recording order
+			uint32_t frameIndex = 0;
+			bool isPending = false;
+		};
+
+		vk::raii::QueryPool _queryPool = VK_NULL_HANDLE;
+
+		double _timestampPeriod = 1.0;
+		uint64_t _timestampMask = 0;
+
+		std::vector<FrameQueries> _frames;
+		FrameQueries* _currentFrame = nullptr;
+
+		std::vector<GpuScopeStats> _stats;
+		std::unordered_map<std::string, uint32_t> _scopeIndices;
+
+		void collect(FrameQueries& frame);
+	};
+
+	/**
+	 * Profiles the commands recorded during its lifetime
+	 */
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(GpuProfiler& profiler, const vk::raii::CommandBuffer& commandBuffer, const std::string& name);
+		~GpuProfileScope();
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+	private:
+		GpuProfiler& _profiler;
+		const vk::raii::CommandBuffer& _commandBuffer;
+		uint32_t _scope;
+	};
+}
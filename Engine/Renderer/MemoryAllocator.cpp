@@ -0,0 +1,341 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <utility>
+
+namespace Renderer
+{
+	namespace
+	{
+		vk::DeviceSize alignUp(const vk::DeviceSize value, const vk::DeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	Allocation::~Allocation()
+	{
+		release();
+	}
+
+	Allocation::Allocation(Allocation&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	Allocation& Allocation::operator=(Allocation&& other) noexcept
+	{
+		if(this == &other) return *this;
+
+		release();
+
+		_allocator = std::exchange(other._allocator, nullptr);
+		_block = std::exchange(other._block, nullptr);
+		_rangeOffset = other._rangeOffset;
+		_rangeSize = other._rangeSize;
+		_offset = other._offset;
+		_size = other._size;
+
+		return *this;
+	}
+
+	void Allocation::release()
+	{
+		if(!_allocator) return;
+
+		_allocator->free(*this);
+		_allocator = nullptr;
+		_block = nullptr;
+	}
+
+	vk::DeviceMemory Allocation::getMemory() const
+	{
+		return _block ? *_block->memory : vk::DeviceMemory{};
+	}
+
+	vk::DeviceSize Allocation::getOffset() const
+	{
+		return _offset;
+	}
+
+	vk::DeviceSize Allocation::getSize() const
+	{
+		return _size;
+	}
+
+	void* Allocation::getMappedData() const
+	{
+		if(!_block || !_block->mapped) return nullptr;
+
+		return static_cast<char*>(_block->mapped) + _offset;
+	}
+
+	Allocation::operator bool() const
+	{
+		return _block != nullptr;
+	}
+
+	MemoryAllocator::MemoryAllocator(
+		const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, const vk::DeviceSize blockSize
+	) : _device(device), _blockSize(blockSize)
+	{
+		_memoryProperties = physicalDevice.getMemoryProperties();
+
+		const auto limits = physicalDevice.getProperties().limits;
+		_nonCoherentAtomSize = std::max<vk::DeviceSize>(limits.nonCoherentAtomSize, 1);
+		_maxAllocationCount = limits.maxMemoryAllocationCount;
+	}
+
+	uint32_t MemoryAllocator::findMemoryType(const uint32_t typeFilter, const vk::MemoryPropertyFlags properties) const
+	{
+		for(uint32_t i = 0; i < _memoryProperties.memoryTypeCount; i++)
+		{
+			if(
+				(typeFilter & (1 << i)) &&
+				(_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties
+			)
+			{
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Failed to find suitable memory type: for loop didn't return index.");
+	}
+
+	Allocation MemoryAllocator::allocate(
+		const vk::MemoryRequirements& requirements, const vk::MemoryPropertyFlags properties, const ResourceKind kind
+	)
+	{
+		const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+		const auto typeFlags = _memoryProperties.memoryTypes[memoryType].propertyFlags;
+
+		vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+		vk::DeviceSize size = requirements.size;
+
+		// Non-coherent ranges are flushed in atoms, neighbours must not share one
+		if((typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) &&
+			!(typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent))
+		{
+			alignment = alignUp(alignment, _nonCoherentAtomSize);
+			size = alignUp(size, _nonCoherentAtomSize);
+		}
+
+		std::lock_guard lock(_mutex);
+
+		Allocation allocation;
+
+		const vk::DeviceSize blockSize = blockSizeFor(memoryType);
+
+		// Big resources would only fragment the shared blocks
+		if(size > blockSize / 2)
+		{
+			auto& block = createBlock(memoryType, size, kind, true);
+			placeInBlock(block, size, alignment, allocation);
+		}
+		else
+		{
+			bool placed = false;
+			for(const auto& block : _blocks)
+			{
+				if(block->dedicated || block->memoryType != memoryType || block->kind != kind) continue;
+
+				if(placeInBlock(*block, size, alignment, allocation))
+				{
+					placed = true;
+					break;
+				}
+			}
+
+			if(!placed)
+			{
+				auto& block = createBlock(memoryType, blockSize, kind, false);
+				placeInBlock(block, size, alignment, allocation);
+			}
+		}
+
+		allocation._allocator = this;
+		allocation._size = requirements.size;
+
+		_stats.subAllocations++;
+		_stats.usedBytes += allocation._size;
+		_stats.wastedBytes += allocation._rangeSize - allocation._size;
+
+		return allocation;
+	}
+
+	Allocation MemoryAllocator::allocateForBuffer(const vk::raii::Buffer& buffer, const vk::MemoryPropertyFlags properties)
+	{
+		auto allocation = allocate(buffer.getMemoryRequirements(), properties, ResourceKind::Linear);
+		buffer.bindMemory(allocation.getMemory(), allocation.getOffset());
+		return allocation;
+	}
+
+	Allocation MemoryAllocator::allocateForImage(const vk::raii::Image& image, const vk::MemoryPropertyFlags properties)
+	{
+		auto allocation = allocate(image.getMemoryRequirements(), properties, ResourceKind::Optimal);
+		image.bindMemory(allocation.getMemory(), allocation.getOffset());
+		return allocation;
+	}
+
+	MemoryBlock& MemoryAllocator::createBlock(
+		const uint32_t memoryType, const vk::DeviceSize size, const ResourceKind kind, const bool dedicated
+	)
+	{
+		if(_stats.deviceAllocations >= _maxAllocationCount)
+			throw std::runtime_error(
+				"Failed to allocate device memory: maxMemoryAllocationCount has been reached."
+			);
+
+		auto block = std::make_unique<MemoryBlock>();
+
+		const vk::MemoryAllocateInfo allocateInfo(size, memoryType);
+		block->memory = vk::raii::DeviceMemory(_device, allocateInfo);
+		block->size = size;
+		block->memoryType = memoryType;
+		block->kind = kind;
+		block->dedicated = dedicated;
+		block->freeRanges.emplace(0, size);
+
+		if(_memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+			block->mapped = block->memory.mapMemory(0, vk::WholeSize);
+
+		_stats.deviceAllocations++;
+		_stats.reservedBytes += size;
+
+		_blocks.push_back(std::move(block));
+		return *_blocks.back();
+	}
+
+	bool MemoryAllocator::placeInBlock(
+		MemoryBlock& block, const vk::DeviceSize size, const vk::DeviceSize alignment, Allocation& allocation
+	)
+	{
+		auto bestRange = block.freeRanges.end();
+		vk::DeviceSize bestRangeSize = std::numeric_limits<vk::DeviceSize>::max();
+
+		for(auto range = block.freeRanges.begin(); range != block.freeRanges.end(); ++range)
+		{
+			const auto [rangeOffset, rangeSize] = *range;
+			const vk::DeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+
+			if(alignedOffset + size > rangeOffset + rangeSize) continue;
+
+			if(rangeSize < bestRangeSize)
+			{
+				bestRange = range;
+				bestRangeSize = rangeSize;
+			}
+		}
+
+		if(bestRange == block.freeRanges.end()) return false;
+
+		const auto [rangeOffset, rangeSize] = *bestRange;
+		const vk::DeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+		const vk::DeviceSize usedEnd = alignedOffset + size;
+
+		block.freeRanges.erase(bestRange);
+		if(usedEnd < rangeOffset + rangeSize)
+			block.freeRanges.emplace(usedEnd, rangeOffset + rangeSize - usedEnd);
+
+		// The front padding stays with the allocation, it's too small to be worth a free range
+		allocation._block = &block;
+		allocation._rangeOffset = rangeOffset;
+		allocation._rangeSize = usedEnd - rangeOffset;
+		allocation._offset = alignedOffset;
+
+		block.liveAllocations++;
+
+		return true;
+	}
+
+	void MemoryAllocator::free(Allocation& allocation)
+	{
+		std::lock_guard lock(_mutex);
+
+		MemoryBlock& block = *allocation._block;
+
+		_stats.subAllocations--;
+		_stats.usedBytes -= allocation._size;
+		_stats.wastedBytes -= allocation._rangeSize - allocation._size;
+
+		vk::DeviceSize offset = allocation._rangeOffset;
+		vk::DeviceSize size = allocation._rangeSize;
+
+		auto next = block.freeRanges.lower_bound(offset);
+		if(next != block.freeRanges.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = block.freeRanges.erase(next);
+		}
+
+		if(next != block.freeRanges.begin())
+		{
+			if(const auto previous = std::prev(next); previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				size += previous->second;
+				block.freeRanges.erase(previous);
+			}
+		}
+
+		block.freeRanges.emplace(offset, size);
+		block.liveAllocations--;
+
+		if(block.liveAllocations > 0) return;
+
+		// Keep one empty shared block per memory type around, so alloc/free churn doesn't hit the driver
+		bool keepBlock = !block.dedicated;
+		if(keepBlock)
+		{
+			for(const auto& other : _blocks)
+			{
+				if(other.get() != &block && !other->dedicated && other->memoryType == block.memoryType &&
+					other->kind == block.kind && other->liveAllocations == 0)
+				{
+					keepBlock = false;
+					break;
+				}
+			}
+		}
+
+		if(keepBlock) return;
+
+		_stats.deviceAllocations--;
+		_stats.reservedBytes -= block.size;
+
+		std::erase_if(_blocks, [&block](const std::unique_ptr<MemoryBlock>& candidate)
+		{
+			return candidate.get() == &block;
+		});
+	}
+
+	vk::DeviceSize MemoryAllocator::blockSizeFor(const uint32_t memoryType) const
+	{
+		const uint32_t heapIndex = _memoryProperties.memoryTypes[memoryType].heapIndex;
+		const vk::DeviceSize heapSize = _memoryProperties.memoryHeaps[heapIndex].size;
+
+		return std::min(_blockSize, heapSize / 8);
+	}
+
+	MemoryStats MemoryAllocator::getStats() const
+	{
+		std::lock_guard lock(_mutex);
+		return _stats;
+	}
+
+	void MemoryAllocator::printStats() const
+	{
+		const auto stats = getStats();
+
+		std::printf(
+			"GPU memory -> Device allocations: %u, Sub-allocations: %u, Reserved: %.2f MiB, Used: %.2f MiB, Wasted: %.2f KiB\n",
+			stats.deviceAllocations,
+			stats.subAllocations,
+			static_cast<double>(stats.reservedBytes) / (1024.0 * 1024.0),
+			static_cast<double>(stats.usedBytes) / (1024.0 * 1024.0),
+			static_cast<double>(stats.wastedBytes) / 1024.0
+		);
+	}
+}
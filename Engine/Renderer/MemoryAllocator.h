@@ -0,0 +1,218 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer
+{
+	class MemoryAllocator;
+	struct MemoryBlock;
+
+	/**
+	 * Default size of a single vkAllocateMemory call backing many sub-allocations.
+	 * Clamped per heap, so small heaps (e.g. 256 MiB BAR) are not eaten by one block.
+	 */
+	constexpr vk::DeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	/**
+	 * Kind of resource the memory is going to be bound to.
+	 * Linear (buffers) and optimal (images) resources are kept in different blocks,
+	 * so bufferImageGranularity never has to be respected between neighbours.
+	 */
+	enum class ResourceKind : uint8_t
+	{
+		Linear,
+		Optimal
+	};
+
+	/**
+	 * A range of device memory handed out by the MemoryAllocator.
+	 * It is move-only and returns itself to the allocator when destroyed.
+	 */
+	class Allocation
+	{
+	public:
+		Allocation() = default;
+		~Allocation();
+
+		Allocation(const Allocation&) = delete;
+		Allocation& operator=(const Allocation&) = delete;
+
+		Allocation(Allocation&& other) noexcept;
+		Allocation& operator=(Allocation&& other) noexcept;
+
+		/**
+		 * Returns the range back to the allocator, the object becomes empty.
+		 */
+		void release();
+
+		[[nodiscard]] vk::DeviceMemory getMemory() const;
+
+		/**
+		 * @return Offset of the resource inside getMemory() (already aligned)
+		 */
+		[[nodiscard]] vk::DeviceSize getOffset() const;
+
+		/**
+		 * @return Requested size of the resource
+		 */
+		[[nodiscard]] vk::DeviceSize getSize() const;
+
+		/**
+		 * @return Persistently mapped pointer to the resource, or nullptr for non host visible memory
+		 */
+		[[nodiscard]] void* getMappedData() const;
+
+		explicit operator bool() const;
+
+	private:
+		friend class MemoryAllocator;
+
+		MemoryAllocator* _allocator = nullptr;
+		MemoryBlock* _block = nullptr;
+
+		// Whole range taken from the block, including alignment padding
+		vk::DeviceSize _rangeOffset = 0;
+		vk::DeviceSize _rangeSize = 0;
+
+		vk::DeviceSize _offset = 0;
+		vk::DeviceSize _size = 0;
+	};
+
+	/**
+	 * Snapshot of the allocator usage
+	 *
+	 * @param deviceAllocations Number of live vkAllocateMemory allocations
+	 * @param subAllocations Number of live Allocation objects
+	 * @param reservedBytes Bytes allocated from the driver
+	 * @param usedBytes Bytes requested by resources
+	 * @param wastedBytes Bytes lost to alignment padding and size rounding inside live allocations
+	 */
+	struct MemoryStats
+	{
+		uint32_t deviceAllocations = 0;
+		uint32_t subAllocations = 0;
+		vk::DeviceSize reservedBytes = 0;
+		vk::DeviceSize usedBytes = 0;
+		vk::DeviceSize wastedBytes = 0;
+	};
+
+	/**
+	 * Single vkAllocateMemory allocation, split into sub-ranges with a best-fit free list
+	 */
+	struct MemoryBlock
+	{
+		vk::raii::DeviceMemory memory = VK_NULL_HANDLE;
+		vk::DeviceSize size = 0;
+		uint32_t memoryType = 0;
+		ResourceKind kind = ResourceKind::Linear;
+		bool dedicated = false;
+
+		void* mapped = nullptr;
+
+		// offset -> size, ordered so neighbours can be coalesced on free
+		std::map<vk::DeviceSize, vk::DeviceSize> freeRanges;
+		uint32_t liveAllocations = 0;
+	};
+
+	/**
+	 * Engine-level GPU memory allocator.
+	 * Keeps a list of big blocks per memory type and sub-allocates resources from them,
+	 * so thousands of buffers end up in a handful of real device allocations.
+	 * Host visible blocks are mapped once, for their whole lifetime.
+	 */
+	class MemoryAllocator
+	{
+	public:
+		MemoryAllocator(
+			const vk::raii::PhysicalDevice& physicalDevice,
+			const vk::raii::Device& device,
+			vk::DeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE
+		);
+		~MemoryAllocator() = default;
+
+		MemoryAllocator(const MemoryAllocator&) = delete;
+		MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+		/**
+		 * Finds the first memory type that is allowed by the filter and has every requested property
+		 *
+		 * @param typeFilter Bit mask of allowed memory types (from vk::MemoryRequirements)
+		 * @param properties Required property flags
+		 * @return Memory type index
+		 */
+		[[nodiscard]] uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+		/**
+		 * Sub-allocates memory that satisfies the requirements
+		 *
+		 * @param requirements Size, alignment and allowed memory types
+		 * @param properties Required memory property flags
+		 * @param kind Linear for buffers, Optimal for images with optimal tiling
+		 * @return Allocation that has to outlive the resource usage
+		 */
+		[[nodiscard]] Allocation allocate(
+			const vk::MemoryRequirements& requirements,
+			vk::MemoryPropertyFlags properties,
+			ResourceKind kind
+		);
+
+		/**
+		 * Allocates memory for the buffer and binds it
+		 */
+		[[nodiscard]] Allocation allocateForBuffer(const vk::raii::Buffer& buffer, vk::MemoryPropertyFlags properties);
+
+		/**
+		 * Allocates memory for the (optimal tiling) image and binds it
+		 */
+		[[nodiscard]] Allocation allocateForImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties);
+
+		[[nodiscard]] MemoryStats getStats() const;
+
+		/**
+		 * Prints the stats to stdout
+		 */
+		void printStats() const;
+
+	private:
+		friend class Allocation;
+
+		const vk::raii::Device& _device;
+
+		vk::PhysicalDeviceMemoryProperties _memoryProperties;
+		vk::DeviceSize _nonCoherentAtomSize = 1;
+		uint32_t _maxAllocationCount = UINT32_MAX;
+
+		vk::DeviceSize _blockSize;
+
+		std::vector<std::unique_ptr<MemoryBlock>> _blocks;
+		MemoryStats _stats;
+
+		mutable std::mutex _mutex;
+
+		/**
+		 * Allocates a new block from the driver
+		 */
+		MemoryBlock& createBlock(uint32_t memoryType, vk::DeviceSize size, ResourceKind kind, bool dedicated);
+
+		/**
+		 * Tries to place the allocation inside the block with the best-fitting free range
+		 *
+		 * @return True if the allocation was placed
+		 */
+		static bool placeInBlock(
+			MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, Allocation& allocation
+		);
+
+		/**
+		 * Returns the range of the allocation to its block, coalescing with the neighbours
+		 */
+		void free(Allocation& allocation);
+
+		[[nodiscard]] vk::DeviceSize blockSizeFor(uint32_t memoryType) const;
+	};
+}
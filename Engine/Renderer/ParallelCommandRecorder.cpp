@@ -0,0 +1,101 @@
+#include "ParallelCommandRecorder.h"
+
+#include <algorithm>
+
+namespace Renderer
+{
+	ParallelCommandRecorder::ParallelCommandRecorder(
+		const vk::raii::Device& device, const uint32_t queueFamilyIndex, const uint32_t framesInFlight,
+		Core::ThreadPool& threadPool
+	) : _device(device), _threadPool(threadPool)
+	{
+		const uint32_t taskCount = _threadPool.getThreadCount();
+
+		_contexts.resize(framesInFlight);
+		for(auto& frameContexts : _contexts)
+		{
+			frameContexts.resize(taskCount);
+			for(auto& context : frameContexts)
+			{
+				const vk::CommandPoolCreateInfo commandPoolInfo(
+					vk::CommandPoolCreateFlagBits::eTransient,
+					queueFamilyIndex
+				);
+				context.pool = vk::raii::CommandPool(_device, commandPoolInfo);
+
+				const vk::CommandBufferAllocateInfo allocateInfo(
+					context.pool,
+					vk::CommandBufferLevel::eSecondary,
+					1
+				);
+				context.commandBuffer = std::move(vk::raii::CommandBuffers(_device, allocateInfo).front());
+			}
+		}
+	}
+
+	void ParallelCommandRecorder::beginFrame(const uint32_t frameIndex)
+	{
+		for(auto& context : _contexts[frameIndex])
+		{
+			context.pool.reset();
+		}
+	}
+
+	uint32_t ParallelCommandRecorder::getTaskCount(const uint32_t itemCount) const
+	{
+		const uint32_t wantedTasks = std::max(1u, itemCount / MIN_ITEMS_PER_RECORDING_THREAD);
+		return std::min(wantedTasks, _threadPool.getThreadCount());
+	}
+
+	std::vector<vk::CommandBuffer> ParallelCommandRecorder::record(
+		const uint32_t frameIndex, const vk::CommandBufferInheritanceRenderingInfo& renderingInfo,
+		const uint32_t itemCount, const RecordFunction& record
+	)
+	{
+		if(itemCount == 0) return {};
+
+		const uint32_t taskCount = getTaskCount(itemCount);
+		const uint32_t itemsPerTask = (itemCount + taskCount - 1) / taskCount;
+		const uint32_t usedTasks = (itemCount + itemsPerTask - 1) / itemsPerTask;
+
+		auto& frameContexts = _contexts[frameIndex];
+
+		_threadPool.parallelFor(
+			itemCount,
+			taskCount,
+			[&](const uint32_t task, const uint32_t begin, const uint32_t end)
+			{
+				const auto& commandBuffer = frameContexts[task].commandBuffer;
+
+				const vk::CommandBufferInheritanceInfo inheritanceInfo(
+					{},
+					0,
+					{},
+					vk::False,
+					{},
+					{},
+					&renderingInfo
+				);
+
+				commandBuffer.begin(vk::CommandBufferBeginInfo(
+					vk::CommandBufferUsageFlagBits::eRenderPassContinue |
+					vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+					&inheritanceInfo
+				));
+
+				record(commandBuffer, begin, end);
+
+				commandBuffer.end();
+			}
+		);
+
+		std::vector<vk::CommandBuffer> commandBuffers;
+		commandBuffers.reserve(usedTasks);
+		for(uint32_t task = 0; task < usedTasks; task++)
+		{
+			commandBuffers.push_back(*frameContexts[task].commandBuffer);
+		}
+
+		return commandBuffers;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <Core/ThreadPool.h>
+
+namespace Renderer
+{
+	/**
+	 * Below this many items per thread the split costs more than it saves
+	 */
+	constexpr uint32_t MIN_ITEMS_PER_RECORDING_THREAD = 256;
+
+	/**
+	 * Records a range of items into secondary command buffers on the thread pool.
+	 * Every recording task owns one command pool per frame in flight, so no pool is ever touched by two threads
+	 * and a whole frame is recycled with a single pool reset.
+	 */
+	class ParallelCommandRecorder
+	{
+	public:
+		/**
+		 * Records items [begin, end) into a secondary command buffer that's already inside dynamic rendering
+		 */
+		using RecordFunction = std::function<void(const vk::raii::CommandBuffer&, uint32_t begin, uint32_t end)>;
+
+		/**
+		 * @param device Logical device
+		 * @param queueFamilyIndex Family the primary command buffers are submitted to
+		 * @param framesInFlight Number of frames that can be recorded before the oldest one is finished
+		 * @param threadPool Workers used for recording
+		 */
+		ParallelCommandRecorder(
+			const vk::raii::Device& device,
+			uint32_t queueFamilyIndex,
+			uint32_t framesInFlight,
+			Core::ThreadPool& threadPool
+		);
+		~ParallelCommandRecorder() = default;
+
+		ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+		ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+		/**
+		 * Resets every pool of the frame, call only after the frame is finished on the GPU
+		 */
+		void beginFrame(uint32_t frameIndex);
+
+		/**
+		 * @return Number of tasks record() would split the items into
+		 */
+		[[nodiscard]] uint32_t getTaskCount(uint32_t itemCount) const;
+
+		/**
+		 * Records the items split across the workers
+		 *
+		 * @param frameIndex Frame in flight the buffers belong to
+		 * @param renderingInfo Formats of the dynamic rendering the buffers are executed in
+		 * @param itemCount Number of items
+		 * @param record Called once per task from a worker thread
+		 * @return Secondary command buffers, in item order, ready for executeCommands
+		 */
+		std::vector<vk::CommandBuffer> record(
+			uint32_t frameIndex,
+			const vk::CommandBufferInheritanceRenderingInfo& renderingInfo,
+			uint32_t itemCount,
+			const RecordFunction& record
+		);
+
+	private:
+		struct TaskContext
+		{
+			vk::raii::CommandPool pool = VK_NULL_HANDLE;
+			vk::raii::CommandBuffer commandBuffer = VK_NULL_HANDLE;
+		};
+
+		const vk::raii::Device& _device;
+		Core::ThreadPool& _threadPool;
+
+		// [frame][task]
+		std::vector<std::vector<TaskContext>> _contexts;
+	};
+}
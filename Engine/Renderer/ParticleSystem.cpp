@@ -0,0 +1,553 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include <AssetManager.h>
+
+namespace Renderer
+{
+	namespace
+	{
+		// In Kernel order
+		constexpr std::array<const char*, 8> KERNEL_ENTRY_POINTS = {
+			"beginMain",
+			"emitMain",
+			"simulateMain",
+			"finishMain",
+			"sortLocalMain",
+			"sortStepMain",
+			"sortMergeMain",
+			"resetMain"
+		};
+
+		// Particle of the shaders: position, age, velocity, lifetime and color
+		constexpr vk::DeviceSize PARTICLE_SIZE = 48;
+
+		// numthreads of the kernels
+		constexpr uint32_t GROUP_SIZE = 64;
+		constexpr uint32_t SORT_STEP_GROUP_SIZE = 256;
+
+		/**
+		 * Makes the writes of the previous dispatch visible to the next one and to the indirect arguments it reads
+		 */
+		void computeBarrier(
+			const vk::raii::CommandBuffer& commandBuffer,
+			const vk::PipelineStageFlags2 srcStages = vk::PipelineStageFlagBits2::eComputeShader,
+			const vk::AccessFlags2 srcAccess = vk::AccessFlagBits2::eShaderStorageWrite
+		)
+		{
+			const vk::MemoryBarrier2 barrier(
+				srcStages,
+				srcAccess,
+				vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eDrawIndirect,
+				vk::AccessFlagBits2::eShaderStorageRead |
+				vk::AccessFlagBits2::eShaderStorageWrite |
+				vk::AccessFlagBits2::eIndirectCommandRead
+			);
+
+			commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, 1, &barrier));
+		}
+	}
+
+	ParticleSystem::ParticleSystem(
+		const vk::raii::Device& device, MemoryAllocator& allocator, RingBuffer& frameRing, BindlessTable& bindlessTable,
+		ShaderLibrary& shaderLibrary, const PipelineCache& pipelineCache, const vk::Format colorFormat,
+		const uint32_t capacity
+	) : _device(device), _allocator(allocator), _frameRing(frameRing), _bindlessTable(bindlessTable),
+		_shaderLibrary(shaderLibrary), _pipelineCache(pipelineCache), _colorFormat(colorFormat), _capacity(capacity)
+	{
+		if(capacity == 0 || capacity > PARTICLE_MAX_CAPACITY)
+		{
+			throw std::runtime_error(
+				"Failed to create particle system: the capacity has to be in [1, " +
+				std::to_string(PARTICLE_MAX_CAPACITY) + "]."
+			);
+		}
+
+		// Bitonic sort works on powers of two, the padding sorts after every particle
+		_sortSize = std::max(std::bit_ceil(capacity), PARTICLE_SORT_BLOCK);
+
+		createBuffer(
+			static_cast<vk::DeviceSize>(capacity) * PARTICLE_SIZE,
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			_particleBuffer,
+			_particleBufferAllocation
+		);
+		createBuffer(
+			static_cast<vk::DeviceSize>(capacity) * 2 * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			_aliveBuffer,
+			_aliveBufferAllocation
+		);
+		createBuffer(
+			static_cast<vk::DeviceSize>(capacity) * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			_deadBuffer,
+			_deadBufferAllocation
+		);
+		createBuffer(
+			static_cast<vk::DeviceSize>(_sortSize) * 2 * sizeof(uint32_t),
+			vk::BufferUsageFlagBits::eStorageBuffer,
+			_sortBuffer,
+			_sortBufferAllocation
+		);
+		// Cleared with fillBuffer when the particles are reset
+		createBuffer(
+			sizeof(ParticleCounters),
+			vk::BufferUsageFlagBits::eStorageBuffer |
+			vk::BufferUsageFlagBits::eIndirectBuffer |
+			vk::BufferUsageFlagBits::eTransferDst,
+			_counterBuffer,
+			_counterBufferAllocation
+		);
+
+		_particleHandle = _bindlessTable.addStorageBuffer(_particleBuffer);
+		_aliveHandle = _bindlessTable.addStorageBuffer(_aliveBuffer);
+		_deadHandle = _bindlessTable.addStorageBuffer(_deadBuffer);
+		_sortHandle = _bindlessTable.addStorageBuffer(_sortBuffer);
+		_counterHandle = _bindlessTable.addStorageBuffer(_counterBuffer);
+
+		// One layout for the compute and draw pipelines: the bindless set and the particle push constants
+		const auto layout = _shaderLibrary.getPipelineLayout(loadStages());
+		if(layout.pushConstantSize != sizeof(ParticlePushConstants))
+		{
+			throw std::runtime_error(
+				"Failed to create particle system: the shaders push " + std::to_string(layout.pushConstantSize) +
+				" bytes, ParticlePushConstants has " + std::to_string(sizeof(ParticlePushConstants)) + "."
+			);
+		}
+
+		_pipelineLayout = layout.layout;
+		_pushConstantStages = layout.pushConstantStages;
+
+		_computePipelines.reserve(KernelCount);
+		for(uint32_t kernel = 0; kernel < KernelCount; kernel++)
+			_computePipelines.push_back(buildComputePipeline(static_cast<Kernel>(kernel)));
+
+		_drawPipeline = buildDrawPipeline();
+
+		std::printf(
+			"Particles -> %u particles, %.2f MB\n",
+			capacity,
+			static_cast<double>(
+				getParticleBufferSize() + getSortBufferSize() + static_cast<vk::DeviceSize>(capacity) * 3 * sizeof(uint32_t)
+			) / (1024.0 * 1024.0)
+		);
+	}
+
+	void ParticleSystem::setEmitter(const ParticleEmitterSettings& emitter)
+	{
+		_emitter = emitter;
+	}
+
+	const ParticleEmitterSettings& ParticleSystem::getEmitter() const
+	{
+		return _emitter;
+	}
+
+	void ParticleSystem::setSorted(const bool isSorted)
+	{
+		_isSorted = isSorted;
+	}
+
+	bool ParticleSystem::isSorted() const
+	{
+		return _isSorted;
+	}
+
+	void ParticleSystem::clear()
+	{
+		_isResetPending = true;
+	}
+
+	uint32_t ParticleSystem::getCapacity() const
+	{
+		return _capacity;
+	}
+
+	void ParticleSystem::addToHotReload(ShaderHotReload& hotReload)
+	{
+		hotReload.addShader(
+			"particles",
+			std::vector<std::string>(KERNEL_ENTRY_POINTS.begin(), KERNEL_ENTRY_POINTS.end())
+		);
+		hotReload.addShader("particle_draw", {"vertMain", "fragMain"});
+
+		for(uint32_t kernel = 0; kernel < KernelCount; kernel++)
+		{
+			hotReload.addPipeline(
+				{"particles"},
+				_computePipelines[kernel],
+				[this, kernel] { return buildComputePipeline(static_cast<Kernel>(kernel)); }
+			);
+		}
+
+		hotReload.addPipeline({"particle_draw"}, _drawPipeline, [this] { return buildDrawPipeline(); });
+	}
+
+	void ParticleSystem::recordSimulation(
+		const vk::raii::CommandBuffer& commandBuffer, const BindlessHandle frameRingHandle,
+		const vk::DeviceSize uniformOffset
+	)
+	{
+		// The first frame only emits, it has no previous frame to measure from
+		const auto now = Clock::now();
+		const float deltaTime = _lastSimulation == Clock::time_point{}
+			? 0.0f
+			: std::min(std::chrono::duration<float>(now - _lastSimulation).count(), PARTICLE_MAX_DELTA_TIME);
+		_lastSimulation = now;
+
+		// Fractions add up over the frames, a low rate still emits on average
+		const float toEmit = _emitter.particlesPerSecond * deltaTime + _emitRemainder;
+		const float emitted = std::floor(toEmit);
+		_emitRemainder = toEmit - emitted;
+
+		ParticleFrameData frame{};
+		frame.emitterPosition = glm::vec4(_emitter.position, _emitter.spawnRadius);
+		frame.emitterVelocity = glm::vec4(_emitter.velocity, _emitter.velocitySpread);
+		frame.startColor = _emitter.startColor;
+		frame.endColor = _emitter.endColor;
+		frame.gravity = glm::vec4(_emitter.gravity, _emitter.drag);
+		frame.deltaTime = deltaTime;
+		frame.lifetime = _emitter.lifetime;
+		frame.size = _emitter.size;
+		frame.emitCount = static_cast<uint32_t>(std::min(emitted, static_cast<float>(_capacity)));
+		frame.current = _current;
+		frame.seed = _seed++;
+
+		const auto frameData = _frameRing.write(&frame, sizeof(frame));
+		_hasFrameData = static_cast<bool>(frameData);
+		if(!_hasFrameData) return;
+
+		_pushConstants = {};
+		_pushConstants.frameBuffer = frameRingHandle;
+		_pushConstants.uniformOffset = static_cast<uint32_t>(uniformOffset);
+		_pushConstants.frameOffset = static_cast<uint32_t>(frameData.offset);
+		_pushConstants.particleBuffer = _particleHandle;
+		_pushConstants.aliveBuffer = _aliveHandle;
+		_pushConstants.deadBuffer = _deadHandle;
+		_pushConstants.sortBuffer = _sortHandle;
+		_pushConstants.counterBuffer = _counterHandle;
+		_pushConstants.capacity = _capacity;
+		_pushConstants.sortSize = _sortSize;
+
+		_bindlessTable.bind(commandBuffer, vk::PipelineBindPoint::eCompute, _pipelineLayout);
+		commandBuffer.pushConstants<ParticlePushConstants>(_pipelineLayout, _pushConstantStages, 0, _pushConstants);
+
+		// The previous frame drew from these buffers and wrote them in compute, nothing else orders it before this one
+		computeBarrier(
+			commandBuffer,
+			vk::PipelineStageFlagBits2::eComputeShader |
+			vk::PipelineStageFlagBits2::eVertexShader |
+			vk::PipelineStageFlagBits2::eDrawIndirect
+		);
+
+		if(_isResetPending)
+		{
+			commandBuffer.fillBuffer(*_counterBuffer, 0, vk::WholeSize, 0);
+			computeBarrier(commandBuffer, vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite);
+
+			dispatch(commandBuffer, Reset, (_capacity + GROUP_SIZE - 1) / GROUP_SIZE);
+			computeBarrier(commandBuffer);
+
+			_isResetPending = false;
+		}
+
+		dispatch(commandBuffer, Begin, 1);
+		computeBarrier(commandBuffer);
+
+		dispatchIndirect(commandBuffer, Emit, offsetof(ParticleCounters, emitArgs));
+		computeBarrier(commandBuffer);
+
+		dispatchIndirect(commandBuffer, Simulate, offsetof(ParticleCounters, simulateArgs));
+		computeBarrier(commandBuffer);
+
+		dispatch(commandBuffer, Finish, 1);
+
+		if(_isSorted)
+		{
+			computeBarrier(commandBuffer);
+			recordSort(commandBuffer);
+		}
+
+		// The survivors are in the other list now
+		_current = 1 - _current;
+	}
+
+	void ParticleSystem::recordDraw(
+		const vk::raii::CommandBuffer& commandBuffer, const vk::ImageView colorTarget, const vk::Extent2D extent
+	) const
+	{
+		if(!_hasFrameData) return;
+
+		// Blended over what the scene rendered
+		const vk::RenderingAttachmentInfo attachmentInfo(
+			colorTarget,
+			vk::ImageLayout::eColorAttachmentOptimal,
+			{},
+			{},
+			{},
+			vk::AttachmentLoadOp::eLoad,
+			vk::AttachmentStoreOp::eStore
+		);
+
+		const vk::RenderingInfo renderingInfo({}, vk::Rect2D({0, 0}, extent), 1, {}, 1, &attachmentInfo);
+		commandBuffer.beginRendering(renderingInfo);
+
+		commandBuffer.setViewport(
+			0,
+			vk::Viewport(0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f)
+		);
+		commandBuffer.setScissor(0, vk::Rect2D({0, 0}, extent));
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, _drawPipeline);
+		_bindlessTable.bind(commandBuffer, vk::PipelineBindPoint::eGraphics, _pipelineLayout);
+		commandBuffer.pushConstants<ParticlePushConstants>(_pipelineLayout, _pushConstantStages, 0, _pushConstants);
+
+		// Six vertices per particle, the instance count was written by the simulation
+		commandBuffer.drawIndirect(
+			*_counterBuffer,
+			offsetof(ParticleCounters, drawArgs),
+			1,
+			sizeof(vk::DrawIndirectCommand)
+		);
+
+		commandBuffer.endRendering();
+	}
+
+	vk::Buffer ParticleSystem::getParticleBuffer() const
+	{
+		return *_particleBuffer;
+	}
+
+	vk::DeviceSize ParticleSystem::getParticleBufferSize() const
+	{
+		return static_cast<vk::DeviceSize>(_capacity) * PARTICLE_SIZE;
+	}
+
+	vk::Buffer ParticleSystem::getSortBuffer() const
+	{
+		return *_sortBuffer;
+	}
+
+	vk::DeviceSize ParticleSystem::getSortBufferSize() const
+	{
+		return static_cast<vk::DeviceSize>(_sortSize) * 2 * sizeof(uint32_t);
+	}
+
+	vk::Buffer ParticleSystem::getCounterBuffer() const
+	{
+		return *_counterBuffer;
+	}
+
+	vk::DeviceSize ParticleSystem::getCounterBufferSize() const
+	{
+		return sizeof(ParticleCounters);
+	}
+
+	void ParticleSystem::createBuffer(
+		const vk::DeviceSize size, const vk::BufferUsageFlags usage, vk::raii::Buffer& buffer, Allocation& allocation
+	)
+	{
+		// Only the graphics queue touches them
+		const vk::BufferCreateInfo bufferInfo({}, size, usage);
+		buffer = vk::raii::Buffer(_device, bufferInfo);
+
+		allocation = _allocator.allocateForBuffer(buffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	}
+
+	std::vector<ShaderStage> ParticleSystem::loadStages() const
+	{
+		const auto simulation = _shaderLibrary.getModule(
+			Assets::AssetManager::load<Assets::AssetType::Shader>("particles")->spirV
+		);
+		const auto draw = _shaderLibrary.getModule(
+			Assets::AssetManager::load<Assets::AssetType::Shader>("particle_draw")->spirV
+		);
+
+		static_assert(KERNEL_ENTRY_POINTS.size() == KernelCount, "Every kernel needs its entry point.");
+
+		std::vector<ShaderStage> stages;
+		stages.reserve(KERNEL_ENTRY_POINTS.size() + 2);
+		for(const auto* entryPoint : KERNEL_ENTRY_POINTS)
+			stages.push_back({simulation, entryPoint});
+
+		stages.push_back({draw, "vertMain"});
+		stages.push_back({draw, "fragMain"});
+		return stages;
+	}
+
+	void ParticleSystem::checkLayout(const std::span<const ShaderStage> stages) const
+	{
+		if(_shaderLibrary.getPipelineLayout(stages).layout != _pipelineLayout)
+			throw std::runtime_error("Failed to build particle pipeline: the shader interface changed, it needs a restart.");
+	}
+
+	vk::raii::Pipeline ParticleSystem::buildComputePipeline(const Kernel kernel) const
+	{
+		const auto stages = loadStages();
+		checkLayout(stages);
+
+		const auto& stage = stages[kernel];
+
+		const vk::ComputePipelineCreateInfo pipelineInfo(
+			{},
+			stage.module->getStageInfo(stage.entryPoint),
+			_pipelineLayout
+		);
+
+		return vk::raii::Pipeline(_device, _pipelineCache.getCache(), pipelineInfo);
+	}
+
+	vk::raii::Pipeline ParticleSystem::buildDrawPipeline() const
+	{
+		const auto stages = loadStages();
+		checkLayout(stages);
+
+		const auto& vertStage = stages[KernelCount];
+		const auto& fragStage = stages[KernelCount + 1];
+
+		const vk::PipelineShaderStageCreateInfo shaderStages[] = {
+			vertStage.module->getStageInfo(vertStage.entryPoint),
+			fragStage.module->getStageInfo(fragStage.entryPoint)
+		};
+
+		// The quads are built from the vertex and instance index, no vertex buffers
+		const vk::PipelineVertexInputStateCreateInfo vertexInputInfo;
+
+		const vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo({}, vk::PrimitiveTopology::eTriangleList);
+
+		const std::vector dynamicStates = {
+			vk::DynamicState::eViewport,
+			vk::DynamicState::eScissor
+		};
+
+		const vk::PipelineViewportStateCreateInfo viewportStateInfo({}, 1, {}, 1, {});
+
+		const vk::PipelineDynamicStateCreateInfo pipelineDynamicStateInfo(
+			{},
+			dynamicStates.size(),
+			dynamicStates.data()
+		);
+
+		const vk::PipelineRasterizationStateCreateInfo rasterizationStateInfo(
+			{},
+			vk::False,
+			vk::False,
+			vk::PolygonMode::eFill,
+			vk::CullModeFlagBits::eNone,
+			vk::FrontFace::eCounterClockwise,
+			vk::False,
+			{},
+			{},
+			{},
+			1.0f
+		);
+
+		// Over blending, correct back to front (which is what the sort is for)
+		const vk::PipelineColorBlendAttachmentState colorBlendAttachmentState(
+			vk::True,
+			vk::BlendFactor::eSrcAlpha,
+			vk::BlendFactor::eOneMinusSrcAlpha,
+			vk::BlendOp::eAdd,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eOneMinusSrcAlpha,
+			vk::BlendOp::eAdd,
+			vk::ColorComponentFlagBits::eR |
+			vk::ColorComponentFlagBits::eG |
+			vk::ColorComponentFlagBits::eB |
+			vk::ColorComponentFlagBits::eA
+		);
+
+		const vk::PipelineColorBlendStateCreateInfo colorBlendingInfo(
+			{},
+			vk::False,
+			vk::LogicOp::eCopy,
+			1,
+			&colorBlendAttachmentState
+		);
+
+		const vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateInfo({}, vk::SampleCountFlagBits::e1);
+
+		const vk::PipelineRenderingCreateInfo pipelineRenderingInfo({}, 1, &_colorFormat);
+
+		const vk::GraphicsPipelineCreateInfo pipelineInfo(
+			{},
+			2,
+			shaderStages,
+			&vertexInputInfo,
+			&inputAssemblyInfo,
+			{},
+			&viewportStateInfo,
+			&rasterizationStateInfo,
+			&pipelineMultisampleStateInfo,
+			{},
+			&colorBlendingInfo,
+			&pipelineDynamicStateInfo,
+			_pipelineLayout,
+			VK_NULL_HANDLE,
+			{},
+			VK_NULL_HANDLE,
+			-1,
+			&pipelineRenderingInfo
+		);
+
+		return vk::raii::Pipeline(_device, _pipelineCache.getCache(), pipelineInfo);
+	}
+
+	void ParticleSystem::dispatch(
+		const vk::raii::CommandBuffer& commandBuffer, const Kernel kernel, const uint32_t groupCount
+	) const
+	{
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _computePipelines[kernel]);
+		commandBuffer.dispatch(groupCount, 1, 1);
+	}
+
+	void ParticleSystem::dispatchIndirect(
+		const vk::raii::CommandBuffer& commandBuffer, const Kernel kernel, const vk::DeviceSize argsOffset
+	) const
+	{
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _computePipelines[kernel]);
+		commandBuffer.dispatchIndirect(*_counterBuffer, argsOffset);
+	}
+
+	void ParticleSystem::recordSort(const vk::raii::CommandBuffer& commandBuffer)
+	{
+		const uint32_t blockCount = _sortSize / PARTICLE_SORT_BLOCK;
+		const uint32_t stepGroupCount = _sortSize / 2 / SORT_STEP_GROUP_SIZE;
+
+		// Every merge with k <= PARTICLE_SORT_BLOCK happens in shared memory, in one dispatch
+		dispatch(commandBuffer, SortLocal, blockCount);
+		computeBarrier(commandBuffer);
+
+		// Larger merges: global steps while the pairs are a block or more apart, then the rest in shared memory
+		for(uint32_t k = PARTICLE_SORT_BLOCK * 2; k <= _sortSize; k <<= 1)
+		{
+			_pushConstants.sortK = k;
+
+			for(uint32_t j = k / 2; j >= PARTICLE_SORT_BLOCK; j >>= 1)
+			{
+				_pushConstants.sortJ = j;
+				commandBuffer.pushConstants<ParticlePushConstants>(
+					_pipelineLayout,
+					_pushConstantStages,
+					0,
+					_pushConstants
+				);
+
+				dispatch(commandBuffer, SortStep, stepGroupCount);
+				computeBarrier(commandBuffer);
+			}
+
+			commandBuffer.pushConstants<ParticlePushConstants>(_pipelineLayout, _pushConstantStages, 0, _pushConstants);
+			dispatch(commandBuffer, SortMerge, blockCount);
+			computeBarrier(commandBuffer);
+		}
+	}
+}
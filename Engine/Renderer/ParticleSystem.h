@@ -0,0 +1,301 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "BindlessTable.h"
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
+#include "RingBuffer.h"
+#include "ShaderHotReload.h"
+#include "ShaderLibrary.h"
+
+namespace Renderer
+{
+	/**
+	 * Most particles a system holds, keeps every dispatch under the 65535 workgroup limit
+	 */
+	constexpr uint32_t PARTICLE_MAX_CAPACITY = 1u << 21;
+
+	/**
+	 * Entries a workgroup of the particle sort handles in shared memory (SORT_BLOCK of particles.slang)
+	 */
+	constexpr uint32_t PARTICLE_SORT_BLOCK = 1024;
+
+	/**
+	 * Longest step the simulation integrates, a hitch doesn't throw the particles across the scene
+	 */
+	constexpr float PARTICLE_MAX_DELTA_TIME = 0.1f;
+
+	/**
+	 * Where and how particles are emitted, and the forces acting on them
+	 */
+	struct ParticleEmitterSettings
+	{
+		glm::vec3 position = glm::vec3(0.0f);
+		float spawnRadius = 0.05f;
+
+		glm::vec3 velocity = glm::vec3(0.0f, 0.0f, 1.5f);
+		// Random speed added in every direction
+		float velocitySpread = 0.5f;
+
+		// Interpolated over the lifetime, the alpha fades with the color
+		glm::vec4 startColor = glm::vec4(1.0f, 0.6f, 0.2f, 1.0f);
+		glm::vec4 endColor = glm::vec4(0.2f, 0.2f, 1.0f, 0.0f);
+
+		glm::vec3 gravity = glm::vec3(0.0f, 0.0f, -1.0f);
+		float drag = 0.5f;
+
+		float particlesPerSecond = 10000.0f;
+		// Average lifetime in seconds, every particle varies by 25%
+		float lifetime = 2.0f;
+		// Half the width of the quad in view space
+		float size = 0.01f;
+	};
+
+	/**
+	 * ParticleFrame of particles.slang/particle_draw.slang, written into the frame ring every frame
+	 */
+	struct ParticleFrameData
+	{
+		glm::vec4 emitterPosition; // w: spawn radius
+		glm::vec4 emitterVelocity; // w: velocity spread
+		glm::vec4 startColor;
+		glm::vec4 endColor;
+		glm::vec4 gravity; // w: drag
+		float deltaTime;
+		float lifetime;
+		float size;
+		uint32_t emitCount;
+		// Alive list the frame simulates, the survivors go to the other one
+		uint32_t current;
+		uint32_t seed;
+		uint32_t padding[2];
+	};
+
+	/**
+	 * ParticleConstants of the particle shaders, bindless handles and the step of the sort
+	 */
+	struct ParticlePushConstants
+	{
+		uint32_t frameBuffer;
+		uint32_t uniformOffset;
+		uint32_t frameOffset;
+		uint32_t particleBuffer;
+		uint32_t aliveBuffer;
+		uint32_t deadBuffer;
+		uint32_t sortBuffer;
+		uint32_t counterBuffer;
+		uint32_t capacity;
+		uint32_t sortSize;
+		uint32_t sortK;
+		uint32_t sortJ;
+	};
+
+	/**
+	 * Counter buffer of particles.slang, also the source of its indirect dispatches and of the indirect draw
+	 */
+	struct ParticleCounters
+	{
+		uint32_t aliveCount[2];
+		uint32_t deadCount;
+		uint32_t emitCount;
+		uint32_t emitArgs[3];
+		uint32_t simulateArgs[3];
+		uint32_t drawArgs[4];
+	};
+
+	static_assert(sizeof(ParticleFrameData) == 112, "ParticleFrameData must match ParticleFrame of the shaders.");
+	static_assert(offsetof(ParticleCounters, emitArgs) == 16, "ParticleCounters must match particles.slang.");
+	static_assert(offsetof(ParticleCounters, simulateArgs) == 28, "ParticleCounters must match particles.slang.");
+	static_assert(offsetof(ParticleCounters, drawArgs) == 40, "ParticleCounters must match particles.slang.");
+
+	/**
+	 * Particles that live on the GPU only: emission, integration and compaction run in compute shaders,
+	 * the survivors are sorted back to front (bitonic sort) and drawn with one indirect draw.
+	 * The CPU only decides how many particles are emitted each frame.
+	 *
+	 * Particles are recycled through a dead list. Two alive lists are ping-ponged: a frame simulates one and
+	 * compacts the survivors into the other, whose count sizes the indirect dispatches and the draw.
+	 */
+	class ParticleSystem
+	{
+	public:
+		/**
+		 * @param device Logical device
+		 * @param allocator Allocator of the particle buffers
+		 * @param frameRing Per-frame data of the shaders
+		 * @param bindlessTable Table the buffers are reached through
+		 * @param shaderLibrary Library the pipeline layout comes from (set 0 is the bindless table)
+		 * @param pipelineCache Cache the pipelines are created with
+		 * @param colorFormat Format of the target the particles are blended into
+		 * @param capacity Most particles alive at once, at most PARTICLE_MAX_CAPACITY
+		 */
+		ParticleSystem(
+			const vk::raii::Device& device,
+			MemoryAllocator& allocator,
+			RingBuffer& frameRing,
+			BindlessTable& bindlessTable,
+			ShaderLibrary& shaderLibrary,
+			const PipelineCache& pipelineCache,
+			vk::Format colorFormat,
+			uint32_t capacity
+		);
+		~ParticleSystem() = default;
+
+		ParticleSystem(const ParticleSystem&) = delete;
+		ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+		void setEmitter(const ParticleEmitterSettings& emitter);
+
+		[[nodiscard]] const ParticleEmitterSettings& getEmitter() const;
+
+		/**
+		 * Sorting is only needed for alpha blending, it costs log2(capacity) passes over the sort buffer per frame
+		 */
+		void setSorted(bool isSorted);
+
+		[[nodiscard]] bool isSorted() const;
+
+		/**
+		 * Kills every particle at the start of the next frame
+		 */
+		void clear();
+
+		[[nodiscard]] uint32_t getCapacity() const;
+
+		/**
+		 * Rebuilds the particle pipelines when their shaders change, call before the reloader is started
+		 */
+		void addToHotReload(ShaderHotReload& hotReload);
+
+		/**
+		 * Records the emission, simulation and sort of this frame (outside of rendering)
+		 *
+		 * @param frameRingHandle Bindless handle of the frame ring
+		 * @param uniformOffset Offset of this frame's uniform data in the ring (camera of the sort and the quads)
+		 */
+		void recordSimulation(
+			const vk::raii::CommandBuffer& commandBuffer,
+			BindlessHandle frameRingHandle,
+			vk::DeviceSize uniformOffset
+		);
+
+		/**
+		 * Blends the particles over the color target with the indirect draw written by recordSimulation
+		 */
+		void recordDraw(const vk::raii::CommandBuffer& commandBuffer, vk::ImageView colorTarget, vk::Extent2D extent) const;
+
+		[[nodiscard]] vk::Buffer getParticleBuffer() const;
+		[[nodiscard]] vk::DeviceSize getParticleBufferSize() const;
+
+		[[nodiscard]] vk::Buffer getSortBuffer() const;
+		[[nodiscard]] vk::DeviceSize getSortBufferSize() const;
+
+		[[nodiscard]] vk::Buffer getCounterBuffer() const;
+		[[nodiscard]] vk::DeviceSize getCounterBufferSize() const;
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// Compute entry points of particles.slang, in the order of _computePipelines
+		enum Kernel : uint32_t
+		{
+			Begin,
+			Emit,
+			Simulate,
+			Finish,
+			SortLocal,
+			SortStep,
+			SortMerge,
+			Reset,
+			KernelCount
+		};
+
+		const vk::raii::Device& _device;
+		MemoryAllocator& _allocator;
+		RingBuffer& _frameRing;
+		BindlessTable& _bindlessTable;
+		ShaderLibrary& _shaderLibrary;
+		const PipelineCache& _pipelineCache;
+		vk::Format _colorFormat;
+
+		uint32_t _capacity = 0;
+		// Power of two the sort is padded to
+		uint32_t _sortSize = 0;
+
+		ParticleEmitterSettings _emitter;
+		bool _isSorted = true;
+		bool _isResetPending = true;
+
+		uint32_t _current = 0;
+		uint32_t _seed = 0;
+		// Fraction of a particle carried to the next frame
+		float _emitRemainder = 0.0f;
+		Clock::time_point _lastSimulation{};
+
+		// Written by recordSimulation for the draw of the same frame, the draw is skipped without them
+		ParticlePushConstants _pushConstants{};
+		bool _hasFrameData = false;
+
+		Allocation _particleBufferAllocation;
+		vk::raii::Buffer _particleBuffer = VK_NULL_HANDLE;
+
+		// Two lists of capacity indices
+		Allocation _aliveBufferAllocation;
+		vk::raii::Buffer _aliveBuffer = VK_NULL_HANDLE;
+
+		Allocation _deadBufferAllocation;
+		vk::raii::Buffer _deadBuffer = VK_NULL_HANDLE;
+
+		// (key, particle index) pairs of the survivors, _sortSize of them
+		Allocation _sortBufferAllocation;
+		vk::raii::Buffer _sortBuffer = VK_NULL_HANDLE;
+
+		Allocation _counterBufferAllocation;
+		vk::raii::Buffer _counterBuffer = VK_NULL_HANDLE;
+
+		BindlessHandle _particleHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _aliveHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _deadHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _sortHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _counterHandle = INVALID_BINDLESS_HANDLE;
+
+		// Reflected from the particle shaders, owned by _shaderLibrary
+		vk::PipelineLayout _pipelineLayout;
+		vk::ShaderStageFlags _pushConstantStages;
+
+		std::vector<vk::raii::Pipeline> _computePipelines;
+		vk::raii::Pipeline _drawPipeline = VK_NULL_HANDLE;
+
+		void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::raii::Buffer& buffer, Allocation& allocation);
+
+		/**
+		 * @return Compute stages of "particles" (in Kernel order), then the vertex and fragment stage of "particle_draw"
+		 */
+		[[nodiscard]] std::vector<ShaderStage> loadStages() const;
+
+		/**
+		 * Throws if the stages don't have _pipelineLayout anymore (the interface changed since creation)
+		 */
+		void checkLayout(std::span<const ShaderStage> stages) const;
+
+		[[nodiscard]] vk::raii::Pipeline buildComputePipeline(Kernel kernel) const;
+
+		[[nodiscard]] vk::raii::Pipeline buildDrawPipeline() const;
+
+		void dispatch(const vk::raii::CommandBuffer& commandBuffer, Kernel kernel, uint32_t groupCount) const;
+
+		void dispatchIndirect(const vk::raii::CommandBuffer& commandBuffer, Kernel kernel, vk::DeviceSize argsOffset) const;
+
+		/**
+		 * Records the bitonic sort of the survivors over _sortSize entries
+		 */
+		void recordSort(const vk::raii::CommandBuffer& commandBuffer);
+	};
+}
@@ -0,0 +1,158 @@
+#include "PipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace Renderer
+{
+	namespace
+	{
+		constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x48435045; // "EPCH"
+		constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+		uint64_t hashBytes(const char* data, const size_t size)
+		{
+			// FNV-1a, only guards against truncated and corrupted files
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for(size_t i = 0; i < size; i++)
+			{
+				hash ^= static_cast<uint8_t>(data[i]);
+				hash *= 0x100000001b3ull;
+			}
+			return hash;
+		}
+	}
+
+	PipelineCache::PipelineCache(
+		const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, std::string path
+	) : _path(std::move(path)), _properties(physicalDevice.getProperties())
+	{
+		const auto data = loadValidData();
+		_isWarm = !data.empty();
+
+		const vk::PipelineCacheCreateInfo createInfo(
+			{},
+			data.size(),
+			data.data()
+		);
+		_cache = vk::raii::PipelineCache(device, createInfo);
+
+		std::printf(
+			"Pipeline cache -> %s (%zu bytes)\n",
+			_isWarm ? "loaded" : "cold start",
+			data.size()
+		);
+	}
+
+	std::vector<char> PipelineCache::loadValidData() const
+	{
+		std::ifstream file(_path, std::ios::binary);
+		if(!file.is_open()) return {};
+
+		FileHeader header{};
+		if(!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return {};
+
+		const auto expected = makeHeader(header.dataSize, header.dataHash);
+		if(std::memcmp(&header, &expected, sizeof(header)) != 0)
+		{
+			std::printf("Pipeline cache -> %s was made for another device or driver, ignoring it\n", _path.c_str());
+			return {};
+		}
+
+		// Bounded by the file before anything is allocated from it
+		std::error_code error;
+		const uint64_t fileSize = std::filesystem::file_size(_path, error);
+		if(error || header.dataSize != fileSize - sizeof(header))
+		{
+			std::printf("Pipeline cache -> %s is corrupted, ignoring it\n", _path.c_str());
+			return {};
+		}
+
+		std::vector<char> data(header.dataSize);
+		if(!file.read(data.data(), static_cast<std::streamsize>(data.size())) ||
+			hashBytes(data.data(), data.size()) != header.dataHash)
+		{
+			std::printf("Pipeline cache -> %s is corrupted, ignoring it\n", _path.c_str());
+			return {};
+		}
+
+		// The driver's own header (VkPipelineCacheHeaderVersionOne) has to agree as well
+		constexpr size_t driverHeaderSize = 16 + vk::UuidSize;
+		if(data.size() < driverHeaderSize) return {};
+
+		uint32_t driverHeader[4];
+		std::memcpy(driverHeader, data.data(), sizeof(driverHeader));
+
+		if(driverHeader[1] != static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne) ||
+			driverHeader[2] != _properties.vendorID ||
+			driverHeader[3] != _properties.deviceID ||
+			std::memcmp(data.data() + 16, _properties.pipelineCacheUUID.data(), vk::UuidSize) != 0)
+		{
+			return {};
+		}
+
+		return data;
+	}
+
+	PipelineCache::FileHeader PipelineCache::makeHeader(const uint64_t dataSize, const uint64_t dataHash) const
+	{
+		FileHeader header{};
+		header.magic = PIPELINE_CACHE_MAGIC;
+		header.version = PIPELINE_CACHE_FILE_VERSION;
+		header.vendorID = _properties.vendorID;
+		header.deviceID = _properties.deviceID;
+		header.driverVersion = _properties.driverVersion;
+		std::memcpy(header.pipelineCacheUUID, _properties.pipelineCacheUUID.data(), vk::UuidSize);
+		header.dataSize = dataSize;
+		header.dataHash = dataHash;
+
+		return header;
+	}
+
+	void PipelineCache::save() const
+	{
+		const auto data = _cache.getData();
+		const auto header = makeHeader(data.size(), hashBytes(reinterpret_cast<const char*>(data.data()), data.size()));
+
+		const std::string temporaryPath = _path + ".tmp";
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if(!file.is_open())
+			{
+				std::printf("Pipeline cache -> failed to open %s for writing\n", temporaryPath.c_str());
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			file.close();
+
+			// A short file must never replace the good cache
+			if(!file.good())
+			{
+				std::printf("Pipeline cache -> failed to write %s\n", temporaryPath.c_str());
+
+				std::error_code error;
+				std::filesystem::remove(temporaryPath, error);
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, _path, error);
+		if(error)
+			std::printf("Pipeline cache -> failed to write %s: %s\n", _path.c_str(), error.message().c_str());
+	}
+
+	const vk::raii::PipelineCache& PipelineCache::getCache() const
+	{
+		return _cache;
+	}
+
+	bool PipelineCache::isWarm() const
+	{
+		return _isWarm;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer
+{
+	/**
+	 * VkPipelineCache persisted between runs.
+	 * The file starts with our own header (device, driver and UUID of the cache), a stale or foreign
+	 * file (driver update, different GPU, truncated write) is dropped and the cache starts cold.
+	 */
+	class PipelineCache
+	{
+	public:
+		/**
+		 * Loads the cache file if it's valid for this device
+		 *
+		 * @param physicalDevice Device the cache is validated against
+		 * @param device Logical device
+		 * @param path Path of the cache file
+		 */
+		PipelineCache(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, std::string path);
+		~PipelineCache() = default;
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		/**
+		 * Writes the cache data back to the file (through a temporary file, so a crash can't leave half of it)
+		 */
+		void save() const;
+
+		[[nodiscard]] const vk::raii::PipelineCache& getCache() const;
+
+		/**
+		 * @return True if the cache was loaded from the file (warm start)
+		 */
+		[[nodiscard]] bool isWarm() const;
+
+	private:
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[vk::UuidSize];
+			uint32_t reserved;
+			uint64_t dataSize;
+			uint64_t dataHash;
+		};
+
+		std::string _path;
+		vk::PhysicalDeviceProperties _properties;
+
+		vk::raii::PipelineCache _cache = VK_NULL_HANDLE;
+		bool _isWarm = false;
+
+		/**
+		 * Reads the file, returns cache data only if both our header and the driver's header match this device
+		 */
+		[[nodiscard]] std::vector<char> loadValidData() const;
+
+		[[nodiscard]] FileHeader makeHeader(uint64_t dataSize, uint64_t dataHash) const;
+	};
+}
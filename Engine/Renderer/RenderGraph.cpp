@@ -0,0 +1,644 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "GpuProfiler.h"
+
+namespace Renderer
+{
+	namespace
+	{
+		struct UsageInfo
+		{
+			vk::PipelineStageFlags2 stages;
+			vk::AccessFlags2 access;
+			vk::ImageLayout layout;
+		};
+
+		constexpr vk::AccessFlags2 WRITE_ACCESS =
+			vk::AccessFlagBits2::eShaderWrite |
+			vk::AccessFlagBits2::eShaderStorageWrite |
+			vk::AccessFlagBits2::eColorAttachmentWrite |
+			vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+			vk::AccessFlagBits2::eTransferWrite |
+			vk::AccessFlagBits2::eHostWrite |
+			vk::AccessFlagBits2::eMemoryWrite;
+
+		UsageInfo getUsageInfo(const ResourceUsage usage)
+		{
+			using Stage = vk::PipelineStageFlagBits2;
+			using Access = vk::AccessFlagBits2;
+			using Layout = vk::ImageLayout;
+
+			switch(usage)
+			{
+			case ResourceUsage::ColorAttachment:
+				return {
+					Stage::eColorAttachmentOutput,
+					Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+					Layout::eColorAttachmentOptimal
+				};
+			case ResourceUsage::DepthStencilAttachment:
+				return {
+					Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+					Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite,
+					Layout::eDepthStencilAttachmentOptimal
+				};
+			case ResourceUsage::DepthStencilRead:
+				return {
+					Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+					Access::eDepthStencilAttachmentRead,
+					Layout::eDepthStencilReadOnlyOptimal
+				};
+			case ResourceUsage::SampledFragment:
+				return {Stage::eFragmentShader, Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal};
+			case ResourceUsage::SampledCompute:
+				return {Stage::eComputeShader, Access::eShaderSampledRead, Layout::eShaderReadOnlyOptimal};
+			case ResourceUsage::StorageReadCompute:
+				return {Stage::eComputeShader, Access::eShaderStorageRead, Layout::eGeneral};
+			case ResourceUsage::StorageWriteCompute:
+				return {
+					Stage::eComputeShader,
+					Access::eShaderStorageRead | Access::eShaderStorageWrite,
+					Layout::eGeneral
+				};
+			case ResourceUsage::StorageReadVertex:
+				return {Stage::eVertexShader, Access::eShaderStorageRead, Layout::eGeneral};
+			case ResourceUsage::IndirectRead:
+				return {Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined};
+			case ResourceUsage::VertexRead:
+				return {Stage::eVertexAttributeInput, Access::eVertexAttributeRead, Layout::eUndefined};
+			case ResourceUsage::IndexRead:
+				return {Stage::eIndexInput, Access::eIndexRead, Layout::eUndefined};
+			case ResourceUsage::UniformRead:
+				return {
+					Stage::eVertexShader | Stage::eFragmentShader | Stage::eComputeShader,
+					Access::eUniformRead,
+					Layout::eUndefined
+				};
+			case ResourceUsage::TransferSrc:
+				return {Stage::eTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal};
+			case ResourceUsage::TransferDst:
+				return {Stage::eTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal};
+			}
+
+			throw std::runtime_error("Failed to resolve resource usage: unknown usage.");
+		}
+
+		vk::ImageAspectFlags getAspectMask(const vk::Format format)
+		{
+			switch(format)
+			{
+			case vk::Format::eD16Unorm:
+			case vk::Format::eX8D24UnormPack32:
+			case vk::Format::eD32Sfloat:
+				return vk::ImageAspectFlagBits::eDepth;
+			case vk::Format::eD16UnormS8Uint:
+			case vk::Format::eD24UnormS8Uint:
+			case vk::Format::eD32SfloatS8Uint:
+				return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+			case vk::Format::eS8Uint:
+				return vk::ImageAspectFlagBits::eStencil;
+			default:
+				return vk::ImageAspectFlagBits::eColor;
+			}
+		}
+
+		vk::ImageSubresourceRange getSubresourceRange(const vk::Format format)
+		{
+			return {getAspectMask(format), 0, vk::RemainingMipLevels, 0, vk::RemainingArrayLayers};
+		}
+	}
+
+	RenderGraph::PassBuilder::PassBuilder(RenderGraph& graph, const uint32_t pass) : _graph(graph), _pass(pass)
+	{
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(const RenderResource resource, const ResourceUsage usage)
+	{
+		_graph.getResource(resource);
+		_graph._passes[_pass].accesses.push_back({resource, usage, false});
+		return *this;
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(const RenderResource resource, const ResourceUsage usage)
+	{
+		_graph.getResource(resource);
+		_graph._passes[_pass].accesses.push_back({resource, usage, true});
+		return *this;
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::sideEffect()
+	{
+		_graph._passes[_pass].hasSideEffect = true;
+		return *this;
+	}
+
+	RenderGraph::RenderGraph(
+		const vk::raii::Device& device, MemoryAllocator& allocator, const uint32_t framesInFlight
+	) : _device(device), _allocator(allocator), _framesInFlight(framesInFlight)
+	{
+	}
+
+	void RenderGraph::reset()
+	{
+		_resources.clear();
+		_passes.clear();
+		_compiledPasses.clear();
+		_finalBarriers.clear();
+		_culledPassCount = 0;
+	}
+
+	RenderResource RenderGraph::importImage(
+		const std::string& name, const vk::Image image, const vk::ImageView view, const vk::Format format,
+		const vk::Extent2D extent, const vk::ImageLayout initialLayout, const vk::ImageLayout finalLayout,
+		const vk::PipelineStageFlags2 waitStage
+	)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.type = ResourceType::ImportedImage;
+		resource.isOutput = finalLayout != vk::ImageLayout::eUndefined;
+		resource.image = image;
+		resource.view = view;
+		resource.format = format;
+		resource.extent = extent;
+		resource.finalLayout = finalLayout;
+		resource.initialState.layout = initialLayout;
+		resource.initialState.readStages = waitStage;
+
+		_resources.push_back(std::move(resource));
+		return static_cast<RenderResource>(_resources.size() - 1);
+	}
+
+	RenderResource RenderGraph::importBuffer(
+		const std::string& name, const vk::Buffer buffer, const vk::DeviceSize offset, const vk::DeviceSize size
+	)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.type = ResourceType::Buffer;
+		resource.buffer = buffer;
+		resource.offset = offset;
+		resource.size = size;
+
+		_resources.push_back(std::move(resource));
+		return static_cast<RenderResource>(_resources.size() - 1);
+	}
+
+	RenderResource RenderGraph::createImage(const std::string& name, const TransientImageDescription& description)
+	{
+		Resource resource{};
+		resource.name = name;
+		resource.type = ResourceType::TransientImage;
+		resource.format = description.format;
+		resource.extent = description.extent;
+		resource.usage = description.usage;
+
+		// The memory may have been used by an aliased image or the previous frame, wait for anything before it
+		resource.initialState.writeStages = vk::PipelineStageFlagBits2::eAllCommands;
+		resource.initialState.writeAccess = vk::AccessFlagBits2::eMemoryWrite;
+
+		_resources.push_back(std::move(resource));
+		return static_cast<RenderResource>(_resources.size() - 1);
+	}
+
+	void RenderGraph::markOutput(const RenderResource resource)
+	{
+		getResource(resource);
+		_resources[resource].isOutput = true;
+	}
+
+	RenderGraph::PassBuilder RenderGraph::addPass(const std::string& name, RenderPassFunction execute)
+	{
+		_passes.push_back({name, std::move(execute)});
+		return {*this, static_cast<uint32_t>(_passes.size() - 1)};
+	}
+
+	void RenderGraph::compile()
+	{
+		_compileCount++;
+		_compiledPasses.clear();
+		_finalBarriers.clear();
+
+		const auto alive = cullPasses();
+		for(uint32_t i = 0; i < _passes.size(); i++)
+		{
+			if(alive[i]) _compiledPasses.push_back({i});
+		}
+		_culledPassCount = static_cast<uint32_t>(_passes.size() - _compiledPasses.size());
+
+		placeTransientImages();
+
+		std::vector<ResourceState> states;
+		states.reserve(_resources.size());
+		for(const auto& resource : _resources)
+		{
+			states.push_back(resource.initialState);
+		}
+
+		for(auto& compiledPass : _compiledPasses)
+		{
+			const auto& pass = _passes[compiledPass.pass];
+
+			// A resource used several times by one pass gets one merged barrier
+			std::vector<std::pair<RenderResource, UsageInfo>> usages;
+			for(const auto& access : pass.accesses)
+			{
+				const auto info = getUsageInfo(access.usage);
+				const auto it = std::ranges::find(usages, access.resource, &std::pair<RenderResource, UsageInfo>::first);
+				if(it == usages.end())
+				{
+					usages.emplace_back(access.resource, info);
+					continue;
+				}
+
+				if(_resources[access.resource].type != ResourceType::Buffer && it->second.layout != info.layout)
+					throw std::runtime_error(
+						"Failed to compile render graph: pass " + pass.name + " uses " +
+						_resources[access.resource].name + " in two different layouts."
+					);
+
+				it->second.stages |= info.stages;
+				it->second.access |= info.access;
+			}
+
+			for(const auto& [resource, info] : usages)
+			{
+				addBarrier(compiledPass, resource, states[resource], info.stages, info.access, info.layout);
+			}
+		}
+
+		// Leave imported images in the layout their owner expects
+		for(uint32_t i = 0; i < _resources.size(); i++)
+		{
+			const auto& resource = _resources[i];
+			const auto& state = states[i];
+
+			if(resource.type != ResourceType::ImportedImage || resource.finalLayout == vk::ImageLayout::eUndefined ||
+				resource.finalLayout == state.layout)
+				continue;
+
+			_finalBarriers.emplace_back(
+				state.writeStages | state.readStages,
+				state.writeAccess,
+				vk::PipelineStageFlagBits2::eBottomOfPipe,
+				vk::AccessFlags2{},
+				state.layout,
+				resource.finalLayout,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				resource.image,
+				getSubresourceRange(resource.format)
+			);
+		}
+	}
+
+	std::vector<bool> RenderGraph::cullPasses() const
+	{
+		std::vector<bool> alive(_passes.size(), false);
+		std::vector<bool> isNeeded(_resources.size(), false);
+
+		for(uint32_t i = 0; i < _resources.size(); i++)
+		{
+			isNeeded[i] = _resources[i].isOutput;
+		}
+
+		// Walk back from the outputs, a pass lives if it writes something a living pass (or the caller) needs
+		for(size_t i = _passes.size(); i-- > 0;)
+		{
+			const auto& pass = _passes[i];
+
+			bool isAlive = pass.hasSideEffect;
+			for(const auto& access : pass.accesses)
+			{
+				if(access.isWrite && isNeeded[access.resource]) isAlive = true;
+			}
+
+			if(!isAlive) continue;
+
+			alive[i] = true;
+			for(const auto& access : pass.accesses)
+			{
+				if(!access.isWrite) isNeeded[access.resource] = true;
+			}
+		}
+
+		return alive;
+	}
+
+	void RenderGraph::placeTransientImages()
+	{
+		// Sets retired before the oldest frame in flight was recorded aren't used by the GPU anymore
+		std::erase_if(
+			_retiredTransients,
+			[this](const TransientSet& set)
+			{
+				return set.retiredAt + _framesInFlight < _compileCount;
+			}
+		);
+
+		std::vector<RenderResource> transientResources;
+		std::vector<TransientKey> keys;
+
+		for(RenderResource resource = 0; resource < _resources.size(); resource++)
+		{
+			if(_resources[resource].type != ResourceType::TransientImage) continue;
+
+			uint32_t firstPass = UINT32_MAX;
+			uint32_t lastPass = 0;
+			for(uint32_t i = 0; i < _compiledPasses.size(); i++)
+			{
+				for(const auto& access : _passes[_compiledPasses[i].pass].accesses)
+				{
+					if(access.resource != resource) continue;
+
+					firstPass = std::min(firstPass, i);
+					lastPass = std::max(lastPass, i);
+				}
+			}
+
+			// Only used by culled passes
+			if(firstPass == UINT32_MAX) continue;
+
+			const auto& description = _resources[resource];
+			transientResources.push_back(resource);
+			keys.push_back({description.format, description.extent, description.usage, firstPass, lastPass});
+		}
+
+		if(keys != _transientKeys)
+		{
+			if(!_transients.images.empty())
+			{
+				_transients.retiredAt = _compileCount;
+				_retiredTransients.push_back(std::move(_transients));
+				_transients = TransientSet{};
+			}
+
+			_transientKeys = keys;
+
+			struct MemorySlot
+			{
+				vk::MemoryRequirements requirements;
+				std::vector<uint32_t> images;
+			};
+
+			std::vector<vk::MemoryRequirements> requirements;
+			for(const auto& key : keys)
+			{
+				const vk::ImageCreateInfo imageInfo(
+					{},
+					vk::ImageType::e2D,
+					key.format,
+					vk::Extent3D(key.extent.width, key.extent.height, 1),
+					1,
+					1,
+					vk::SampleCountFlagBits::e1,
+					vk::ImageTiling::eOptimal,
+					key.usage,
+					vk::SharingMode::eExclusive
+				);
+
+				auto& transient = _transients.images.emplace_back();
+				transient.image = vk::raii::Image(_device, imageInfo);
+				requirements.push_back(transient.image.getMemoryRequirements());
+			}
+
+			// Biggest first, each image goes to the first slot whose images don't overlap its lifetime
+			std::vector<uint32_t> order(keys.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::ranges::sort(
+				order,
+				[&requirements](const uint32_t a, const uint32_t b)
+				{
+					return requirements[a].size > requirements[b].size;
+				}
+			);
+
+			std::vector<MemorySlot> slots;
+			for(const uint32_t image : order)
+			{
+				const auto& key = keys[image];
+				const auto& imageRequirements = requirements[image];
+
+				const auto isFree = [&](const MemorySlot& slot)
+				{
+					if((slot.requirements.memoryTypeBits & imageRequirements.memoryTypeBits) == 0) return false;
+
+					return std::ranges::none_of(
+						slot.images,
+						[&](const uint32_t other)
+						{
+							return keys[other].firstPass <= key.lastPass && key.firstPass <= keys[other].lastPass;
+						}
+					);
+				};
+
+				const auto slot = std::ranges::find_if(slots, isFree);
+				if(slot == slots.end())
+				{
+					slots.push_back({imageRequirements, {image}});
+					continue;
+				}
+
+				slot->requirements.size = std::max(slot->requirements.size, imageRequirements.size);
+				slot->requirements.alignment = std::max(slot->requirements.alignment, imageRequirements.alignment);
+				slot->requirements.memoryTypeBits &= imageRequirements.memoryTypeBits;
+				slot->images.push_back(image);
+			}
+
+			for(const auto& slot : slots)
+			{
+				const auto& memory = _transients.memory.emplace_back(
+					_allocator.allocate(slot.requirements, vk::MemoryPropertyFlagBits::eDeviceLocal, ResourceKind::Optimal)
+				);
+
+				for(const uint32_t image : slot.images)
+				{
+					auto& transient = _transients.images[image];
+					transient.image.bindMemory(memory.getMemory(), memory.getOffset());
+
+					const vk::ImageViewCreateInfo imageViewCreateInfo(
+						{},
+						*transient.image,
+						vk::ImageViewType::e2D,
+						keys[image].format,
+						{},
+						getSubresourceRange(keys[image].format)
+					);
+					transient.view = vk::raii::ImageView(_device, imageViewCreateInfo);
+				}
+			}
+		}
+
+		for(uint32_t i = 0; i < transientResources.size(); i++)
+		{
+			auto& resource = _resources[transientResources[i]];
+			resource.transientIndex = i;
+			resource.image = *_transients.images[i].image;
+			resource.view = *_transients.images[i].view;
+		}
+	}
+
+	void RenderGraph::addBarrier(
+		CompiledPass& compiledPass, const RenderResource resource, ResourceState& state,
+		const vk::PipelineStageFlags2 stages, const vk::AccessFlags2 access, const vk::ImageLayout layout
+	) const
+	{
+		const auto& description = _resources[resource];
+		const bool isImage = description.type != ResourceType::Buffer;
+		const vk::AccessFlags2 writeAccess = access & WRITE_ACCESS;
+		const vk::ImageLayout oldLayout = state.layout;
+		const bool needsTransition = isImage && layout != oldLayout;
+
+		vk::PipelineStageFlags2 srcStages;
+		vk::AccessFlags2 srcAccess;
+		bool needsBarrier = needsTransition;
+
+		if(needsTransition || writeAccess)
+		{
+			// Writes (and layout transitions) wait for the last write and every read since
+			srcStages = state.writeStages | state.readStages;
+			srcAccess = state.writeAccess;
+			needsBarrier = needsBarrier || srcStages;
+
+			state.layout = isImage ? layout : oldLayout;
+			state.writeStages = stages;
+			state.writeAccess = writeAccess;
+			state.readStages = writeAccess ? vk::PipelineStageFlags2{} : stages;
+			state.readAccess = writeAccess ? vk::AccessFlags2{} : access;
+		}
+		else
+		{
+			// Reads only wait for the last write once per stage and access
+			const bool isVisible = (state.readStages & stages) == stages && (state.readAccess & access) == access;
+			if(state.writeStages && !isVisible)
+			{
+				needsBarrier = true;
+				srcStages = state.writeStages;
+				srcAccess = state.writeAccess;
+			}
+
+			state.readStages |= stages;
+			state.readAccess |= access;
+		}
+
+		if(!needsBarrier) return;
+
+		if(isImage)
+		{
+			compiledPass.imageBarriers.emplace_back(
+				srcStages,
+				srcAccess,
+				stages,
+				access,
+				oldLayout,
+				layout,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				description.image,
+				getSubresourceRange(description.format)
+			);
+		}
+		else
+		{
+			compiledPass.bufferBarriers.emplace_back(
+				srcStages,
+				srcAccess,
+				stages,
+				access,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				description.buffer,
+				description.offset,
+				description.size
+			);
+		}
+	}
+
+	void RenderGraph::execute(const vk::raii::CommandBuffer& commandBuffer, GpuProfiler* profiler) const
+	{
+		for(const auto& compiledPass : _compiledPasses)
+		{
+			const auto& pass = _passes[compiledPass.pass];
+			const uint32_t scope = profiler ? profiler->beginScope(commandBuffer, pass.name) : UINT32_MAX;
+
+			if(!compiledPass.imageBarriers.empty() || !compiledPass.bufferBarriers.empty())
+			{
+				const vk::DependencyInfo dependencyInfo(
+					{},
+					0,
+					nullptr,
+					static_cast<uint32_t>(compiledPass.bufferBarriers.size()),
+					compiledPass.bufferBarriers.data(),
+					static_cast<uint32_t>(compiledPass.imageBarriers.size()),
+					compiledPass.imageBarriers.data()
+				);
+				commandBuffer.pipelineBarrier2(dependencyInfo);
+			}
+
+			pass.execute(commandBuffer, *this);
+
+			if(profiler) profiler->endScope(commandBuffer, scope);
+		}
+
+		if(!_finalBarriers.empty())
+		{
+			const vk::DependencyInfo dependencyInfo(
+				{},
+				0,
+				nullptr,
+				0,
+				nullptr,
+				static_cast<uint32_t>(_finalBarriers.size()),
+				_finalBarriers.data()
+			);
+			commandBuffer.pipelineBarrier2(dependencyInfo);
+		}
+	}
+
+	vk::Image RenderGraph::getImage(const RenderResource resource) const
+	{
+		return getResource(resource).image;
+	}
+
+	vk::ImageView RenderGraph::getImageView(const RenderResource resource) const
+	{
+		return getResource(resource).view;
+	}
+
+	vk::Extent2D RenderGraph::getExtent(const RenderResource resource) const
+	{
+		return getResource(resource).extent;
+	}
+
+	vk::Buffer RenderGraph::getBuffer(const RenderResource resource) const
+	{
+		return getResource(resource).buffer;
+	}
+
+	vk::DeviceSize RenderGraph::getBufferOffset(const RenderResource resource) const
+	{
+		return getResource(resource).offset;
+	}
+
+	vk::DeviceSize RenderGraph::getBufferSize(const RenderResource resource) const
+	{
+		return getResource(resource).size;
+	}
+
+	uint32_t RenderGraph::getCulledPassCount() const
+	{
+		return _culledPassCount;
+	}
+
+	const RenderGraph::Resource& RenderGraph::getResource(const RenderResource resource) const
+	{
+		if(resource >= _resources.size())
+			throw std::runtime_error("Failed to find render graph resource: invalid handle.");
+
+		return _resources[resource];
+	}
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "MemoryAllocator.h"
+
+namespace Renderer
+{
+	class GpuProfiler;
+	class RenderGraph;
+
+	/**
+	 * Handle of a virtual resource, only valid until the next RenderGraph::reset()
+	 */
+	using RenderResource = uint32_t;
+
+	constexpr RenderResource INVALID_RENDER_RESOURCE = UINT32_MAX;
+
+	/**
+	 * How a pass touches a resource, decides the stages, access and (for images) the layout
+	 */
+	enum class ResourceUsage : uint8_t
+	{
+		ColorAttachment,
+		DepthStencilAttachment,
+		DepthStencilRead,
+		SampledFragment,
+		SampledCompute,
+		StorageReadCompute,
+		StorageWriteCompute,
+		StorageReadVertex,
+		IndirectRead,
+		VertexRead,
+		IndexRead,
+		UniformRead,
+		TransferSrc,
+		TransferDst
+	};
+
+	/**
+	 * Image created and owned by the graph, its memory may be shared with other transient images
+	 */
+	struct TransientImageDescription
+	{
+		vk::Format format = vk::Format::eUndefined;
+		vk::Extent2D extent;
+		vk::ImageUsageFlags usage;
+	};
+
+	using RenderPassFunction = std::function<void(const vk::raii::CommandBuffer&, const RenderGraph&)>;
+
+	/**
+	 * Frame graph: passes declare what they read and write, the graph drops passes nobody needs,
+	 * generates the barriers/layout transitions between them (one pipelineBarrier2 per pass) and lets transient
+	 * images with disjoint lifetimes share memory.
+	 *
+	 * Rebuilt every frame: reset(), import/create resources, addPass(), compile(), execute().
+	 */
+	class RenderGraph
+	{
+	public:
+		class PassBuilder
+		{
+		public:
+			/**
+			 * The pass needs the current contents of the resource
+			 */
+			PassBuilder& read(RenderResource resource, ResourceUsage usage);
+
+			/**
+			 * The pass (over)writes the resource
+			 */
+			PassBuilder& write(RenderResource resource, ResourceUsage usage);
+
+			/**
+			 * The pass is never culled (it has effects the graph can't see)
+			 */
+			PassBuilder& sideEffect();
+
+		private:
+			friend class RenderGraph;
+
+			PassBuilder(RenderGraph& graph, uint32_t pass);
+
+			RenderGraph& _graph;
+			uint32_t _pass;
+		};
+
+		/**
+		 * @param device Logical device
+		 * @param allocator Allocator of the transient images
+		 * @param framesInFlight Number of frames a retired transient image may still be used by
+		 */
+		RenderGraph(const vk::raii::Device& device, MemoryAllocator& allocator, uint32_t framesInFlight);
+		~RenderGraph() = default;
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		/**
+		 * Drops the passes and resources of the previous frame (transient images are kept for reuse)
+		 */
+		void reset();
+
+		/**
+		 * Registers an image owned by someone else
+		 *
+		 * @param initialLayout Layout the image is in when the graph starts
+		 * @param finalLayout Layout the image is left in, anything but eUndefined makes it an output of the graph
+		 * @param waitStage Stage the previous use is synchronized with (e.g. the acquire semaphore's wait stage)
+		 */
+		RenderResource importImage(
+			const std::string& name,
+			vk::Image image,
+			vk::ImageView view,
+			vk::Format format,
+			vk::Extent2D extent,
+			vk::ImageLayout initialLayout,
+			vk::ImageLayout finalLayout,
+			vk::PipelineStageFlags2 waitStage = vk::PipelineStageFlagBits2::eNone
+		);
+
+		/**
+		 * Registers a range of a buffer owned by someone else
+		 */
+		RenderResource importBuffer(const std::string& name, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize size);
+
+		/**
+		 * Declares an image that only lives during the graph
+		 */
+		RenderResource createImage(const std::string& name, const TransientImageDescription& description);
+
+		/**
+		 * Marks the resource as used after the graph, the passes writing it are never culled
+		 */
+		void markOutput(RenderResource resource);
+
+		PassBuilder addPass(const std::string& name, RenderPassFunction execute);
+
+		/**
+		 * Culls the passes, places the transient images and computes the barriers
+		 */
+		void compile();
+
+		/**
+		 * Records the compiled passes and their barriers
+		 *
+		 * @param profiler When set, every pass is recorded inside a scope of its name
+		 */
+		void execute(const vk::raii::CommandBuffer& commandBuffer, GpuProfiler* profiler = nullptr) const;
+
+		[[nodiscard]] vk::Image getImage(RenderResource resource) const;
+		[[nodiscard]] vk::ImageView getImageView(RenderResource resource) const;
+		[[nodiscard]] vk::Extent2D getExtent(RenderResource resource) const;
+		[[nodiscard]] vk::Buffer getBuffer(RenderResource resource) const;
+		[[nodiscard]] vk::DeviceSize getBufferOffset(RenderResource resource) const;
+		[[nodiscard]] vk::DeviceSize getBufferSize(RenderResource resource) const;
+
+		/**
+		 * @return Number of passes dropped by the last compile()
+		 */
+		[[nodiscard]] uint32_t getCulledPassCount() const;
+
+	private:
+		enum class ResourceType : uint8_t
+		{
+			ImportedImage,
+			TransientImage,
+			Buffer
+		};
+
+		struct ResourceState
+		{
+			vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+			vk::PipelineStageFlags2 writeStages;
+			vk::AccessFlags2 writeAccess;
+			// Stages/accesses that already waited for the last write
+			vk::PipelineStageFlags2 readStages;
+			vk::AccessFlags2 readAccess;
+		};
+
+		struct Resource
+		{
+			std::string name;
+			ResourceType type;
+			bool isOutput = false;
+
+			vk::Image image;
+			vk::ImageView view;
+			vk::Format format = vk::Format::eUndefined;
+			vk::Extent2D extent;
+			vk::ImageUsageFlags usage;
+			vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+
+			vk::Buffer buffer;
+			vk::DeviceSize offset = 0;
+			vk::DeviceSize size = 0;
+
+			ResourceState initialState;
+
+			// Index into the transient set, UINT32_MAX until compile() placed it
+			uint32_t transientIndex = UINT32_MAX;
+		};
+
+		struct PassAccess
+		{
+			RenderResource resource;
+			ResourceUsage usage;
+			bool isWrite;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			RenderPassFunction execute;
+			std::vector<PassAccess> accesses;
+			bool hasSideEffect = false;
+		};
+
+		struct CompiledPass
+		{
+			uint32_t pass;
+			std::vector<vk::ImageMemoryBarrier2> imageBarriers;
+			std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
+		};
+
+		struct TransientImage
+		{
+			vk::raii::Image image = VK_NULL_HANDLE;
+			vk::raii::ImageView view = VK_NULL_HANDLE;
+		};
+
+		/**
+		 * Transient images of one compiled layout, memory declared first so the images die before it
+		 */
+		struct TransientSet
+		{
+			std::vector<Allocation> memory;
+			std::vector<TransientImage> images;
+			uint64_t retiredAt = 0;
+		};
+
+		struct TransientKey
+		{
+			vk::Format format;
+			vk::Extent2D extent;
+			vk::ImageUsageFlags usage;
+			uint32_t firstPass;
+			uint32_t lastPass;
+
+			bool operator==(const TransientKey&) const = default;
+		};
+
+		const vk::raii::Device& _device;
+		MemoryAllocator& _allocator;
+		uint32_t _framesInFlight;
+
+		std::vector<Resource> _resources;
+		std::vector<Pass> _passes;
+
+		std::vector<CompiledPass> _compiledPasses;
+		std::vector<vk::ImageMemoryBarrier2> _finalBarriers;
+		uint32_t _culledPassCount = 0;
+
+		std::vector<TransientKey> _transientKeys;
+		TransientSet _transients;
+		std::vector<TransientSet> _retiredTransients;
+		uint64_t _compileCount = 0;
+
+		/**
+		 * @return Alive flag per pass
+		 */
+		[[nodiscard]] std::vector<bool> cullPasses() const;
+
+		/**
+		 * Creates (or reuses) the transient images used by the compiled passes, aliasing their memory
+		 */
+		void placeTransientImages();
+
+		/**
+		 * Computes the barrier needed before the access and advances the resource state
+		 */
+		void addBarrier(
+			CompiledPass& compiledPass,
+			RenderResource resource,
+			ResourceState& state,
+			vk::PipelineStageFlags2 stages,
+			vk::AccessFlags2 access,
+			vk::ImageLayout layout
+		) const;
+
+		[[nodiscard]] const Resource& getResource(RenderResource resource) const;
+	};
+}
@@ -0,0 +1,99 @@
+#include "RingBuffer.h"
+
+#include <cstring>
+
+namespace Renderer
+{
+	RingBuffer::RingBuffer(
+		const vk::raii::Device& device, MemoryAllocator& allocator, const vk::DeviceSize capacity,
+		const std::span<const uint32_t> queueFamilies
+	) : _capacity(capacity)
+	{
+		const bool isConcurrent = queueFamilies.size() > 1 && queueFamilies[0] != queueFamilies[1];
+
+		const vk::BufferCreateInfo bufferInfo(
+			{},
+			capacity,
+			vk::BufferUsageFlagBits::eVertexBuffer |
+			vk::BufferUsageFlagBits::eIndexBuffer |
+			vk::BufferUsageFlagBits::eUniformBuffer |
+			vk::BufferUsageFlagBits::eStorageBuffer |
+			vk::BufferUsageFlagBits::eTransferSrc,
+			isConcurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+			isConcurrent ? static_cast<uint32_t>(queueFamilies.size()) : 0,
+			isConcurrent ? queueFamilies.data() : nullptr
+		);
+		_buffer = vk::raii::Buffer(device, bufferInfo);
+
+		_allocation = allocator.allocateForBuffer(
+			_buffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+		_mapped = static_cast<char*>(_allocation.getMappedData());
+
+		_frames.push_back({});
+	}
+
+	RingAllocation RingBuffer::allocate(const vk::DeviceSize size, const vk::DeviceSize alignment)
+	{
+		std::lock_guard lock(_mutex);
+
+		vk::DeviceSize offset = (_head + alignment - 1) / alignment * alignment;
+
+		// Never split a range over the end, skip the tail instead: the skipped tail is charged too, so a wrapped
+		// range can only be handed out when the space after the head and the start of the ring are both free
+		const bool isWrapped = offset + size > _capacity;
+		if(isWrapped) offset = 0;
+
+		const vk::DeviceSize newHead = offset + size;
+		const vk::DeviceSize consumed = isWrapped ? _capacity - _head + size : newHead - _head;
+
+		if(_used + consumed > _capacity) return {};
+
+		_head = newHead == _capacity ? 0 : newHead;
+		_used += consumed;
+		_frames.back().bytes += consumed;
+
+		return {*_buffer, offset, size, _mapped + offset};
+	}
+
+	RingAllocation RingBuffer::write(const void* data, const vk::DeviceSize size, const vk::DeviceSize alignment)
+	{
+		const auto allocation = allocate(size, alignment);
+		if(allocation) std::memcpy(allocation.data, data, size);
+		return allocation;
+	}
+
+	void RingBuffer::beginFrame(const uint64_t frameNumber)
+	{
+		std::lock_guard lock(_mutex);
+
+		if(_frames.back().frameNumber == frameNumber) return;
+
+		_frames.push_back({frameNumber, 0});
+	}
+
+	void RingBuffer::reclaim(const uint64_t completedFrameNumber)
+	{
+		std::lock_guard lock(_mutex);
+
+		while(_frames.size() > 1 && _frames.front().frameNumber <= completedFrameNumber)
+		{
+			_used -= _frames.front().bytes;
+			_frames.pop_front();
+		}
+
+		// Nothing in flight, start over to keep ranges from wrapping
+		if(_used == 0) _head = 0;
+	}
+
+	vk::Buffer RingBuffer::getBuffer() const
+	{
+		return *_buffer;
+	}
+
+	vk::DeviceSize RingBuffer::getCapacity() const
+	{
+		return _capacity;
+	}
+}
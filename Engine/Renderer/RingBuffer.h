@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <span>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "MemoryAllocator.h"
+
+namespace Renderer
+{
+	/**
+	 * Default amount of dynamic data a single frame can write into the ring
+	 */
+	constexpr vk::DeviceSize RING_BUFFER_FRAME_SIZE = 4ull * 1024 * 1024;
+
+	/**
+	 * Sub-range of the ring buffer, valid until the frame it was allocated for retires
+	 */
+	struct RingAllocation
+	{
+		vk::Buffer buffer;
+		vk::DeviceSize offset = 0;
+		vk::DeviceSize size = 0;
+		void* data = nullptr;
+
+		explicit operator bool() const { return data != nullptr; }
+	};
+
+	/**
+	 * One persistently mapped buffer shared by every frame in flight.
+	 * Hands out linear sub-ranges for vertex/index/uniform/staging data, tagged with the frame that consumes them;
+	 * ranges come back once that frame is known to be finished on the GPU.
+	 */
+	class RingBuffer
+	{
+	public:
+		/**
+		 * @param device Logical device
+		 * @param allocator Allocator for the backing memory
+		 * @param capacity Size of the whole ring in bytes
+		 * @param queueFamilies Queue families that read the ring (concurrent sharing if they differ)
+		 */
+		RingBuffer(
+			const vk::raii::Device& device,
+			MemoryAllocator& allocator,
+			vk::DeviceSize capacity,
+			std::span<const uint32_t> queueFamilies
+		);
+		~RingBuffer() = default;
+
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator=(const RingBuffer&) = delete;
+
+		/**
+		 * Reserves a sub-range for the current frame
+		 *
+		 * @param size Size in bytes
+		 * @param alignment Required alignment of the offset
+		 * @return Empty allocation when the ring is full
+		 */
+		[[nodiscard]] RingAllocation allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+		/**
+		 * Allocates and copies the data in
+		 */
+		[[nodiscard]] RingAllocation write(const void* data, vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+		/**
+		 * Everything allocated from now on belongs to (is consumed by) this frame
+		 *
+		 * @param frameNumber Monotonically increasing frame number
+		 */
+		void beginFrame(uint64_t frameNumber);
+
+		/**
+		 * Returns ranges of every frame up to (and including) the completed one
+		 *
+		 * @param completedFrameNumber Last frame known to be finished on the GPU
+		 */
+		void reclaim(uint64_t completedFrameNumber);
+
+		[[nodiscard]] vk::Buffer getBuffer() const;
+
+		[[nodiscard]] vk::DeviceSize getCapacity() const;
+
+	private:
+		struct FrameUsage
+		{
+			uint64_t frameNumber = 0;
+			vk::DeviceSize bytes = 0;
+		};
+
+		Allocation _allocation;
+		vk::raii::Buffer _buffer = VK_NULL_HANDLE;
+		char* _mapped = nullptr;
+
+		vk::DeviceSize _capacity = 0;
+		vk::DeviceSize _head = 0;
+		vk::DeviceSize _used = 0;
+
+		// Oldest frame first, the back is the frame being written
+		std::deque<FrameUsage> _frames;
+
+		std::mutex _mutex;
+	};
+}
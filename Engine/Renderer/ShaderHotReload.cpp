@@ -0,0 +1,177 @@
+#include "ShaderHotReload.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+namespace Renderer
+{
+	namespace
+	{
+		// Changes of one save arrive within a few milliseconds, they are handled together
+		constexpr int WATCH_TIMEOUT_MS = 100;
+		constexpr int DEBOUNCE_MS = 50;
+	}
+
+	ShaderHotReload::ShaderHotReload(std::string shaderDirectory, std::string sourceDirectory)
+		: _shaderDirectory(std::move(shaderDirectory)), _sourceDirectory(std::move(sourceDirectory))
+	{
+		_watcher.watch(_shaderDirectory);
+
+		if(!_sourceDirectory.empty() && std::filesystem::is_directory(_sourceDirectory))
+			_watcher.watch(_sourceDirectory);
+		else
+			_sourceDirectory.clear();
+	}
+
+	ShaderHotReload::~ShaderHotReload()
+	{
+		// Joined before the pipelines and the retired list go away
+		_thread.request_stop();
+		if(_thread.joinable()) _thread.join();
+	}
+
+	void ShaderHotReload::addShader(const std::string& name, std::vector<std::string> entryPoints)
+	{
+		_entryPoints[name] = std::move(entryPoints);
+		_shaders[name] = Assets::AssetManager::load<Assets::AssetType::Shader>(name);
+	}
+
+	void ShaderHotReload::addPipeline(std::vector<std::string> shaders, vk::raii::Pipeline& pipeline, PipelineBuilder builder)
+	{
+		_pipelines.push_back({std::move(shaders), &pipeline, std::move(builder)});
+	}
+
+	void ShaderHotReload::start()
+	{
+		_thread = std::jthread([this](const std::stop_token& stopToken) { watchLoop(stopToken); });
+
+		std::printf(
+			"Shader reload -> watching %s%s%s\n",
+			_shaderDirectory.c_str(),
+			_sourceDirectory.empty() ? "" : " and ",
+			_sourceDirectory.c_str()
+		);
+	}
+
+	void ShaderHotReload::applyReloads(const uint64_t frameNumber)
+	{
+		std::lock_guard lock(_mutex);
+
+		for(auto& reloaded : _reloaded)
+		{
+			_retired.emplace_back(frameNumber - 1, std::move(*reloaded.target));
+			*reloaded.target = std::move(reloaded.pipeline);
+		}
+		_reloaded.clear();
+	}
+
+	void ShaderHotReload::reclaim(const uint64_t completedFrameNumber)
+	{
+		std::lock_guard lock(_mutex);
+
+		while(!_retired.empty() && _retired.front().first <= completedFrameNumber)
+			_retired.pop_front();
+	}
+
+	void ShaderHotReload::watchLoop(const std::stop_token& stopToken)
+	{
+		while(!stopToken.stop_requested())
+		{
+			auto changedFiles = _watcher.poll(WATCH_TIMEOUT_MS);
+			if(changedFiles.empty()) continue;
+
+			for(auto more = _watcher.poll(DEBOUNCE_MS); !more.empty(); more = _watcher.poll(DEBOUNCE_MS))
+				changedFiles.insert(changedFiles.end(), more.begin(), more.end());
+
+			std::vector<std::string> sources;
+			std::vector<std::string> binaries;
+			for(const auto& file : changedFiles)
+			{
+				const std::filesystem::path path(file);
+				const std::string name = path.stem().string();
+				if(!_entryPoints.contains(name)) continue;
+
+				const bool isSource = path.extension() == ".slang";
+				if(!isSource && path.extension() != ".spv") continue;
+
+				auto& names = isSource ? sources : binaries;
+				if(std::ranges::find(names, name) == names.end()) names.push_back(name);
+			}
+
+			// The compiled .spv comes back as a change of its own
+			for(const auto& name : sources)
+				compileSource(name);
+
+			for(const auto& name : binaries)
+				reloadShader(name);
+		}
+	}
+
+	void ShaderHotReload::compileSource(const std::string& name) const
+	{
+		// Same options as the CompileShaders target of Assets/CMakeLists.txt
+		std::string command =
+			"slangc \"" + _sourceDirectory + "/" + name + ".slang\""
+			" -target spirv -profile spirv_1_4 -emit-spirv-directly -fvk-use-entrypoint-name";
+		for(const auto& entryPoint : _entryPoints.at(name))
+			command += " -entry " + entryPoint;
+		command += " -o \"" + _shaderDirectory + "/" + name + ".spv\"";
+
+		std::printf("Shader reload -> compiling %s\n", name.c_str());
+
+		if(std::system(command.c_str()) != 0)
+			std::printf("Shader reload -> %s failed to compile, keeping the current pipelines\n", name.c_str());
+	}
+
+	void ShaderHotReload::reloadShader(const std::string& name)
+	{
+		std::shared_ptr<Assets::AssetType::Shader> shader;
+		try
+		{
+			shader = Assets::AssetManager::reload<Assets::AssetType::Shader>(name);
+		}
+		catch(const std::exception& exception)
+		{
+			std::printf("Shader reload -> %s\n", exception.what());
+			return;
+		}
+
+		// Held so the builders load this version from the cache
+		auto& current = _shaders[name];
+		if(current && current->spirV == shader->spirV) return;
+		current = std::move(shader);
+
+		for(const auto& watched : _pipelines)
+		{
+			if(std::ranges::find(watched.shaders, name) == watched.shaders.end()) continue;
+
+			try
+			{
+				const auto buildStart = std::chrono::steady_clock::now();
+				auto pipeline = watched.builder();
+
+				std::printf(
+					"Shader reload -> pipeline rebuilt for %s in %.2f ms\n",
+					name.c_str(),
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count()
+				);
+
+				std::lock_guard lock(_mutex);
+
+				// A newer build replaces one that wasn't swapped in yet
+				std::erase_if(_reloaded, [&watched](const ReloadedPipeline& reloaded)
+				{
+					return reloaded.target == watched.pipeline;
+				});
+				_reloaded.push_back({watched.pipeline, std::move(pipeline)});
+			}
+			catch(const std::exception& exception)
+			{
+				std::printf("Shader reload -> pipeline not rebuilt for %s: %s\n", name.c_str(), exception.what());
+			}
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <AssetManager.h>
+#include <Core/FileWatcher.h>
+
+namespace Renderer
+{
+	/**
+	 * Watches the compiled shaders (and their Slang sources when they are available) and rebuilds the pipelines
+	 * using them on a background thread. The new pipelines are swapped in between frames, the old ones are
+	 * destroyed once the frames recorded with them are done.
+	 */
+	class ShaderHotReload
+	{
+	public:
+		using PipelineBuilder = std::function<vk::raii::Pipeline()>;
+
+		/**
+		 * @param shaderDirectory Directory the .spv files are loaded from
+		 * @param sourceDirectory Directory of the .slang files, empty to only watch the .spv files
+		 */
+		ShaderHotReload(std::string shaderDirectory, std::string sourceDirectory);
+
+		/**
+		 * Stops the watcher thread, the retired pipelines must not be in use anymore
+		 */
+		~ShaderHotReload();
+
+		ShaderHotReload(const ShaderHotReload&) = delete;
+		ShaderHotReload& operator=(const ShaderHotReload&) = delete;
+
+		/**
+		 * @param name Shader as loaded through the AssetManager ("shader" for Shaders/shader.spv)
+		 * @param entryPoints Entry points its source is compiled with
+		 */
+		void addShader(const std::string& name, std::vector<std::string> entryPoints);
+
+		/**
+		 * Rebuilds a pipeline whenever one of its shaders changes
+		 *
+		 * @param shaders Shaders the pipeline is created from
+		 * @param pipeline Replaced in applyReloads, must outlive the reloader
+		 * @param builder Creates the pipeline from the cached shaders, called on the watcher thread
+		 */
+		void addPipeline(std::vector<std::string> shaders, vk::raii::Pipeline& pipeline, PipelineBuilder builder);
+
+		/**
+		 * Starts the watcher thread, every shader and pipeline has to be added before
+		 */
+		void start();
+
+		/**
+		 * Swaps the rebuilt pipelines in, called between frames
+		 *
+		 * @param frameNumber Frame about to be recorded, the replaced pipelines retire with the frame before
+		 */
+		void applyReloads(uint64_t frameNumber);
+
+		/**
+		 * Destroys the pipelines retired by completed frames
+		 */
+		void reclaim(uint64_t completedFrameNumber);
+
+	private:
+		struct WatchedPipeline
+		{
+			std::vector<std::string> shaders;
+			vk::raii::Pipeline* pipeline;
+			PipelineBuilder builder;
+		};
+
+		struct ReloadedPipeline
+		{
+			vk::raii::Pipeline* target;
+			vk::raii::Pipeline pipeline;
+		};
+
+		std::string _shaderDirectory;
+		std::string _sourceDirectory;
+
+		Core::FileWatcher _watcher;
+
+		// Shader name -> entry points
+		std::map<std::string, std::vector<std::string>> _entryPoints;
+		// Current version of every shader, a write that doesn't change the code doesn't rebuild anything
+		std::map<std::string, std::shared_ptr<Assets::AssetType::Shader>> _shaders;
+		std::vector<WatchedPipeline> _pipelines;
+
+		std::mutex _mutex;
+		std::vector<ReloadedPipeline> _reloaded;
+		std::deque<std::pair<uint64_t, vk::raii::Pipeline>> _retired;
+
+		std::jthread _thread;
+
+		void watchLoop(const std::stop_token& stopToken);
+
+		/**
+		 * Compiles a Slang source into the shader directory, the .spv write is picked up like any other
+		 */
+		void compileSource(const std::string& name) const;
+
+		/**
+		 * Reloads the shader and rebuilds the pipelines using it
+		 */
+		void reloadShader(const std::string& name);
+	};
+}
@@ -0,0 +1,293 @@
+#include "ShaderLibrary.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <vulkan/vulkan_format_traits.hpp>
+
+namespace Renderer
+{
+	namespace
+	{
+		uint64_t hashSpirV(const std::span<const uint32_t> spirV)
+		{
+			// FNV-1a over the words
+			uint64_t hash = 14695981039346656037ull;
+			for(const uint32_t word : spirV)
+			{
+				hash ^= word;
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		ReflectedNumericType getNumericType(const vk::Format format)
+		{
+			const std::string_view numericFormat = vk::componentNumericFormat(format, 0);
+
+			if(numericFormat == "SINT") return ReflectedNumericType::Sint;
+			if(numericFormat == "UINT") return ReflectedNumericType::Uint;
+
+			// Normalized, scaled and float formats are all read as float
+			return ReflectedNumericType::Float;
+		}
+	}
+
+	ShaderModule::ShaderModule(const vk::raii::Device& device, const std::span<const uint32_t> spirV)
+		: _reflection(reflectShader(spirV))
+	{
+		const vk::ShaderModuleCreateInfo createInfo(
+			{},
+			spirV.size() * sizeof(uint32_t),
+			spirV.data()
+		);
+
+		_module = vk::raii::ShaderModule(device, createInfo);
+	}
+
+	vk::PipelineShaderStageCreateInfo ShaderModule::getStageInfo(const std::string& entryPoint) const
+	{
+		const auto& reflected = _reflection.getEntryPoint(entryPoint);
+
+		return vk::PipelineShaderStageCreateInfo(
+			{},
+			reflected.stage,
+			_module,
+			reflected.name.c_str()
+		);
+	}
+
+	const ShaderReflection& ShaderModule::getReflection() const
+	{
+		return _reflection;
+	}
+
+	vk::ShaderModule ShaderModule::getModule() const
+	{
+		return _module;
+	}
+
+	ShaderLibrary::ShaderLibrary(const vk::raii::Device& device) : _device(device)
+	{
+	}
+
+	std::shared_ptr<const ShaderModule> ShaderLibrary::getModule(const std::span<const uint32_t> spirV)
+	{
+		std::lock_guard lock(_mutex);
+
+		const uint64_t hash = hashSpirV(spirV);
+
+		const auto [first, last] = _modules.equal_range(hash);
+		for(auto entry = first; entry != last; ++entry)
+		{
+			if(!std::ranges::equal(entry->second.spirV, spirV)) continue;
+
+			if(auto module = entry->second.module.lock())
+				return module;
+		}
+
+		auto module = std::make_shared<const ShaderModule>(_device, spirV);
+		_modules.emplace(hash, CachedModule{{spirV.begin(), spirV.end()}, module});
+
+		// Drop the entries of modules nobody holds anymore (shader reloads leave one behind every time)
+		std::erase_if(_modules, [](const auto& entry) { return entry.second.expired(); });
+
+		return module;
+	}
+
+	void ShaderLibrary::setExternalSetLayout(
+		const uint32_t set, const vk::DescriptorSetLayout layout, std::vector<vk::DescriptorSetLayoutBinding> bindings
+	)
+	{
+		std::lock_guard lock(_mutex);
+
+		_externalSetLayouts[set] = {layout, std::move(bindings)};
+	}
+
+	PipelineLayoutInfo ShaderLibrary::getPipelineLayout(const std::span<const ShaderStage> stages)
+	{
+		PipelineLayoutInfo info;
+
+		// Set -> binding -> merged binding of every stage
+		std::map<uint32_t, std::map<uint32_t, vk::DescriptorSetLayoutBinding>> sets;
+
+		for(const auto& stage : stages)
+		{
+			const auto& entryPoint = stage.module->getReflection().getEntryPoint(stage.entryPoint);
+
+			if(entryPoint.pushConstantSize > 0)
+			{
+				info.pushConstantStages |= entryPoint.stage;
+				info.pushConstantSize = std::max(info.pushConstantSize, entryPoint.pushConstantSize);
+			}
+
+			for(const auto& reflected : entryPoint.bindings)
+			{
+				auto [binding, isNew] = sets[reflected.set].try_emplace(
+					reflected.binding,
+					reflected.binding,
+					reflected.type,
+					reflected.count,
+					entryPoint.stage
+				);
+
+				if(isNew) continue;
+
+				auto& merged = binding->second;
+				if(merged.descriptorType != reflected.type)
+				{
+					throw std::runtime_error(
+						"Failed to create pipeline layout: stages use set " + std::to_string(reflected.set) +
+						" binding " + std::to_string(reflected.binding) + " with different descriptor types."
+					);
+				}
+
+				merged.stageFlags |= entryPoint.stage;
+				// A runtime array (0) stays one
+				if(merged.descriptorCount != 0)
+					merged.descriptorCount = reflected.count == 0 ? 0 : std::max(merged.descriptorCount, reflected.count);
+			}
+		}
+
+		std::lock_guard lock(_mutex);
+
+		// Sets in between the used ones still need a (possibly empty) layout
+		const uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+
+		std::vector<VkDescriptorSetLayout> setLayouts(setCount);
+		for(uint32_t set = 0; set < setCount; set++)
+		{
+			const auto bindings = sets.find(set);
+			setLayouts[set] = getSetLayout(set, bindings != sets.end() ? bindings->second : decltype(sets)::mapped_type{});
+		}
+
+		PipelineLayoutKey key(setLayouts, static_cast<vk::ShaderStageFlags::MaskType>(info.pushConstantStages), info.pushConstantSize);
+
+		auto layout = _pipelineLayouts.find(key);
+		if(layout == _pipelineLayouts.end())
+		{
+			const vk::PushConstantRange pushConstantRange(
+				info.pushConstantStages,
+				0,
+				info.pushConstantSize
+			);
+
+			const vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+				{},
+				setCount,
+				reinterpret_cast<const vk::DescriptorSetLayout*>(setLayouts.data()),
+				info.pushConstantSize > 0 ? 1 : 0,
+				&pushConstantRange
+			);
+
+			layout = _pipelineLayouts.emplace(std::move(key), vk::raii::PipelineLayout(_device, pipelineLayoutInfo)).first;
+		}
+
+		info.layout = layout->second;
+		return info;
+	}
+
+	VertexInputInfo ShaderLibrary::getVertexInput(
+		const ShaderStage& vertexStage,
+		const std::span<const vk::VertexInputBindingDescription> bindings,
+		const std::span<const vk::VertexInputAttributeDescription> attributes
+	)
+	{
+		const auto& entryPoint = vertexStage.module->getReflection().getEntryPoint(vertexStage.entryPoint);
+
+		VertexInputInfo info;
+		for(const auto& input : entryPoint.vertexInputs)
+		{
+			const auto attribute = std::ranges::find(attributes, input.location, &vk::VertexInputAttributeDescription::location);
+			if(attribute == attributes.end())
+			{
+				throw std::runtime_error(
+					"Failed to match vertex input: " + entryPoint.name + " reads location " + std::to_string(input.location) +
+					" which the vertex layout doesn't have."
+				);
+			}
+
+			if(getNumericType(attribute->format) != input.numericType)
+			{
+				throw std::runtime_error(
+					"Failed to match vertex input: location " + std::to_string(input.location) + " of " + entryPoint.name +
+					" is read with another numeric type than " + vk::to_string(attribute->format) + "."
+				);
+			}
+
+			info.attributes.push_back(*attribute);
+
+			if(std::ranges::find(info.bindings, attribute->binding, &vk::VertexInputBindingDescription::binding) == info.bindings.end())
+			{
+				const auto binding = std::ranges::find(bindings, attribute->binding, &vk::VertexInputBindingDescription::binding);
+				if(binding == bindings.end())
+					throw std::runtime_error("Failed to match vertex input: an attribute uses a binding the vertex layout doesn't have.");
+
+				info.bindings.push_back(*binding);
+			}
+		}
+
+		return info;
+	}
+
+	vk::DescriptorSetLayout ShaderLibrary::getSetLayout(
+		const uint32_t set, const std::map<uint32_t, vk::DescriptorSetLayoutBinding>& bindings
+	)
+	{
+		if(const auto external = _externalSetLayouts.find(set); external != _externalSetLayouts.end())
+		{
+			for(const auto& [index, binding] : bindings)
+			{
+				const auto provided = std::ranges::find(
+					external->second.bindings, index, &vk::DescriptorSetLayoutBinding::binding
+				);
+
+				const bool isCompatible = provided != external->second.bindings.end() &&
+					provided->descriptorType == binding.descriptorType &&
+					(provided->stageFlags & binding.stageFlags) == binding.stageFlags &&
+					provided->descriptorCount >= binding.descriptorCount;
+
+				if(!isCompatible)
+				{
+					throw std::runtime_error(
+						"Failed to create pipeline layout: set " + std::to_string(set) + " binding " +
+						std::to_string(index) + " doesn't match the layout the set is bound with."
+					);
+				}
+			}
+
+			return external->second.layout;
+		}
+
+		SetLayoutKey key;
+		std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+		for(const auto& [index, binding] : bindings)
+		{
+			if(binding.descriptorCount == 0)
+			{
+				throw std::runtime_error(
+					"Failed to create pipeline layout: set " + std::to_string(set) +
+					" has a runtime array, it needs an external layout."
+				);
+			}
+
+			key.emplace_back(index, binding.descriptorType, binding.descriptorCount,
+				static_cast<vk::ShaderStageFlags::MaskType>(binding.stageFlags));
+			layoutBindings.push_back(binding);
+		}
+
+		auto layout = _setLayouts.find(key);
+		if(layout == _setLayouts.end())
+		{
+			const vk::DescriptorSetLayoutCreateInfo layoutInfo(
+				{},
+				static_cast<uint32_t>(layoutBindings.size()),
+				layoutBindings.data()
+			);
+
+			layout = _setLayouts.emplace(std::move(key), vk::raii::DescriptorSetLayout(_device, layoutInfo)).first;
+		}
+
+		return layout->second;
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "ShaderReflection.h"
+
+namespace Renderer
+{
+	/**
+	 * Shader module and the interface of its entry points
+	 */
+	class ShaderModule
+	{
+	public:
+		ShaderModule(const vk::raii::Device& device, std::span<const uint32_t> spirV);
+
+		/**
+		 * @return Stage of the entry point, the name points into the reflection (valid as long as the module lives)
+		 */
+		[[nodiscard]] vk::PipelineShaderStageCreateInfo getStageInfo(const std::string& entryPoint) const;
+
+		[[nodiscard]] const ShaderReflection& getReflection() const;
+
+		[[nodiscard]] vk::ShaderModule getModule() const;
+
+	private:
+		vk::raii::ShaderModule _module = VK_NULL_HANDLE;
+		ShaderReflection _reflection;
+	};
+
+	/**
+	 * Entry point of a module used by a pipeline
+	 */
+	struct ShaderStage
+	{
+		std::shared_ptr<const ShaderModule> module;
+		std::string entryPoint;
+	};
+
+	struct PipelineLayoutInfo
+	{
+		vk::PipelineLayout layout;
+
+		// One range from offset 0 covering every stage that uses push constants
+		vk::ShaderStageFlags pushConstantStages;
+		uint32_t pushConstantSize = 0;
+	};
+
+	struct VertexInputInfo
+	{
+		std::vector<vk::VertexInputBindingDescription> bindings;
+		std::vector<vk::VertexInputAttributeDescription> attributes;
+	};
+
+	/**
+	 * Creates shader modules and pipeline layouts from reflection, both are shared:
+	 * one module per distinct SPIR-V (by content) and one layout per distinct interface.
+	 */
+	class ShaderLibrary
+	{
+	public:
+		explicit ShaderLibrary(const vk::raii::Device& device);
+		~ShaderLibrary() = default;
+
+		ShaderLibrary(const ShaderLibrary&) = delete;
+		ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+		/**
+		 * Modules are only needed while pipelines are created, the library doesn't keep them alive
+		 *
+		 * @return Module of this SPIR-V, the same one while anyone still holds it
+		 */
+		[[nodiscard]] std::shared_ptr<const ShaderModule> getModule(std::span<const uint32_t> spirV);
+
+		/**
+		 * Uses a set layout created elsewhere (e.g. the bindless table) for a set index, instead of creating one
+		 * from reflection. Shaders are checked against its bindings.
+		 */
+		void setExternalSetLayout(uint32_t set, vk::DescriptorSetLayout layout, std::vector<vk::DescriptorSetLayoutBinding> bindings);
+
+		/**
+		 * Merges the interface of the stages (pipelines created from the same interface get the same layout)
+		 * Throws if the stages disagree about a binding or don't match an external set.
+		 */
+		[[nodiscard]] PipelineLayoutInfo getPipelineLayout(std::span<const ShaderStage> stages);
+
+		/**
+		 * Keeps the attributes of the vertex layout the vertex stage reads, and the bindings they come from
+		 * Throws if the stage reads a location the vertex layout doesn't provide (or with another numeric type).
+		 */
+		[[nodiscard]] static VertexInputInfo getVertexInput(
+			const ShaderStage& vertexStage,
+			std::span<const vk::VertexInputBindingDescription> bindings,
+			std::span<const vk::VertexInputAttributeDescription> attributes
+		);
+
+	private:
+		// Keeps the words it was created from, a hash match alone could hand out another shader's module
+		struct CachedModule
+		{
+			std::vector<uint32_t> spirV;
+			std::weak_ptr<const ShaderModule> module;
+		};
+
+		struct ExternalSetLayout
+		{
+			vk::DescriptorSetLayout layout;
+			std::vector<vk::DescriptorSetLayoutBinding> bindings;
+		};
+
+		// binding, type, count, stages
+		using SetLayoutKey = std::vector<std::tuple<uint32_t, vk::DescriptorType, uint32_t, vk::ShaderStageFlags::MaskType>>;
+		// set layouts, push constant stages, push constant size
+		using PipelineLayoutKey = std::tuple<std::vector<VkDescriptorSetLayout>, vk::ShaderStageFlags::MaskType, uint32_t>;
+
+		const vk::raii::Device& _device;
+
+		std::mutex _mutex;
+
+		// Content hash -> modules with that hash
+		std::multimap<uint64_t, CachedModule> _modules;
+
+		std::map<uint32_t, ExternalSetLayout> _externalSetLayouts;
+		std::map<SetLayoutKey, vk::raii::DescriptorSetLayout> _setLayouts;
+		std::map<PipelineLayoutKey, vk::raii::PipelineLayout> _pipelineLayouts;
+
+		vk::DescriptorSetLayout getSetLayout(uint32_t set, const std::map<uint32_t, vk::DescriptorSetLayoutBinding>& bindings);
+	};
+}
@@ -0,0 +1,415 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Renderer
+{
+	namespace
+	{
+		constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+		constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+
+		namespace Op
+		{
+			constexpr uint32_t EntryPoint = 15;
+			constexpr uint32_t TypeInt = 21;
+			constexpr uint32_t TypeFloat = 22;
+			constexpr uint32_t TypeVector = 23;
+			constexpr uint32_t TypeMatrix = 24;
+			constexpr uint32_t TypeImage = 25;
+			constexpr uint32_t TypeSampler = 26;
+			constexpr uint32_t TypeSampledImage = 27;
+			constexpr uint32_t TypeArray = 28;
+			constexpr uint32_t TypeRuntimeArray = 29;
+			constexpr uint32_t TypeStruct = 30;
+			constexpr uint32_t TypePointer = 32;
+			constexpr uint32_t Constant = 43;
+			constexpr uint32_t Variable = 59;
+			constexpr uint32_t Decorate = 71;
+			constexpr uint32_t MemberDecorate = 72;
+			constexpr uint32_t TypeAccelerationStructure = 5341;
+		}
+
+		namespace Decoration
+		{
+			constexpr uint32_t Block = 2;
+			constexpr uint32_t BufferBlock = 3;
+			constexpr uint32_t ArrayStride = 6;
+			constexpr uint32_t MatrixStride = 7;
+			constexpr uint32_t BuiltIn = 11;
+			constexpr uint32_t Location = 30;
+			constexpr uint32_t Binding = 33;
+			constexpr uint32_t DescriptorSet = 34;
+			constexpr uint32_t Offset = 35;
+		}
+
+		namespace StorageClass
+		{
+			constexpr uint32_t UniformConstant = 0;
+			constexpr uint32_t Input = 1;
+			constexpr uint32_t Uniform = 2;
+			constexpr uint32_t PushConstant = 9;
+			constexpr uint32_t StorageBuffer = 12;
+		}
+
+		constexpr uint32_t IMAGE_DIM_BUFFER = 5;
+		constexpr uint32_t IMAGE_DIM_SUBPASS_DATA = 6;
+
+		struct EntryPointDeclaration
+		{
+			uint32_t executionModel;
+			std::string name;
+			std::vector<uint32_t> interface;
+		};
+
+		struct VariableDeclaration
+		{
+			uint32_t pointerType;
+			uint32_t storageClass;
+		};
+
+		/**
+		 * Declarations of the module indexed by result id, instructions are kept as their operands
+		 */
+		class Module
+		{
+		public:
+			std::vector<EntryPointDeclaration> entryPoints;
+			std::unordered_map<uint32_t, std::pair<uint32_t, std::vector<uint32_t>>> types;
+			std::unordered_map<uint32_t, uint32_t> constants;
+			std::unordered_map<uint32_t, VariableDeclaration> variables;
+
+			std::unordered_map<uint32_t, std::map<uint32_t, uint32_t>> decorations;
+			std::map<std::pair<uint32_t, uint32_t>, std::map<uint32_t, uint32_t>> memberDecorations;
+
+			explicit Module(const std::span<const uint32_t> spirV)
+			{
+				if(spirV.size() < SPIRV_HEADER_WORDS || spirV[0] != SPIRV_MAGIC)
+					throw std::runtime_error("Failed to reflect shader: not a SPIR-V module.");
+
+				for(size_t position = SPIRV_HEADER_WORDS; position < spirV.size();)
+				{
+					const uint32_t wordCount = spirV[position] >> 16;
+					const uint32_t opcode = spirV[position] & 0xFFFF;
+
+					if(wordCount == 0 || position + wordCount > spirV.size())
+						throw std::runtime_error("Failed to reflect shader: truncated instruction.");
+
+					parseInstruction(opcode, spirV.subspan(position + 1, wordCount - 1));
+					position += wordCount;
+				}
+			}
+
+			[[nodiscard]] const std::pair<uint32_t, std::vector<uint32_t>>& getType(const uint32_t id) const
+			{
+				const auto type = types.find(id);
+				if(type == types.end())
+					throw std::runtime_error("Failed to reflect shader: unknown type.");
+				return type->second;
+			}
+
+			[[nodiscard]] std::optional<uint32_t> getDecoration(const uint32_t id, const uint32_t decoration) const
+			{
+				const auto found = decorations.find(id);
+				if(found == decorations.end()) return std::nullopt;
+
+				const auto value = found->second.find(decoration);
+				if(value == found->second.end()) return std::nullopt;
+				return value->second;
+			}
+
+			[[nodiscard]] std::optional<uint32_t> getMemberDecoration(
+				const uint32_t id, const uint32_t member, const uint32_t decoration
+			) const
+			{
+				const auto found = memberDecorations.find({id, member});
+				if(found == memberDecorations.end()) return std::nullopt;
+
+				const auto value = found->second.find(decoration);
+				if(value == found->second.end()) return std::nullopt;
+				return value->second;
+			}
+
+			/**
+			 * Size in bytes of a type as laid out in a block (explicit offsets and strides)
+			 */
+			[[nodiscard]] uint32_t getTypeSize(const uint32_t id, const uint32_t matrixStride = 0) const
+			{
+				const auto& [opcode, operands] = getType(id);
+
+				switch(opcode)
+				{
+				case Op::TypeInt:
+				case Op::TypeFloat:
+					return operands[0] / 8;
+				case Op::TypeVector:
+					return getTypeSize(operands[0]) * operands[1];
+				case Op::TypeMatrix:
+					return (matrixStride != 0 ? matrixStride : getTypeSize(operands[0])) * operands[1];
+				case Op::TypeArray:
+				{
+					const uint32_t stride = getDecoration(id, Decoration::ArrayStride).value_or(getTypeSize(operands[0]));
+					return stride * getConstant(operands[1]);
+				}
+				case Op::TypeStruct:
+				{
+					uint32_t size = 0;
+					for(uint32_t member = 0; member < operands.size(); member++)
+					{
+						const uint32_t offset = getMemberDecoration(id, member, Decoration::Offset).value_or(0);
+						const uint32_t memberStride = getMemberDecoration(id, member, Decoration::MatrixStride).value_or(0);
+						size = std::max(size, offset + getTypeSize(operands[member], memberStride));
+					}
+					return size;
+				}
+				default:
+					throw std::runtime_error("Failed to reflect shader: a block contains a type without size.");
+				}
+			}
+
+			[[nodiscard]] uint32_t getConstant(const uint32_t id) const
+			{
+				const auto constant = constants.find(id);
+				if(constant == constants.end())
+					throw std::runtime_error("Failed to reflect shader: array length isn't a constant.");
+				return constant->second;
+			}
+
+		private:
+			void parseInstruction(const uint32_t opcode, const std::span<const uint32_t> operands)
+			{
+				switch(opcode)
+				{
+				case Op::EntryPoint:
+				{
+					EntryPointDeclaration entryPoint;
+					entryPoint.executionModel = operands[0];
+
+					// Literal string: nul terminated, padded to a whole word
+					size_t word = 2;
+					for(; word < operands.size(); word++)
+					{
+						const uint32_t characters = operands[word];
+						bool isEnd = false;
+						for(uint32_t byte = 0; byte < 4; byte++)
+						{
+							const char character = static_cast<char>((characters >> (byte * 8)) & 0xFF);
+							if(character == '\0')
+							{
+								isEnd = true;
+								break;
+							}
+							entryPoint.name += character;
+						}
+						if(isEnd) break;
+					}
+
+					entryPoint.interface.assign(operands.begin() + std::min(word + 1, operands.size()), operands.end());
+					entryPoints.push_back(std::move(entryPoint));
+					break;
+				}
+				case Op::TypeInt:
+				case Op::TypeFloat:
+				case Op::TypeVector:
+				case Op::TypeMatrix:
+				case Op::TypeImage:
+				case Op::TypeSampler:
+				case Op::TypeSampledImage:
+				case Op::TypeArray:
+				case Op::TypeRuntimeArray:
+				case Op::TypeStruct:
+				case Op::TypePointer:
+				case Op::TypeAccelerationStructure:
+					types[operands[0]] = {opcode, {operands.begin() + 1, operands.end()}};
+					break;
+				case Op::Constant:
+					// Only 32 bit (array lengths), wider constants keep their low word
+					if(operands.size() >= 3) constants[operands[1]] = operands[2];
+					break;
+				case Op::Variable:
+					variables[operands[1]] = {operands[0], operands[2]};
+					break;
+				case Op::Decorate:
+					decorations[operands[0]][operands[1]] = operands.size() > 2 ? operands[2] : 0;
+					break;
+				case Op::MemberDecorate:
+					memberDecorations[{operands[0], operands[1]}][operands[2]] = operands.size() > 3 ? operands[3] : 0;
+					break;
+				default:
+					break;
+				}
+			}
+		};
+
+		vk::ShaderStageFlagBits getStage(const uint32_t executionModel)
+		{
+			switch(executionModel)
+			{
+			case 0: return vk::ShaderStageFlagBits::eVertex;
+			case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+			case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+			case 3: return vk::ShaderStageFlagBits::eGeometry;
+			case 4: return vk::ShaderStageFlagBits::eFragment;
+			case 5: return vk::ShaderStageFlagBits::eCompute;
+			case 5364: return vk::ShaderStageFlagBits::eTaskEXT;
+			case 5365: return vk::ShaderStageFlagBits::eMeshEXT;
+			default:
+				throw std::runtime_error("Failed to reflect shader: unsupported execution model.");
+			}
+		}
+
+		/**
+		 * Descriptor type of a resource variable (arrays already unwrapped)
+		 */
+		vk::DescriptorType getDescriptorType(const Module& module, const uint32_t storageClass, const uint32_t typeId)
+		{
+			const auto& [opcode, operands] = module.getType(typeId);
+
+			if(storageClass == StorageClass::StorageBuffer)
+				return vk::DescriptorType::eStorageBuffer;
+
+			if(storageClass == StorageClass::Uniform)
+			{
+				return module.getDecoration(typeId, Decoration::BufferBlock)
+					? vk::DescriptorType::eStorageBuffer
+					: vk::DescriptorType::eUniformBuffer;
+			}
+
+			switch(opcode)
+			{
+			case Op::TypeSampler:
+				return vk::DescriptorType::eSampler;
+			case Op::TypeSampledImage:
+				return vk::DescriptorType::eCombinedImageSampler;
+			case Op::TypeAccelerationStructure:
+				return vk::DescriptorType::eAccelerationStructureKHR;
+			case Op::TypeImage:
+			{
+				const uint32_t dim = operands[1];
+				const uint32_t sampled = operands[5];
+
+				if(dim == IMAGE_DIM_SUBPASS_DATA) return vk::DescriptorType::eInputAttachment;
+				if(dim == IMAGE_DIM_BUFFER)
+					return sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+				return sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+			}
+			default:
+				throw std::runtime_error("Failed to reflect shader: unsupported resource type.");
+			}
+		}
+
+		void addVertexInput(
+			const Module& module, const uint32_t location, const uint32_t typeId, std::vector<ReflectedVertexInput>& inputs
+		)
+		{
+			const auto& [opcode, operands] = module.getType(typeId);
+
+			switch(opcode)
+			{
+			case Op::TypeFloat:
+				inputs.push_back({location, ReflectedNumericType::Float, 1});
+				break;
+			case Op::TypeInt:
+				inputs.push_back({location, operands[1] ? ReflectedNumericType::Sint : ReflectedNumericType::Uint, 1});
+				break;
+			case Op::TypeVector:
+				addVertexInput(module, location, operands[0], inputs);
+				inputs.back().componentCount = operands[1];
+				break;
+			case Op::TypeMatrix:
+				for(uint32_t column = 0; column < operands[1]; column++)
+					addVertexInput(module, location + column, operands[0], inputs);
+				break;
+			default:
+				throw std::runtime_error("Failed to reflect shader: unsupported vertex input type.");
+			}
+		}
+	}
+
+	const ReflectedEntryPoint& ShaderReflection::getEntryPoint(const std::string& name) const
+	{
+		const auto entryPoint = std::ranges::find(entryPoints, name, &ReflectedEntryPoint::name);
+		if(entryPoint == entryPoints.end())
+			throw std::runtime_error("Failed to find entry point: the shader has no " + name + ".");
+		return *entryPoint;
+	}
+
+	ShaderReflection reflectShader(const std::span<const uint32_t> spirV)
+	{
+		const Module module(spirV);
+
+		ShaderReflection reflection;
+		for(const auto& declaration : module.entryPoints)
+		{
+			ReflectedEntryPoint entryPoint;
+			entryPoint.name = declaration.name;
+			entryPoint.stage = getStage(declaration.executionModel);
+
+			for(const uint32_t id : declaration.interface)
+			{
+				const auto variable = module.variables.find(id);
+				if(variable == module.variables.end()) continue;
+
+				const auto& [pointerOpcode, pointer] = module.getType(variable->second.pointerType);
+				if(pointerOpcode != Op::TypePointer)
+					throw std::runtime_error("Failed to reflect shader: variable isn't a pointer.");
+				const uint32_t typeId = pointer[1];
+
+				switch(variable->second.storageClass)
+				{
+				case StorageClass::PushConstant:
+					entryPoint.pushConstantSize = std::max(entryPoint.pushConstantSize, module.getTypeSize(typeId));
+					break;
+				case StorageClass::Input:
+				{
+					const auto location = module.getDecoration(id, Decoration::Location);
+					if(entryPoint.stage != vk::ShaderStageFlagBits::eVertex || !location ||
+						module.getDecoration(id, Decoration::BuiltIn))
+					{
+						break;
+					}
+					addVertexInput(module, *location, typeId, entryPoint.vertexInputs);
+					break;
+				}
+				case StorageClass::UniformConstant:
+				case StorageClass::Uniform:
+				case StorageClass::StorageBuffer:
+				{
+					ReflectedBinding binding{};
+					binding.set = module.getDecoration(id, Decoration::DescriptorSet).value_or(0);
+					binding.binding = module.getDecoration(id, Decoration::Binding).value_or(0);
+					binding.count = 1;
+
+					uint32_t elementType = typeId;
+					const auto& [opcode, operands] = module.getType(typeId);
+					if(opcode == Op::TypeRuntimeArray)
+					{
+						binding.count = 0;
+						elementType = operands[0];
+					}
+					else if(opcode == Op::TypeArray)
+					{
+						binding.count = module.getConstant(operands[1]);
+						elementType = operands[0];
+					}
+
+					binding.type = getDescriptorType(module, variable->second.storageClass, elementType);
+					entryPoint.bindings.push_back(binding);
+					break;
+				}
+				default:
+					break;
+				}
+			}
+
+			std::ranges::sort(entryPoint.vertexInputs, {}, &ReflectedVertexInput::location);
+			reflection.entryPoints.push_back(std::move(entryPoint));
+		}
+
+		return reflection;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer
+{
+	/**
+	 * Descriptor an entry point reads, count 0 is a runtime sized (bindless) array
+	 */
+	struct ReflectedBinding
+	{
+		uint32_t set;
+		uint32_t binding;
+		vk::DescriptorType type;
+		uint32_t count;
+	};
+
+	enum class ReflectedNumericType
+	{
+		Float,
+		Sint,
+		Uint
+	};
+
+	/**
+	 * Vertex shader input (a matrix takes one location per column)
+	 */
+	struct ReflectedVertexInput
+	{
+		uint32_t location;
+		ReflectedNumericType numericType;
+		uint32_t componentCount;
+	};
+
+	struct ReflectedEntryPoint
+	{
+		std::string name;
+		vk::ShaderStageFlagBits stage;
+
+		std::vector<ReflectedBinding> bindings;
+
+		// Size of the push constant block, 0 if the entry point doesn't use one
+		uint32_t pushConstantSize = 0;
+
+		// Only filled for vertex shaders
+		std::vector<ReflectedVertexInput> vertexInputs;
+	};
+
+	/**
+	 * Interface of every entry point of a SPIR-V module (1.4+: the entry points list every global they use)
+	 */
+	struct ShaderReflection
+	{
+		std::vector<ReflectedEntryPoint> entryPoints;
+
+		/**
+		 * @return Entry point with this name, throws if the module doesn't have it
+		 */
+		[[nodiscard]] const ReflectedEntryPoint& getEntryPoint(const std::string& name) const;
+	};
+
+	/**
+	 * Reads the interface out of the SPIR-V, throws if it's malformed or uses something we can't map
+	 */
+	[[nodiscard]] ShaderReflection reflectShader(std::span<const uint32_t> spirV);
+}
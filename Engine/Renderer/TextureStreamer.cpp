@@ -0,0 +1,358 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace Renderer
+{
+	namespace
+	{
+		constexpr vk::PipelineStageFlags2 TEXTURE_SAMPLE_STAGES =
+			vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader;
+
+		vk::Format toVulkanFormat(const Assets::TextureFileFormat format)
+		{
+			switch(format)
+			{
+			case Assets::TextureFileFormat::Rgba8Srgb:
+				return vk::Format::eR8G8B8A8Srgb;
+			case Assets::TextureFileFormat::Rgba8Unorm:
+				return vk::Format::eR8G8B8A8Unorm;
+			}
+
+			throw std::runtime_error("Failed to add texture: unknown texture format.");
+		}
+	}
+
+	TextureStreamer::TextureStreamer(
+		const vk::raii::Device& device, MemoryAllocator& allocator, RingBuffer& frameRing,
+		BindlessTable& bindlessTable, const vk::DeviceSize budget
+	) : _device(device), _allocator(allocator), _frameRing(frameRing), _bindlessTable(bindlessTable), _budget(budget)
+	{
+	}
+
+	TextureId TextureStreamer::addTexture(std::shared_ptr<const Assets::AssetType::Texture> texture)
+	{
+		StreamedTexture streamed;
+		streamed.format = toVulkanFormat(texture->header->format);
+
+		const uint32_t mipCount = texture->header->mipCount;
+		streamed.residentMip = mipCount;
+		streamed.tailMip = mipCount - 1;
+		for(uint32_t mip = 0; mip < mipCount; mip++)
+		{
+			if(texture->mips[mip].width <= TEXTURE_MIP_TAIL_SIZE && texture->mips[mip].height <= TEXTURE_MIP_TAIL_SIZE)
+			{
+				streamed.tailMip = mip;
+				break;
+			}
+		}
+		streamed.wantedMip = streamed.tailMip;
+		streamed.source = std::move(texture);
+
+		_textures.push_back(std::move(streamed));
+
+		return static_cast<TextureId>(_textures.size() - 1);
+	}
+
+	void TextureStreamer::requestSize(const TextureId texture, const float pixels)
+	{
+		auto& streamed = _textures[texture];
+
+		const auto& mip0 = streamed.source->mips[0];
+		const float largestSide = static_cast<float>(std::max(mip0.width, mip0.height));
+
+		// Mip whose largest side still covers the requested pixels
+		uint32_t mip = streamed.tailMip;
+		if(pixels > 0.0f)
+		{
+			const float level = std::floor(std::log2(largestSide / pixels));
+			mip = static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(streamed.tailMip)));
+		}
+
+		// Several users in the same frame: the biggest request wins
+		streamed.wantedMip = streamed.lastRequestFrame == _frameNumber ? std::min(streamed.wantedMip, mip) : mip;
+		streamed.lastRequestFrame = _frameNumber;
+	}
+
+	BindlessHandle TextureStreamer::getHandle(const TextureId texture) const
+	{
+		return _textures[texture].handle;
+	}
+
+	uint32_t TextureStreamer::getResidentMip(const TextureId texture) const
+	{
+		return _textures[texture].residentMip;
+	}
+
+	void TextureStreamer::setBudget(const vk::DeviceSize budget)
+	{
+		_budget = budget;
+	}
+
+	void TextureStreamer::update(const vk::raii::CommandBuffer& commandBuffer, const uint64_t frameNumber)
+	{
+		// Requests made since the previous update are stamped with its frame number
+		const uint64_t requestFrame = _frameNumber;
+		_frameNumber = frameNumber;
+
+		for(auto& texture : _textures)
+		{
+			if(texture.residentMip == texture.source->header->mipCount)
+				setResidentMip(commandBuffer, texture, texture.tailMip);
+
+			if(requestFrame - texture.lastRequestFrame > TEXTURE_REQUEST_TIMEOUT_FRAMES)
+				texture.wantedMip = texture.tailMip;
+		}
+
+		// Over budget: mips nobody wants go first, then the top mips of the least recently requested textures
+		while(_residentBytes > _budget)
+		{
+			StreamedTexture* victim = nullptr;
+			for(auto& texture : _textures)
+			{
+				if(texture.residentMip >= texture.tailMip) continue;
+
+				const bool isUnwanted = texture.residentMip < texture.wantedMip;
+				if(!victim)
+				{
+					victim = &texture;
+					continue;
+				}
+
+				const bool isVictimUnwanted = victim->residentMip < victim->wantedMip;
+				if(isUnwanted != isVictimUnwanted)
+				{
+					if(isUnwanted) victim = &texture;
+				}
+				else if(texture.lastRequestFrame < victim->lastRequestFrame)
+				{
+					victim = &texture;
+				}
+			}
+
+			if(!victim) break;
+
+			setResidentMip(commandBuffer, *victim, victim->residentMip + 1);
+			_evictedMips++;
+		}
+
+		// Most recently requested first, then the ones missing the most mips
+		std::vector<StreamedTexture*> wanted;
+		for(auto& texture : _textures)
+		{
+			if(texture.wantedMip < texture.residentMip) wanted.push_back(&texture);
+		}
+		std::ranges::sort(wanted, [](const StreamedTexture* a, const StreamedTexture* b)
+		{
+			if(a->lastRequestFrame != b->lastRequestFrame) return a->lastRequestFrame > b->lastRequestFrame;
+			return a->residentMip - a->wantedMip > b->residentMip - b->wantedMip;
+		});
+
+		vk::DeviceSize streamedBytes = 0;
+		for(auto* texture : wanted)
+		{
+			// One level per texture and frame
+			const uint32_t mip = texture->residentMip - 1;
+			const vk::DeviceSize mipBytes = texture->source->mips[mip].size;
+
+			if(streamedBytes > 0 && streamedBytes + mipBytes > TEXTURE_STREAMING_BYTES_PER_FRAME) break;
+			if(_residentBytes + mipBytes > _budget) continue;
+
+			setResidentMip(commandBuffer, *texture, mip);
+			streamedBytes += mipBytes;
+			_streamedMips++;
+		}
+	}
+
+	void TextureStreamer::reclaim(const uint64_t completedFrameNumber)
+	{
+		while(!_retired.empty() && _retired.front().frameNumber <= completedFrameNumber)
+		{
+			_retired.pop_front();
+		}
+	}
+
+	TextureStreamingStats TextureStreamer::getStats() const
+	{
+		return {
+			static_cast<uint32_t>(_textures.size()),
+			_residentBytes,
+			_budget,
+			_streamedMips,
+			_evictedMips
+		};
+	}
+
+	void TextureStreamer::setResidentMip(
+		const vk::raii::CommandBuffer& commandBuffer, StreamedTexture& texture, const uint32_t newResidentMip
+	)
+	{
+		const auto& mips = texture.source->mips;
+		const uint32_t mipCount = texture.source->header->mipCount;
+		const uint32_t oldResidentMip = texture.residentMip;
+		const uint32_t levelCount = mipCount - newResidentMip;
+
+		ResidentImage next;
+
+		const vk::ImageCreateInfo imageInfo(
+			{},
+			vk::ImageType::e2D,
+			texture.format,
+			vk::Extent3D(mips[newResidentMip].width, mips[newResidentMip].height, 1),
+			levelCount,
+			1,
+			vk::SampleCountFlagBits::e1,
+			vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst,
+			vk::SharingMode::eExclusive
+		);
+		next.image = vk::raii::Image(_device, imageInfo);
+		next.allocation = _allocator.allocateForImage(next.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+		const vk::ImageViewCreateInfo viewInfo(
+			{},
+			next.image,
+			vk::ImageViewType::e2D,
+			texture.format,
+			{},
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1)
+		);
+		next.view = vk::raii::ImageView(_device, viewInfo);
+
+		const bool hasOldImage = oldResidentMip < mipCount;
+
+		std::vector<vk::ImageMemoryBarrier2> beforeCopies = {
+			vk::ImageMemoryBarrier2(
+				vk::PipelineStageFlagBits2::eNone,
+				vk::AccessFlagBits2::eNone,
+				vk::PipelineStageFlagBits2::eCopy,
+				vk::AccessFlagBits2::eTransferWrite,
+				vk::ImageLayout::eUndefined,
+				vk::ImageLayout::eTransferDstOptimal,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				*next.image,
+				vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1)
+			)
+		};
+
+		// Earlier frames may still sample the old image, the copy waits for them (it's retired afterwards)
+		if(hasOldImage)
+		{
+			beforeCopies.emplace_back(
+				TEXTURE_SAMPLE_STAGES,
+				vk::AccessFlagBits2::eNone,
+				vk::PipelineStageFlagBits2::eCopy,
+				vk::AccessFlagBits2::eTransferRead,
+				vk::ImageLayout::eShaderReadOnlyOptimal,
+				vk::ImageLayout::eTransferSrcOptimal,
+				VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED,
+				*texture.resident.image,
+				vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, mipCount - oldResidentMip, 0, 1)
+			);
+		}
+
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, beforeCopies));
+
+		// Mips both images hold are copied on the GPU, the rest comes from the file
+		for(uint32_t mip = newResidentMip; mip < mipCount; mip++)
+		{
+			const vk::Extent3D extent(mips[mip].width, mips[mip].height, 1);
+			const vk::ImageSubresourceLayers dstLayers(vk::ImageAspectFlagBits::eColor, mip - newResidentMip, 0, 1);
+
+			if(hasOldImage && mip >= oldResidentMip)
+			{
+				const vk::ImageCopy region(
+					vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip - oldResidentMip, 0, 1),
+					{},
+					dstLayers,
+					{},
+					extent
+				);
+				commandBuffer.copyImage(
+					texture.resident.image,
+					vk::ImageLayout::eTransferSrcOptimal,
+					next.image,
+					vk::ImageLayout::eTransferDstOptimal,
+					region
+				);
+				continue;
+			}
+
+			const auto [stagingBuffer, stagingOffset] = stage(texture.source->getMipData(mip));
+			const vk::BufferImageCopy region(stagingOffset, 0, 0, dstLayers, {}, extent);
+			commandBuffer.copyBufferToImage(stagingBuffer, next.image, vk::ImageLayout::eTransferDstOptimal, region);
+		}
+
+		const vk::ImageMemoryBarrier2 afterCopies(
+			vk::PipelineStageFlagBits2::eCopy,
+			vk::AccessFlagBits2::eTransferWrite,
+			TEXTURE_SAMPLE_STAGES,
+			vk::AccessFlagBits2::eShaderSampledRead,
+			vk::ImageLayout::eTransferDstOptimal,
+			vk::ImageLayout::eShaderReadOnlyOptimal,
+			VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED,
+			*next.image,
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levelCount, 0, 1)
+		);
+		commandBuffer.pipelineBarrier2(vk::DependencyInfo({}, {}, {}, afterCopies));
+
+		// Frames in flight keep sampling the old image through the old handle
+		const BindlessHandle handle = _bindlessTable.addSampledImage(*next.view);
+		_bindlessTable.removeSampledImage(texture.handle, _frameNumber);
+		texture.handle = handle;
+
+		if(hasOldImage)
+			_retired.push_back({std::move(texture.resident), {}, _frameNumber});
+
+		const vk::DeviceSize residentBytes = getMipBytes(texture, newResidentMip);
+		_residentBytes = _residentBytes - texture.residentBytes + residentBytes;
+
+		texture.resident = std::move(next);
+		texture.residentMip = newResidentMip;
+		texture.residentBytes = residentBytes;
+	}
+
+	vk::DeviceSize TextureStreamer::getMipBytes(const StreamedTexture& texture, const uint32_t firstMip)
+	{
+		vk::DeviceSize bytes = 0;
+		for(uint32_t mip = firstMip; mip < texture.source->header->mipCount; mip++)
+		{
+			bytes += texture.source->mips[mip].size;
+		}
+		return bytes;
+	}
+
+	std::pair<vk::Buffer, vk::DeviceSize> TextureStreamer::stage(const std::span<const std::byte> data)
+	{
+		if(const auto staging = _frameRing.write(data.data(), data.size()))
+			return {staging.buffer, staging.offset};
+
+		// Too big for the ring (a large top mip), gets its own buffer until the frame completes
+		StagingBuffer staging;
+
+		const vk::BufferCreateInfo bufferInfo(
+			{},
+			data.size(),
+			vk::BufferUsageFlagBits::eTransferSrc,
+			vk::SharingMode::eExclusive
+		);
+		staging.buffer = vk::raii::Buffer(_device, bufferInfo);
+		staging.allocation = _allocator.allocateForBuffer(
+			staging.buffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+
+		std::memcpy(staging.allocation.getMappedData(), data.data(), data.size());
+
+		const vk::Buffer buffer = *staging.buffer;
+		_retired.push_back({{}, std::move(staging), _frameNumber});
+
+		return {buffer, 0};
+	}
+}
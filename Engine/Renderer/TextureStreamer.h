@@ -0,0 +1,197 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include <AssetManager.h>
+
+#include "BindlessTable.h"
+#include "MemoryAllocator.h"
+#include "RingBuffer.h"
+
+namespace Renderer
+{
+	using TextureId = uint32_t;
+
+	constexpr TextureId INVALID_TEXTURE = UINT32_MAX;
+
+	/**
+	 * Mips with both sides at most this big form the tail, which is resident from the start and never evicted
+	 */
+	constexpr uint32_t TEXTURE_MIP_TAIL_SIZE = 64;
+
+	constexpr vk::DeviceSize DEFAULT_TEXTURE_BUDGET = 256ull * 1024 * 1024;
+
+	/**
+	 * Bytes of mips streamed in per frame (at least one mip is always streamed when one is wanted)
+	 */
+	constexpr vk::DeviceSize TEXTURE_STREAMING_BYTES_PER_FRAME = 8ull * 1024 * 1024;
+
+	/**
+	 * A texture not requested for this many frames falls back to wanting only its tail
+	 */
+	constexpr uint64_t TEXTURE_REQUEST_TIMEOUT_FRAMES = 120;
+
+	struct TextureStreamingStats
+	{
+		uint32_t textureCount = 0;
+		vk::DeviceSize residentBytes = 0;
+		vk::DeviceSize budgetBytes = 0;
+		uint64_t streamedMips = 0;
+		uint64_t evictedMips = 0;
+	};
+
+	/**
+	 * Keeps only the mips that are needed on screen in memory.
+	 *
+	 * A texture starts with its mip tail. Users report how big it is on screen (requestSize), the streamer picks
+	 * the mip that is needed for that and streams the levels above the resident ones, one per frame and within a
+	 * per frame byte cap. When the resident mips exceed the budget, the textures that were requested the longest
+	 * ago lose their top mips first.
+	 *
+	 * Every texture's image only holds its resident mips: growing or shrinking creates a new image, copies the
+	 * kept mips over on the GPU, uploads the new ones and swaps the bindless handle. Old images and handles
+	 * are released once the frames that used them completed. (Sparse residency isn't available everywhere,
+	 * per-residency images work on every device.)
+	 */
+	class TextureStreamer
+	{
+	public:
+		/**
+		 * @param device Logical device
+		 * @param allocator Allocator of the images and of the staging buffers that don't fit in the ring
+		 * @param frameRing Per-frame staging memory
+		 * @param bindlessTable Table the textures are sampled through
+		 * @param budget Bytes the resident mips may use
+		 */
+		TextureStreamer(
+			const vk::raii::Device& device,
+			MemoryAllocator& allocator,
+			RingBuffer& frameRing,
+			BindlessTable& bindlessTable,
+			vk::DeviceSize budget = DEFAULT_TEXTURE_BUDGET
+		);
+		~TextureStreamer() = default;
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		/**
+		 * Adds a texture, its mip tail is uploaded by the next update()
+		 * The asset (its mapping) is kept to stream the other mips from.
+		 */
+		TextureId addTexture(std::shared_ptr<const Assets::AssetType::Texture> texture);
+
+		/**
+		 * Screen-space feedback, the mip whose size matches is streamed in
+		 *
+		 * @param pixels Largest side of the texture on screen in pixels
+		 */
+		void requestSize(TextureId texture, float pixels);
+
+		/**
+		 * @return Handle of the texture's image, changes whenever the resident mips change
+		 * (INVALID_BINDLESS_HANDLE until the first update after addTexture)
+		 */
+		[[nodiscard]] BindlessHandle getHandle(TextureId texture) const;
+
+		/**
+		 * @return Largest resident mip of the texture
+		 */
+		[[nodiscard]] uint32_t getResidentMip(TextureId texture) const;
+
+		void setBudget(vk::DeviceSize budget);
+
+		/**
+		 * Evicts over budget textures and records the copies of the streamed mips
+		 * Has to be recorded before anything samples the textures in the frame.
+		 *
+		 * @param commandBuffer Frame's command buffer
+		 * @param frameNumber Frame being recorded
+		 */
+		void update(const vk::raii::CommandBuffer& commandBuffer, uint64_t frameNumber);
+
+		/**
+		 * Destroys the images and staging buffers the completed frames were the last users of
+		 */
+		void reclaim(uint64_t completedFrameNumber);
+
+		[[nodiscard]] TextureStreamingStats getStats() const;
+
+	private:
+		/**
+		 * Image holding the mips [residentMip, mipCount), memory declared first so the image dies before it
+		 */
+		struct ResidentImage
+		{
+			Allocation allocation;
+			vk::raii::Image image = VK_NULL_HANDLE;
+			vk::raii::ImageView view = VK_NULL_HANDLE;
+		};
+
+		struct StreamedTexture
+		{
+			std::shared_ptr<const Assets::AssetType::Texture> source;
+			vk::Format format = vk::Format::eUndefined;
+
+			ResidentImage resident;
+			BindlessHandle handle = INVALID_BINDLESS_HANDLE;
+			// mipCount while nothing is resident
+			uint32_t residentMip = 0;
+			vk::DeviceSize residentBytes = 0;
+
+			// Smallest mip that is never evicted
+			uint32_t tailMip = 0;
+			uint32_t wantedMip = 0;
+			uint64_t lastRequestFrame = 0;
+		};
+
+		struct StagingBuffer
+		{
+			Allocation allocation;
+			vk::raii::Buffer buffer = VK_NULL_HANDLE;
+		};
+
+		struct Retired
+		{
+			ResidentImage image;
+			StagingBuffer staging;
+			uint64_t frameNumber;
+		};
+
+		const vk::raii::Device& _device;
+		MemoryAllocator& _allocator;
+		RingBuffer& _frameRing;
+		BindlessTable& _bindlessTable;
+
+		vk::DeviceSize _budget;
+		vk::DeviceSize _residentBytes = 0;
+		uint64_t _frameNumber = 0;
+
+		std::vector<StreamedTexture> _textures;
+		std::deque<Retired> _retired;
+
+		uint64_t _streamedMips = 0;
+		uint64_t _evictedMips = 0;
+
+		/**
+		 * Replaces the texture's image by one holding [newResidentMip, mipCount)
+		 */
+		void setResidentMip(const vk::raii::CommandBuffer& commandBuffer, StreamedTexture& texture, uint32_t newResidentMip);
+
+		/**
+		 * @return Bytes of the mips [firstMip, mipCount)
+		 */
+		[[nodiscard]] static vk::DeviceSize getMipBytes(const StreamedTexture& texture, uint32_t firstMip);
+
+		/**
+		 * Copies the data into memory the GPU can copy from until the frame completes
+		 *
+		 * @return Buffer and offset of the copy
+		 */
+		std::pair<vk::Buffer, vk::DeviceSize> stage(std::span<const std::byte> data);
+	};
+}
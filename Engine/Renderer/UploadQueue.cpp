@@ -0,0 +1,222 @@
+#include "UploadQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Renderer
+{
+	namespace
+	{
+		// Keeps every copy source offset valid for buffer to image copies too
+		constexpr vk::DeviceSize STAGING_COPY_ALIGNMENT = 16;
+	}
+
+	UploadQueue::UploadQueue(
+		const vk::raii::Device& device, MemoryAllocator& allocator, const uint32_t queueFamilyIndex,
+		const uint32_t queueIndex
+	) : _device(device), _allocator(allocator)
+	{
+		_queue = vk::raii::Queue(_device, queueFamilyIndex, queueIndex);
+
+		const vk::CommandPoolCreateInfo commandPoolInfo(
+			vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+			queueFamilyIndex
+		);
+		_commandPool = vk::raii::CommandPool(_device, commandPoolInfo);
+
+		vk::SemaphoreTypeCreateInfo semaphoreTypeInfo(vk::SemaphoreType::eTimeline, 0);
+		const vk::SemaphoreCreateInfo semaphoreInfo({}, &semaphoreTypeInfo);
+		_timeline = vk::raii::Semaphore(_device, semaphoreInfo);
+	}
+
+	UploadTicket UploadQueue::enqueue(
+		const void* data, const vk::DeviceSize size, const vk::Buffer dstBuffer, const vk::DeviceSize dstOffset
+	)
+	{
+		std::lock_guard lock(_mutex);
+
+		beginBatch();
+
+		auto& chunk = reserveStaging(size);
+		const vk::DeviceSize srcOffset = chunk.used;
+
+		std::memcpy(static_cast<char*>(chunk.allocation.getMappedData()) + srcOffset, data, size);
+		chunk.used = std::min(
+			chunk.size,
+			(srcOffset + size + STAGING_COPY_ALIGNMENT - 1) / STAGING_COPY_ALIGNMENT * STAGING_COPY_ALIGNMENT
+		);
+
+		_pending.commandBuffer.copyBuffer(chunk.buffer, dstBuffer, vk::BufferCopy(srcOffset, dstOffset, size));
+
+		return _pending.ticket;
+	}
+
+	UploadTicket UploadQueue::enqueueCopy(
+		const vk::Buffer srcBuffer, const vk::DeviceSize srcOffset, const vk::DeviceSize size,
+		const vk::Buffer dstBuffer, const vk::DeviceSize dstOffset
+	)
+	{
+		std::lock_guard lock(_mutex);
+
+		beginBatch();
+
+		_pending.commandBuffer.copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy(srcOffset, dstOffset, size));
+
+		return _pending.ticket;
+	}
+
+	UploadTicket UploadQueue::flush()
+	{
+		std::lock_guard lock(_mutex);
+		return flushLocked();
+	}
+
+	UploadTicket UploadQueue::flushLocked()
+	{
+		if(!_hasPending) return _lastSubmitted;
+
+		_pending.commandBuffer.end();
+
+		const vk::CommandBufferSubmitInfo commandBufferInfo(*_pending.commandBuffer);
+		const vk::SemaphoreSubmitInfo signalInfo(
+			*_timeline,
+			_pending.ticket,
+			vk::PipelineStageFlagBits2::eAllTransfer
+		);
+
+		const vk::SubmitInfo2 submitInfo(
+			{},
+			0,
+			nullptr,
+			1,
+			&commandBufferInfo,
+			1,
+			&signalInfo
+		);
+
+		_queue.submit2(submitInfo);
+
+		_lastSubmitted = _pending.ticket;
+		_inFlight.push_back(std::move(_pending));
+		_pending = Batch();
+		_hasPending = false;
+
+		return _lastSubmitted;
+	}
+
+	bool UploadQueue::isComplete(const UploadTicket ticket) const
+	{
+		return _timeline.getCounterValue() >= ticket;
+	}
+
+	void UploadQueue::wait(const UploadTicket ticket)
+	{
+		{
+			std::lock_guard lock(_mutex);
+			if(ticket > _lastSubmitted) flushLocked();
+		}
+
+		const vk::Semaphore semaphore = *_timeline;
+		const vk::SemaphoreWaitInfo waitInfo({}, 1, &semaphore, &ticket);
+
+		while(vk::Result::eTimeout == _device.waitSemaphores(waitInfo, UINT64_MAX))
+		{
+		}
+
+		collect();
+	}
+
+	void UploadQueue::collect()
+	{
+		std::lock_guard lock(_mutex);
+		collectLocked();
+	}
+
+	void UploadQueue::collectLocked()
+	{
+		const UploadTicket completed = _timeline.getCounterValue();
+
+		while(!_inFlight.empty() && _inFlight.front().ticket <= completed)
+		{
+			auto& batch = _inFlight.front();
+
+			_freeCommandBuffers.push_back(std::move(batch.commandBuffer));
+			for(auto& chunk : batch.chunks)
+			{
+				chunk.used = 0;
+				_freeChunks.push_back(std::move(chunk));
+			}
+
+			_inFlight.pop_front();
+		}
+	}
+
+	vk::Semaphore UploadQueue::getSemaphore() const
+	{
+		return *_timeline;
+	}
+
+	UploadTicket UploadQueue::getLastSubmitted() const
+	{
+		std::lock_guard lock(_mutex);
+		return _lastSubmitted;
+	}
+
+	void UploadQueue::beginBatch()
+	{
+		if(_hasPending) return;
+
+		collectLocked();
+
+		if(_freeCommandBuffers.empty())
+		{
+			const vk::CommandBufferAllocateInfo allocateInfo(_commandPool, vk::CommandBufferLevel::ePrimary, 1);
+			_pending.commandBuffer = std::move(_device.allocateCommandBuffers(allocateInfo).front());
+		}
+		else
+		{
+			_pending.commandBuffer = std::move(_freeCommandBuffers.back());
+			_freeCommandBuffers.pop_back();
+			_pending.commandBuffer.reset();
+		}
+
+		_pending.commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+		_pending.ticket = _lastSubmitted + 1;
+		_hasPending = true;
+	}
+
+	UploadQueue::StagingChunk& UploadQueue::reserveStaging(const vk::DeviceSize size)
+	{
+		if(!_pending.chunks.empty())
+		{
+			if(auto& chunk = _pending.chunks.back(); chunk.size - chunk.used >= size) return chunk;
+		}
+
+		for(auto chunk = _freeChunks.begin(); chunk != _freeChunks.end(); ++chunk)
+		{
+			if(chunk->size < size) continue;
+
+			_pending.chunks.push_back(std::move(*chunk));
+			_freeChunks.erase(chunk);
+			return _pending.chunks.back();
+		}
+
+		StagingChunk chunk;
+		chunk.size = std::max(size, UPLOAD_STAGING_CHUNK_SIZE);
+
+		const vk::BufferCreateInfo bufferInfo(
+			{},
+			chunk.size,
+			vk::BufferUsageFlagBits::eTransferSrc,
+			vk::SharingMode::eExclusive
+		);
+		chunk.buffer = vk::raii::Buffer(_device, bufferInfo);
+		chunk.allocation = _allocator.allocateForBuffer(
+			chunk.buffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+		);
+
+		_pending.chunks.push_back(std::move(chunk));
+		return _pending.chunks.back();
+	}
+}
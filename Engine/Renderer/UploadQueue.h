@@ -0,0 +1,155 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan_raii.hpp>
+
+#include "MemoryAllocator.h"
+
+namespace Renderer
+{
+	/**
+	 * Value of the upload timeline semaphore that is signaled once the upload is on the GPU
+	 */
+	using UploadTicket = uint64_t;
+
+	/**
+	 * Minimal size of a staging chunk, bigger uploads get a chunk of their own size
+	 */
+	constexpr vk::DeviceSize UPLOAD_STAGING_CHUNK_SIZE = 8ull * 1024 * 1024;
+
+	/**
+	 * Batches staging copies into one command buffer per submission.
+	 * Runs on a dedicated transfer queue when the device has one and signals a timeline semaphore,
+	 * so nobody has to wait for the queue to go idle.
+	 */
+	class UploadQueue
+	{
+	public:
+		/**
+		 * @param device Logical device
+		 * @param allocator Allocator used for staging memory
+		 * @param queueFamilyIndex Queue family the copies are submitted to
+		 * @param queueIndex Index of the queue inside the family
+		 */
+		UploadQueue(
+			const vk::raii::Device& device,
+			MemoryAllocator& allocator,
+			uint32_t queueFamilyIndex,
+			uint32_t queueIndex
+		);
+		~UploadQueue() = default;
+
+		UploadQueue(const UploadQueue&) = delete;
+		UploadQueue& operator=(const UploadQueue&) = delete;
+
+		/**
+		 * Copies the data into staging memory and records a copy into the pending batch.
+		 * Nothing is submitted until flush().
+		 *
+		 * @param data Source data, it can be freed right after the call
+		 * @param size Size in bytes
+		 * @param dstBuffer Destination buffer (needs TransferDst usage)
+		 * @param dstOffset Offset inside the destination buffer
+		 * @return Ticket that completes once the copy is finished
+		 */
+		UploadTicket enqueue(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset = 0);
+
+		/**
+		 * Records a copy from memory the caller keeps alive until the ticket completes
+		 * (e.g. a range of the frame ring buffer)
+		 *
+		 * @return Ticket that completes once the copy is finished
+		 */
+		UploadTicket enqueueCopy(
+			vk::Buffer srcBuffer,
+			vk::DeviceSize srcOffset,
+			vk::DeviceSize size,
+			vk::Buffer dstBuffer,
+			vk::DeviceSize dstOffset = 0
+		);
+
+		/**
+		 * Submits the pending batch
+		 *
+		 * @return Ticket of the last submitted batch
+		 */
+		UploadTicket flush();
+
+		/**
+		 * Non-blocking check if the upload is finished
+		 */
+		[[nodiscard]] bool isComplete(UploadTicket ticket) const;
+
+		/**
+		 * Blocks until the upload is finished, flushing it first if it's still pending
+		 */
+		void wait(UploadTicket ticket);
+
+		/**
+		 * Returns staging memory and command buffers of finished batches to the free lists
+		 */
+		void collect();
+
+		/**
+		 * @return Timeline semaphore that reaches the ticket value once the upload is done
+		 */
+		[[nodiscard]] vk::Semaphore getSemaphore() const;
+
+		/**
+		 * @return Ticket of the last submitted batch (0 if nothing was ever submitted)
+		 */
+		[[nodiscard]] UploadTicket getLastSubmitted() const;
+
+	private:
+		struct StagingChunk
+		{
+			Allocation allocation;
+			vk::raii::Buffer buffer = VK_NULL_HANDLE;
+			vk::DeviceSize size = 0;
+			vk::DeviceSize used = 0;
+		};
+
+		struct Batch
+		{
+			vk::raii::CommandBuffer commandBuffer = VK_NULL_HANDLE;
+			std::vector<StagingChunk> chunks;
+			UploadTicket ticket = 0;
+		};
+
+		const vk::raii::Device& _device;
+		MemoryAllocator& _allocator;
+
+		vk::raii::Queue _queue = VK_NULL_HANDLE;
+		vk::raii::CommandPool _commandPool = VK_NULL_HANDLE;
+		vk::raii::Semaphore _timeline = VK_NULL_HANDLE;
+
+		UploadTicket _lastSubmitted = 0;
+
+		Batch _pending;
+		bool _hasPending = false;
+
+		std::deque<Batch> _inFlight;
+
+		std::vector<vk::raii::CommandBuffer> _freeCommandBuffers;
+		std::vector<StagingChunk> _freeChunks;
+
+		mutable std::mutex _mutex;
+
+		/**
+		 * Opens the pending batch if there isn't one
+		 */
+		void beginBatch();
+
+		/**
+		 * Finds staging space for the upload in the pending batch
+		 */
+		StagingChunk& reserveStaging(vk::DeviceSize size);
+
+		UploadTicket flushLocked();
+
+		void collectLocked();
+	};
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace Renderer
+{
+	/*
+	 * Attribute formats: the value an attribute is set from and how it's stored in the vertex buffer
+	 * Half and normalized formats are still read as float by the shader, only the fetch gets smaller.
+	 */
+
+	struct Float2Format
+	{
+		using Value = glm::vec2;
+		using Storage = glm::vec2;
+		static constexpr auto FORMAT = vk::Format::eR32G32Sfloat;
+
+		static Storage pack(const Value& value) { return value; }
+	};
+
+	struct Float3Format
+	{
+		using Value = glm::vec3;
+		using Storage = glm::vec3;
+		static constexpr auto FORMAT = vk::Format::eR32G32B32Sfloat;
+
+		static Storage pack(const Value& value) { return value; }
+	};
+
+	struct Float4Format
+	{
+		using Value = glm::vec4;
+		using Storage = glm::vec4;
+		static constexpr auto FORMAT = vk::Format::eR32G32B32A32Sfloat;
+
+		static Storage pack(const Value& value) { return value; }
+	};
+
+	// Positions in mesh space, 11 bits of mantissa
+	struct Half2Format
+	{
+		using Value = glm::vec2;
+		using Storage = uint32_t;
+		static constexpr auto FORMAT = vk::Format::eR16G16Sfloat;
+
+		static Storage pack(const Value& value) { return glm::packHalf2x16(value); }
+	};
+
+	// There is no 3 component variant: R16G16B16 is rarely supported for vertex fetch
+	struct Half4Format
+	{
+		using Value = glm::vec4;
+		using Storage = uint64_t;
+		static constexpr auto FORMAT = vk::Format::eR16G16B16A16Sfloat;
+
+		static Storage pack(const Value& value) { return glm::packHalf4x16(value); }
+	};
+
+	// Normals and tangents (w is free for the bitangent sign)
+	struct Snorm8x4Format
+	{
+		using Value = glm::vec4;
+		using Storage = uint32_t;
+		static constexpr auto FORMAT = vk::Format::eR8G8B8A8Snorm;
+
+		static Storage pack(const Value& value) { return glm::packSnorm4x8(value); }
+	};
+
+	// Octahedron encoded normals
+	struct Snorm16x2Format
+	{
+		using Value = glm::vec2;
+		using Storage = uint32_t;
+		static constexpr auto FORMAT = vk::Format::eR16G16Snorm;
+
+		static Storage pack(const Value& value) { return glm::packSnorm2x16(value); }
+	};
+
+	// Colors and texture coordinates in [0, 1]
+	struct Unorm8x4Format
+	{
+		using Value = glm::vec4;
+		using Storage = uint32_t;
+		static constexpr auto FORMAT = vk::Format::eR8G8B8A8Unorm;
+
+		static Storage pack(const Value& value) { return glm::packUnorm4x8(value); }
+	};
+
+	struct Unorm16x2Format
+	{
+		using Value = glm::vec2;
+		using Storage = uint32_t;
+		static constexpr auto FORMAT = vk::Format::eR16G16Unorm;
+
+		static Storage pack(const Value& value) { return glm::packUnorm2x16(value); }
+	};
+
+	struct Uint32Format
+	{
+		using Value = uint32_t;
+		using Storage = uint32_t;
+		static constexpr auto FORMAT = vk::Format::eR32Uint;
+
+		static Storage pack(const Value value) { return value; }
+	};
+
+	template<uint32_t Location, typename Format>
+	struct VertexAttribute
+	{
+		static constexpr uint32_t LOCATION = Location;
+		using AttributeFormat = Format;
+
+		// Keeps every attribute (and the stride) 4 byte aligned, which covers the component alignment of every format
+		static_assert(sizeof(typename Format::Storage) % 4 == 0, "Vertex attributes must be a multiple of 4 bytes.");
+	};
+
+	/**
+	 * Attributes of one vertex buffer binding, packed in order without padding
+	 * The binding and attribute descriptions are generated at compile time, Packed builds a vertex in the layout.
+	 */
+	template<uint32_t Binding, vk::VertexInputRate InputRate, typename... Attributes>
+	class VertexLayout
+	{
+	public:
+		static_assert(sizeof...(Attributes) > 0, "A vertex layout needs at least one attribute.");
+
+		static constexpr uint32_t BINDING = Binding;
+		static constexpr uint32_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+		static constexpr uint32_t STRIDE = (0 + ... + sizeof(typename Attributes::AttributeFormat::Storage));
+
+		static constexpr std::array<uint32_t, ATTRIBUTE_COUNT> LOCATIONS = {Attributes::LOCATION...};
+
+		static constexpr std::array<uint32_t, ATTRIBUTE_COUNT> OFFSETS = []
+		{
+			constexpr std::array<uint32_t, ATTRIBUTE_COUNT> sizes = {
+				sizeof(typename Attributes::AttributeFormat::Storage)...
+			};
+
+			std::array<uint32_t, ATTRIBUTE_COUNT> offsets{};
+			for(uint32_t i = 1; i < ATTRIBUTE_COUNT; i++)
+				offsets[i] = offsets[i - 1] + sizes[i - 1];
+			return offsets;
+		}();
+
+		static_assert([]
+		{
+			for(uint32_t i = 0; i < ATTRIBUTE_COUNT; i++)
+			{
+				for(uint32_t j = i + 1; j < ATTRIBUTE_COUNT; j++)
+				{
+					if(LOCATIONS[i] == LOCATIONS[j]) return false;
+				}
+			}
+			return true;
+		}(), "Vertex attributes must have distinct locations.");
+
+		/**
+		 * @return Index of the attribute at this location, fails to compile if there is none
+		 */
+		template<uint32_t Location>
+		static consteval uint32_t indexOf()
+		{
+			for(uint32_t i = 0; i < ATTRIBUTE_COUNT; i++)
+			{
+				if(LOCATIONS[i] == Location) return i;
+			}
+			throw "The vertex layout has no attribute at this location";
+		}
+
+		template<uint32_t Location>
+		using FormatAt = typename std::tuple_element_t<indexOf<Location>(), std::tuple<Attributes...>>::AttributeFormat;
+
+		static constexpr vk::VertexInputBindingDescription getBindingDescription()
+		{
+			vk::VertexInputBindingDescription description{};
+			description.binding = Binding;
+			description.stride = STRIDE;
+			description.inputRate = InputRate;
+			return description;
+		}
+
+		static constexpr std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions()
+		{
+			constexpr std::array<vk::Format, ATTRIBUTE_COUNT> formats = {Attributes::AttributeFormat::FORMAT...};
+
+			std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> descriptions{};
+			for(uint32_t i = 0; i < ATTRIBUTE_COUNT; i++)
+			{
+				descriptions[i].location = LOCATIONS[i];
+				descriptions[i].binding = Binding;
+				descriptions[i].format = formats[i];
+				descriptions[i].offset = OFFSETS[i];
+			}
+			return descriptions;
+		}
+
+		/**
+		 * One vertex in this layout, every attribute is packed (quantized) as it's set
+		 */
+		struct Packed
+		{
+			std::array<std::byte, STRIDE> bytes{};
+
+			template<uint32_t Location>
+			void set(const typename FormatAt<Location>::Value& value)
+			{
+				const auto packed = FormatAt<Location>::pack(value);
+				std::memcpy(bytes.data() + OFFSETS[indexOf<Location>()], &packed, sizeof(packed));
+			}
+		};
+	};
+
+	/**
+	 * Binding and attribute descriptions of the layouts of a pipeline, one binding per layout
+	 */
+	template<typename... Layouts>
+	struct VertexInputDescription
+	{
+		static constexpr uint32_t ATTRIBUTE_COUNT = (0 + ... + Layouts::ATTRIBUTE_COUNT);
+
+		static constexpr std::array<vk::VertexInputBindingDescription, sizeof...(Layouts)> getBindingDescriptions()
+		{
+			return {Layouts::getBindingDescription()...};
+		}
+
+		static constexpr std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> getAttributeDescriptions()
+		{
+			std::array<vk::VertexInputAttributeDescription, ATTRIBUTE_COUNT> descriptions{};
+
+			uint32_t next = 0;
+			([&]
+			{
+				for(const auto& description : Layouts::getAttributeDescriptions())
+					descriptions[next++] = description;
+			}(), ...);
+
+			return descriptions;
+		}
+	};
+}
@@ -3,12 +3,16 @@
 #include <iostream>
 #include <ostream>
 
-#include <Renderer/Shader.h>
 #include <AssetManager.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <tuple>
 
 namespace Renderer
 {
@@ -16,21 +20,52 @@ namespace Renderer
 	{
 		_window = window;
 
+		initialize();
+
+		glfwSetWindowUserPointer(window, &(this->_frameBufferResized));
+		glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
+	}
+
+	void VulkanContext::InitializeHeadless(const vk::Extent2D extent)
+	{
+		_isHeadless = true;
+		_swapChainExtent = extent;
+
+		initialize();
+	}
+
+	void VulkanContext::initialize()
+	{
+		const auto initializeStart = std::chrono::steady_clock::now();
+
+		// Read from disk while the device is created, the pipelines pick the shaders up from the asset cache
+		const auto shaderLoad = Assets::AssetManager::loadAsync<Assets::AssetType::Shader>("shader");
+		const auto cullLoad = Assets::AssetManager::loadAsync<Assets::AssetType::Shader>("cull");
+
 		createInstance();
 		setupDebugMessenger();
 		pickPhysicalDevice();
 
-		createSurface(_window);
+		if(!_isHeadless) createSurface(_window);
 
 		findBestQueueFamilyIndexes();
 		createLogicalDevice();
 		createQueues();
+		createMemoryAllocator();
+		createUploadQueue();
+		createFrameRingBuffer();
 
-		createSwapChain(_window);
+		if(_isHeadless)
+			createOffscreenTargets();
+		else
+			createSwapChain(_window, VK_NULL_HANDLE);
 		createImageViews();
 
-		createDescriptorSetLayout();
+		createBindlessTable();
+		createPipelineCache();
+		createPipelineLayout();
 		createGraphicsPipeline();
+		createCullPipeline();
 
 		createCommandPool();
 
@@ -38,21 +73,52 @@ namespace Renderer
 
 		createVertexBuffer();
 		createIndexBuffer();
-		createUniformBuffers();
+		createSceneBuffers();
+
+		// The geometry is in staging memory now, the mapping isn't needed anymore
+		_mesh.reset();
 
-		createDescriptorPool();
-		createDescriptorSets();
+		registerBindlessResources();
+		createTextureStreamer();
 
 		createCommandBuffer();
+		createCommandRecorder();
+		createGpuProfiler();
+		createRenderGraph();
 
-		glfwSetWindowUserPointer(window, &(this->_frameBufferResized));
-		glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
+		// The first frame waits for these on the GPU, not the CPU
+		_uploadQueue->flush();
+
+		_allocator->printStats();
+
+		std::printf(
+			"Vulkan initialized in %.2f ms (%s pipeline cache%s)\n",
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initializeStart).count(),
+			_pipelineCache->isWarm() ? "warm" : "cold",
+			_isHeadless ? ", headless" : ""
+		);
+	}
+
+	bool VulkanContext::isHeadless() const
+	{
+		return _isHeadless;
+	}
+
+	void VulkanContext::waitIdle() const
+	{
+		_device.waitIdle();
 	}
 
 	void VulkanContext::Cleanup()
 	{
 		_device.waitIdle();
 
+		// Stops the rebuilds, the retired pipelines are idle now
+		_shaderHotReload.reset();
+
+		_pipelineCache->save();
+
+		_retiredSwapChains.clear();
 		_swapChainImageViews.clear();
 		_swapChain = VK_NULL_HANDLE;
 	}
@@ -116,8 +182,9 @@ namespace Renderer
 
 	std::vector<const char*> VulkanContext::getGLFWRequiredExtension() const
 	{
+		// Headless mode has no surface, so it needs none of the window system extensions
 		u_int32_t glfwExtensionCount = 0;
-		auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		auto glfwExtensions = _isHeadless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 		auto extensionProperties = _context.enumerateInstanceExtensionProperties();
 		bool areExtensionsSupported = true;
@@ -237,7 +304,7 @@ namespace Renderer
 		for(uint32_t i = 0; i < queue_families.size(); i++)
 		{
 			if(const auto family = queue_families[i]; family.queueFlags & vk::QueueFlagBits::eGraphics &&
-				_physical_device.getSurfaceSupportKHR(i, _surface))
+				(_isHeadless || _physical_device.getSurfaceSupportKHR(i, _surface)))
 			{
 				_graphics_family_index = i;
 				_present_family_index = i;
@@ -245,7 +312,7 @@ namespace Renderer
 			}
 		}
 
-		if(_graphics_family_index == UINT32_MAX)
+		if(_graphics_family_index == UINT32_MAX && !_isHeadless)
 			for(uint32_t i = 0; i < queue_families.size(); i++)
 			{
 				const auto family = queue_families[i];
@@ -268,6 +335,26 @@ namespace Renderer
 			throw std::runtime_error(
 				"Could not find a queue for graphics or present: neither of _graphics_family_index nor _present_family_index is set."
 			);
+
+		// Transfer-only families map to the DMA engines, copies there run next to rendering
+		for(uint32_t i = 0; i < queue_families.size(); i++)
+		{
+			const auto flags = queue_families[i].queueFlags;
+			if((flags & vk::QueueFlagBits::eTransfer) &&
+				!(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+			{
+				_transfer_family_index = i;
+				_transfer_queue_index = 0;
+				break;
+			}
+		}
+
+		if(_transfer_family_index == UINT32_MAX)
+		{
+			// A second graphics queue keeps uploads off the render queue, otherwise they share it
+			_transfer_family_index = _graphics_family_index;
+			_transfer_queue_index = queue_families[_graphics_family_index].queueCount > 1 ? 1 : 0;
+		}
 	}
 
 	void VulkanContext::createSurface(GLFWwindow* window)
@@ -288,6 +375,35 @@ namespace Renderer
 		_present_queue = vk::raii::Queue(_device, _present_family_index, 0);
 	}
 
+	void VulkanContext::createMemoryAllocator()
+	{
+		_allocator = std::make_unique<MemoryAllocator>(_physical_device, _device);
+	}
+
+	void VulkanContext::createUploadQueue()
+	{
+		_uploadQueue = std::make_unique<UploadQueue>(
+			_device,
+			*_allocator,
+			_transfer_family_index,
+			_transfer_queue_index
+		);
+	}
+
+	void VulkanContext::createFrameRingBuffer()
+	{
+		_minUniformAlignment = _physical_device.getProperties().limits.minUniformBufferOffsetAlignment;
+
+		const uint32_t queueFamilies[] = {_graphics_family_index, _transfer_family_index};
+
+		_frameRing = std::make_unique<RingBuffer>(
+			_device,
+			*_allocator,
+			RING_BUFFER_FRAME_SIZE * _framesInFlight,
+			queueFamilies
+		);
+	}
+
 	void VulkanContext::createLogicalDevice()
 	{
 		auto features = _physical_device.getFeatures2();
@@ -301,31 +417,126 @@ namespace Renderer
 		deviceVulkan11Features.shaderDrawParameters = vk::True;
 
 
+		const auto supportedFeatures = _physical_device.getFeatures2<
+			vk::PhysicalDeviceFeatures2,
+			vk::PhysicalDeviceVulkan12Features
+		>();
+		_isGpuDriven =
+			supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount &&
+			supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features.multiDrawIndirect &&
+			supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance;
+
+		// The bindless table needs partially bound update-after-bind arrays
+		const auto& supportedVulkan12Features = supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>();
+		if(!supportedVulkan12Features.descriptorIndexing ||
+			!supportedVulkan12Features.runtimeDescriptorArray ||
+			!supportedVulkan12Features.descriptorBindingPartiallyBound ||
+			!supportedVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind ||
+			!supportedVulkan12Features.descriptorBindingSampledImageUpdateAfterBind ||
+			!supportedVulkan12Features.descriptorBindingUpdateUnusedWhilePending)
+		{
+			throw std::runtime_error("Failed to create logical device: descriptor indexing is not supported.");
+		}
+
+		vk::PhysicalDeviceVulkan12Features deviceVulkan12Features;
+		deviceVulkan12Features.pNext = &deviceVulkan11Features;
+		deviceVulkan12Features.timelineSemaphore = vk::True;
+		deviceVulkan12Features.drawIndirectCount = _isGpuDriven ? vk::True : vk::False;
+		deviceVulkan12Features.descriptorIndexing = vk::True;
+		deviceVulkan12Features.runtimeDescriptorArray = vk::True;
+		deviceVulkan12Features.descriptorBindingPartiallyBound = vk::True;
+		deviceVulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = vk::True;
+		deviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = vk::True;
+		deviceVulkan12Features.descriptorBindingUpdateUnusedWhilePending = vk::True;
+		deviceVulkan12Features.shaderStorageBufferArrayNonUniformIndexing = supportedVulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+		deviceVulkan12Features.shaderSampledImageArrayNonUniformIndexing = supportedVulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+
 		vk::PhysicalDeviceVulkan13Features deviceVulkan13Features;
 		deviceVulkan13Features.dynamicRendering = vk::True;
 		deviceVulkan13Features.synchronization2 = vk::True;
 
-		deviceVulkan13Features.pNext = deviceVulkan11Features;
+		deviceVulkan13Features.pNext = &deviceVulkan12Features;
 
 		features.setPNext(deviceVulkan13Features);
 
-		constexpr float queuePriority = 0.0f;
+		constexpr float queuePriorities[] = {0.0f, 0.0f};
 
-		const vk::DeviceQueueCreateInfo deviceQueueCreateInfo(
-			{},
+		std::vector<vk::DeviceQueueCreateInfo> deviceQueueCreateInfos;
+		deviceQueueCreateInfos.emplace_back(
+			vk::DeviceQueueCreateFlags{},
 			_graphics_family_index,
-			1,
-			&queuePriority
+			_transfer_family_index == _graphics_family_index ? _transfer_queue_index + 1 : 1,
+			queuePriorities
 		);
 
+		if(_transfer_family_index != _graphics_family_index)
+			deviceQueueCreateInfos.emplace_back(
+				vk::DeviceQueueCreateFlags{},
+				_transfer_family_index,
+				1,
+				queuePriorities
+			);
+
+		// Nothing is presented in headless mode, software implementations may not even expose the swapchain
+		std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+		if(_isHeadless)
+			std::erase_if(
+				enabledExtensions,
+				[](const char* extension)
+				{
+					return std::strcmp(extension, vk::KHRSwapchainExtensionName) == 0;
+				}
+			);
+
+		// Optional: lets the CPU wait for frames to reach the screen (waitForPresent)
+		vk::PhysicalDevicePresentIdFeaturesKHR presentIdFeatures;
+		vk::PhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures;
+		if(!_isHeadless)
+		{
+			const auto availableExtensions = _physical_device.enumerateDeviceExtensionProperties();
+			const auto isAvailable = [&availableExtensions](const char* name)
+			{
+				return std::ranges::any_of(
+					availableExtensions,
+					[name](const vk::ExtensionProperties& extension)
+					{
+						return std::strcmp(extension.extensionName.data(), name) == 0;
+					}
+				);
+			};
+
+			if(isAvailable(vk::KHRPresentIdExtensionName) && isAvailable(vk::KHRPresentWaitExtensionName))
+			{
+				const auto presentFeatures = _physical_device.getFeatures2<
+					vk::PhysicalDeviceFeatures2,
+					vk::PhysicalDevicePresentIdFeaturesKHR,
+					vk::PhysicalDevicePresentWaitFeaturesKHR
+				>();
+				_isPresentWaitSupported =
+					presentFeatures.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId &&
+					presentFeatures.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+			}
+		}
+
+		if(_isPresentWaitSupported)
+		{
+			enabledExtensions.push_back(vk::KHRPresentIdExtensionName);
+			enabledExtensions.push_back(vk::KHRPresentWaitExtensionName);
+
+			presentIdFeatures.presentId = vk::True;
+			presentWaitFeatures.presentWait = vk::True;
+			presentIdFeatures.pNext = &presentWaitFeatures;
+			extendedDynamicStateFeatures.pNext = &presentIdFeatures;
+		}
+
 		vk::DeviceCreateInfo deviceCreateInfo(
 			{},
-			1,
-			&deviceQueueCreateInfo,
+			static_cast<uint32_t>(deviceQueueCreateInfos.size()),
+			deviceQueueCreateInfos.data(),
 			static_cast<uint32_t>(validationLayers.size()),
 			validationLayers.data(),
-			static_cast<uint32_t>(deviceExtensions.size()),
-			deviceExtensions.data(),
+			static_cast<uint32_t>(enabledExtensions.size()),
+			enabledExtensions.data(),
 			{},
 			features
 		);
@@ -345,15 +556,37 @@ namespace Renderer
 		return result;
 	}
 
-	vk::PresentModeKHR VulkanContext::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& presentModes)
+	vk::PresentModeKHR VulkanContext::chooseSwapPresentMode(
+		const std::vector<vk::PresentModeKHR>& presentModes,
+		const PresentPolicy policy
+	)
 	{
-		for(const auto& presentMode : presentModes)
+		// FIFO is the only mode every surface supports, it ends every chain
+		std::vector<vk::PresentModeKHR> candidates;
+		switch(policy)
 		{
-			if(presentMode == vk::PresentModeKHR::eMailbox)
-			{
-				return presentMode;
-			}
+			case PresentPolicy::Immediate:
+				candidates = {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+				break;
+			case PresentPolicy::Mailbox:
+				candidates = {vk::PresentModeKHR::eMailbox};
+				break;
+			case PresentPolicy::FifoRelaxed:
+				candidates = {vk::PresentModeKHR::eFifoRelaxed};
+				break;
+			case PresentPolicy::Fifo:
+				break;
+		}
+
+		for(const auto candidate : candidates)
+		{
+			if(std::ranges::find(presentModes, candidate) != presentModes.end())
+				return candidate;
 		}
+
+		if(!candidates.empty())
+			std::printf("Swapchain -> %s isn't supported, using FIFO\n", vk::to_string(candidates.front()).c_str());
+
 		return vk::PresentModeKHR::eFifo;
 	}
 
@@ -384,7 +617,7 @@ namespace Renderer
 	}
 
 
-	void VulkanContext::createSwapChain(GLFWwindow* window)
+	void VulkanContext::createSwapChain(GLFWwindow* window, const vk::SwapchainKHR oldSwapChain)
 	{
 		const auto surfaceCapabilities = _physical_device.getSurfaceCapabilitiesKHR(_surface);
 		const auto swapChainSurfaceFormat = chooseSwapSurfaceFormat(_physical_device.getSurfaceFormatsKHR(_surface));
@@ -421,6 +654,7 @@ namespace Renderer
 		}
 
 		_swapChainImageFormat = swapChainSurfaceFormat.format;
+		_presentMode = chooseSwapPresentMode(_physical_device.getSurfacePresentModesKHR(_surface), _presentPolicy);
 
 		const vk::SwapchainCreateInfoKHR swapchainCreateInfo(
 			{},
@@ -436,17 +670,47 @@ namespace Renderer
 			queueIndices,
 			surfaceCapabilities.currentTransform,
 			vk::CompositeAlphaFlagBitsKHR::eOpaque,
-			chooseSwapPresentMode(
-				_physical_device.getSurfacePresentModesKHR(_surface)
-			),
+			_presentMode,
 			VK_TRUE,
-			VK_NULL_HANDLE
+			oldSwapChain
 		);
 
 		_swapChain = vk::raii::SwapchainKHR(_device, swapchainCreateInfo);
 		_swapChainImages = _swapChain.getImages();
 	}
 
+	void VulkanContext::createOffscreenTargets()
+	{
+		_swapChainImageFormat = HEADLESS_IMAGE_FORMAT;
+
+		_swapChainImages.clear();
+		_offscreenImages.clear();
+		_offscreenImageAllocations.clear();
+
+		// A frame slot is only reused once its frame completed, so one target per slot never races
+		for(uint32_t i = 0; i < _framesInFlight; i++)
+		{
+			const vk::ImageCreateInfo imageInfo(
+				{},
+				vk::ImageType::e2D,
+				_swapChainImageFormat,
+				vk::Extent3D(_swapChainExtent.width, _swapChainExtent.height, 1),
+				1,
+				IMAGE_ARRAY_LAYERS,
+				vk::SampleCountFlagBits::e1,
+				vk::ImageTiling::eOptimal,
+				vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+				vk::SharingMode::eExclusive
+			);
+
+			auto& image = _offscreenImages.emplace_back(_device, imageInfo);
+			_offscreenImageAllocations.push_back(
+				_allocator->allocateForImage(image, vk::MemoryPropertyFlagBits::eDeviceLocal)
+			);
+			_swapChainImages.push_back(*image);
+		}
+	}
+
 	void VulkanContext::createImageViews()
 	{
 		_swapChainImageViews.clear();
@@ -475,27 +739,96 @@ namespace Renderer
 		}
 	}
 
+	void VulkanContext::createPipelineCache()
+	{
+		_pipelineCache = std::make_unique<PipelineCache>(_physical_device, _device, PIPELINE_CACHE_PATH);
+	}
+
+	void VulkanContext::createPipelineLayout()
+	{
+		_shaderLibrary = std::make_unique<ShaderLibrary>(_device);
+
+		// Set 0 is the bindless table, shaders are only checked against it
+		_shaderLibrary->setExternalSetLayout(0, _bindlessTable->getLayout(), _bindlessTable->getLayoutBindings());
+
+		// One layout for the graphics and cull pipelines: the bindless set and the scene push constants
+		const auto layout = _shaderLibrary->getPipelineLayout(loadSceneStages());
+
+		if(layout.pushConstantSize != sizeof(ScenePushConstants))
+		{
+			throw std::runtime_error(
+				"Failed to create pipeline layout: the shaders push " + std::to_string(layout.pushConstantSize) +
+				" bytes, ScenePushConstants has " + std::to_string(sizeof(ScenePushConstants)) + "."
+			);
+		}
+
+		_pipelineLayout = layout.layout;
+		_scenePushConstantStages = layout.pushConstantStages;
+	}
+
+	std::vector<ShaderStage> VulkanContext::loadSceneStages() const
+	{
+		const auto shader = _shaderLibrary->getModule(Assets::AssetManager::load<Assets::AssetType::Shader>("shader")->spirV);
+		const auto cull = _shaderLibrary->getModule(Assets::AssetManager::load<Assets::AssetType::Shader>("cull")->spirV);
+
+		// vertMain and fragMain share one module
+		return {
+			{shader, "vertMain"},
+			{shader, "fragMain"},
+			{cull, "cullMain"}
+		};
+	}
+
+	void VulkanContext::checkSceneLayout(const std::span<const ShaderStage> stages) const
+	{
+		// Identical interfaces get the same layout from the library
+		if(_shaderLibrary->getPipelineLayout(stages).layout != _pipelineLayout)
+			throw std::runtime_error("Failed to build pipeline: the shader interface changed, it needs a restart.");
+	}
+
 	void VulkanContext::createGraphicsPipeline()
 	{
-		auto shaderSpirV = Assets::AssetManager::load<Assets::AssetType::Shader>("shader")->spirV;
+		const auto pipelineStart = std::chrono::steady_clock::now();
+
+		_graphicsPipeline = buildGraphicsPipeline();
+
+		std::printf(
+			"Graphics pipeline created in %.2f ms\n",
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count()
+		);
+	}
+
+	void VulkanContext::createCullPipeline()
+	{
+		if(!_isGpuDriven) return;
 
-		auto vertShader = Shader(_device, vk::ShaderStageFlagBits::eVertex, "vertMain", shaderSpirV);
-		auto fragShader = Shader(_device, vk::ShaderStageFlagBits::eFragment, "fragMain", shaderSpirV);
+		_cullPipeline = buildCullPipeline();
+	}
+
+	vk::raii::Pipeline VulkanContext::buildGraphicsPipeline() const
+	{
+		const auto stages = loadSceneStages();
+		checkSceneLayout(stages);
 
-		const vk::PipelineShaderStageCreateInfo vertShaderStageInfo = vertShader.getStageInfo();
-		const vk::PipelineShaderStageCreateInfo fragShaderStageInfo = fragShader.getStageInfo();
+		const auto& vertStage = stages[0];
+		const auto& fragStage = stages[1];
 
-		vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+		vk::PipelineShaderStageCreateInfo shaderStages[] = {
+			vertStage.module->getStageInfo(vertStage.entryPoint),
+			fragStage.module->getStageInfo(fragStage.entryPoint)
+		};
 
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		// Only the attributes the vertex shader reads are fetched
+		constexpr auto bindingDescriptions = SceneVertexInput::getBindingDescriptions();
+		constexpr auto attributeDescriptions = SceneVertexInput::getAttributeDescriptions();
+		const auto vertexInput = ShaderLibrary::getVertexInput(vertStage, bindingDescriptions, attributeDescriptions);
 
 		vk::PipelineVertexInputStateCreateInfo vertexInputInfo(
 			{},
-			1,
-			&bindingDescription,
-			attributeDescriptions.size(),
-			attributeDescriptions.data()
+			static_cast<uint32_t>(vertexInput.bindings.size()),
+			vertexInput.bindings.data(),
+			static_cast<uint32_t>(vertexInput.attributes.size()),
+			vertexInput.attributes.data()
 		);
 
 		vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo(
@@ -558,15 +891,6 @@ namespace Renderer
 			&colorBlendAttachmentState
 		);
 
-		vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
-			{},
-			1,
-			&*_descriptorSetLayout,
-			0
-		);
-
-		_pipelineLayout = vk::raii::PipelineLayout(_device, pipelineLayoutInfo);
-
 		vk::PipelineMultisampleStateCreateInfo pipelineMultisampleStateInfo(
 			{},
 			vk::SampleCountFlagBits::e1,
@@ -600,7 +924,23 @@ namespace Renderer
 			&pipelineRenderingInfo
 		);
 
-		_graphicsPipeline = vk::raii::Pipeline(_device, VK_NULL_HANDLE, pipelineInfo);
+		return vk::raii::Pipeline(_device, _pipelineCache->getCache(), pipelineInfo);
+	}
+
+	vk::raii::Pipeline VulkanContext::buildCullPipeline() const
+	{
+		const auto stages = loadSceneStages();
+		checkSceneLayout(stages);
+
+		const auto& cullStage = stages[2];
+
+		const vk::ComputePipelineCreateInfo pipelineInfo(
+			{},
+			cullStage.module->getStageInfo(cullStage.entryPoint),
+			_pipelineLayout
+		);
+
+		return vk::raii::Pipeline(_device, _pipelineCache->getCache(), pipelineInfo);
 	}
 
 	void VulkanContext::createCommandPool()
@@ -617,29 +957,86 @@ namespace Renderer
 		const vk::CommandBufferAllocateInfo allocateInfo(
 			_commandPool,
 			vk::CommandBufferLevel::ePrimary,
-			MAX_FRAMES_IN_FLIGHT
+			_framesInFlight
 		);
 
 		_commandBuffers = vk::raii::CommandBuffers(_device, allocateInfo);
 	}
 
+	void VulkanContext::createCommandRecorder()
+	{
+		_threadPool = std::make_unique<Core::ThreadPool>();
+		_commandRecorder = std::make_unique<ParallelCommandRecorder>(
+			_device,
+			_graphics_family_index,
+			_framesInFlight,
+			*_threadPool
+		);
+	}
+
+	void VulkanContext::createGpuProfiler()
+	{
+		_gpuProfiler = std::make_unique<GpuProfiler>(
+			_physical_device,
+			_device,
+			_graphics_family_index,
+			_framesInFlight
+		);
+	}
+
+	void VulkanContext::createRenderGraph()
+	{
+		_renderGraph = std::make_unique<RenderGraph>(_device, *_allocator, _framesInFlight);
+	}
+
 	void VulkanContext::createSyncObjects()
+	{
+		if(!_isHeadless) createSwapChainSemaphores();
+
+		// Starts at 0, the frame numbers start at 1
+		vk::SemaphoreTypeCreateInfo semaphoreTypeInfo(vk::SemaphoreType::eTimeline, 0);
+		const vk::SemaphoreCreateInfo semaphoreInfo({}, &semaphoreTypeInfo);
+		_frameTimeline = vk::raii::Semaphore(_device, semaphoreInfo);
+	}
+
+	void VulkanContext::createSwapChainSemaphores()
 	{
 		_presentCompleteSemaphores.clear();
 		_renderFinishedSemaphores.clear();
-		// FIXME: This should be a Timeline Semaphore
-		_inFlightFences.clear();
 
-		for(size_t i = 0; i < _swapChainImages.size(); i++)
-		{
+		// Acquires go by frame slot: a slot is only reused once its previous frame completed, and with it the wait
+		// on the slot's semaphore (one per image wouldn't be enough with more frames in flight than images)
+		for(uint32_t i = 0; i < _framesInFlight; i++)
 			_presentCompleteSemaphores.emplace_back(_device, vk::SemaphoreCreateInfo());
+
+		// Presents go by image, the image is only acquired again after its present finished
+		for(size_t i = 0; i < _swapChainImages.size(); i++)
 			_renderFinishedSemaphores.emplace_back(_device, vk::SemaphoreCreateInfo());
-		}
+	}
+
+	void VulkanContext::waitForFrameSlot()
+	{
+		// The slot was last used by the frame submitted _framesInFlight frames ago
+		if(_frameNumber <= _framesInFlight) return;
 
-		for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		const uint64_t waitValue = _frameNumber - _framesInFlight;
+		if(_frameTimeline.getCounterValue() < waitValue)
 		{
-			_inFlightFences.emplace_back(_device, vk::FenceCreateInfo(vk::FenceCreateFlagBits::eSignaled));
+			const auto waitStart = std::chrono::steady_clock::now();
+
+			const vk::SemaphoreWaitInfo waitInfo({}, 1, &*_frameTimeline, &waitValue);
+			if(_device.waitSemaphores(waitInfo, UINT64_MAX) != vk::Result::eSuccess)
+				throw std::runtime_error("Failed to wait for frame: timeline semaphore wait didn't succeed.");
+
+			const double waitMs = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - waitStart
+			).count();
+
+			_framePacingStats.totalWaitMs += waitMs;
+			_framePacingStats.maxWaitMs = std::max(_framePacingStats.maxWaitMs, waitMs);
 		}
+
+		_framePacingStats.frameCount++;
 	}
 
 	void VulkanContext::recordCommandBuffer(
@@ -649,20 +1046,201 @@ namespace Renderer
 		constexpr vk::CommandBufferBeginInfo commandBufferBeginInfo({}, {});
 		commandBuffer.begin(commandBufferBeginInfo);
 
-		transition_image_layout(
-			imageIndex,
+		_gpuProfiler->beginFrame(commandBuffer, _currentFrame);
+		const uint32_t frameScope = _gpuProfiler->beginScope(commandBuffer, "Frame");
+
+		auto& graph = *_renderGraph;
+		graph.reset();
+
+		// Acquire semaphore is waited on at color output, the first transition has to wait for it there too
+		const RenderResource backBuffer = graph.importImage(
+			"Back buffer",
+			_swapChainImages[imageIndex],
+			*_swapChainImageViews[imageIndex],
+			_swapChainImageFormat,
+			_swapChainExtent,
 			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::eColorAttachmentOptimal,
-			{},
-			vk::AccessFlagBits2::eColorAttachmentWrite,
-			vk::PipelineStageFlagBits2::eTopOfPipe,
+			_isHeadless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR,
 			vk::PipelineStageFlagBits2::eColorAttachmentOutput
 		);
 
+		// Textures aren't graph resources, the streamer places its own barriers before anything samples them
+		graph.addPass(
+			"Texture streaming",
+			[this](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph&)
+			{
+				_textureStreamer->update(passCommandBuffer, _frameNumber);
+			}
+		).sideEffect();
+
+		// Only the ranges written since this slot's last frame are copied, its previous reads completed already
+		std::vector<RenderResource> dynamicVertices;
+		std::vector<RenderResource> dynamicIndices;
+		if(!_dynamicGeometries.empty())
+		{
+			for(const auto& geometry : _dynamicGeometries)
+			{
+				dynamicVertices.push_back(graph.importBuffer(
+					"Dynamic vertices",
+					geometry->getVertexBuffer(_currentFrame),
+					0,
+					geometry->getVertexBufferSize()
+				));
+				dynamicIndices.push_back(graph.importBuffer(
+					"Dynamic indices",
+					geometry->getIndexBuffer(_currentFrame),
+					0,
+					geometry->getIndexBufferSize()
+				));
+			}
+
+			auto uploadPass = graph.addPass(
+				"Dynamic geometry upload",
+				[this](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph&)
+				{
+					for(const auto& geometry : _dynamicGeometries)
+						geometry->update(passCommandBuffer, _currentFrame);
+				}
+			);
+
+			for(size_t i = 0; i < dynamicVertices.size(); i++)
+			{
+				uploadPass
+					.write(dynamicVertices[i], ResourceUsage::TransferDst)
+					.write(dynamicIndices[i], ResourceUsage::TransferDst);
+			}
+		}
+
+		RenderResource drawCommands = INVALID_RENDER_RESOURCE;
+		RenderResource drawCount = INVALID_RENDER_RESOURCE;
+
+		if(_isGpuDriven)
+		{
+			const auto objectCount = static_cast<uint32_t>(_objects.size());
+			const vk::DeviceSize commandsSize = objectCount * sizeof(vk::DrawIndexedIndirectCommand);
+
+			drawCommands = graph.importBuffer(
+				"Draw commands",
+				*_indirectBuffer,
+				_currentFrame * commandsSize,
+				commandsSize
+			);
+			drawCount = graph.importBuffer(
+				"Draw count",
+				*_drawCountBuffer,
+				_currentFrame * sizeof(uint32_t),
+				sizeof(uint32_t)
+			);
+
+			graph.addPass(
+				"Reset draw count",
+				[drawCount](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph& passGraph)
+				{
+					passCommandBuffer.fillBuffer(
+						passGraph.getBuffer(drawCount),
+						passGraph.getBufferOffset(drawCount),
+						passGraph.getBufferSize(drawCount),
+						0
+					);
+				}
+			).write(drawCount, ResourceUsage::TransferDst);
+
+			graph.addPass(
+				"Culling",
+				[this](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph&)
+				{
+					recordCulling(passCommandBuffer);
+				}
+			)
+				.read(drawCount, ResourceUsage::StorageWriteCompute)
+				.write(drawCount, ResourceUsage::StorageWriteCompute)
+				.write(drawCommands, ResourceUsage::StorageWriteCompute);
+		}
+
+		auto scenePass = graph.addPass(
+			"Scene",
+			[this, backBuffer](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph& passGraph)
+			{
+				recordScene(passCommandBuffer, passGraph.getImageView(backBuffer));
+			}
+		);
+		scenePass.write(backBuffer, ResourceUsage::ColorAttachment);
+
+		if(_isGpuDriven)
+		{
+			scenePass
+				.read(drawCommands, ResourceUsage::IndirectRead)
+				.read(drawCount, ResourceUsage::IndirectRead);
+		}
+
+		for(size_t i = 0; i < dynamicVertices.size(); i++)
+		{
+			scenePass
+				.read(dynamicVertices[i], ResourceUsage::VertexRead)
+				.read(dynamicIndices[i], ResourceUsage::IndexRead);
+		}
+
+		if(_particleSystem)
+		{
+			const RenderResource particles = graph.importBuffer(
+				"Particles",
+				_particleSystem->getParticleBuffer(),
+				0,
+				_particleSystem->getParticleBufferSize()
+			);
+			const RenderResource particleOrder = graph.importBuffer(
+				"Particle order",
+				_particleSystem->getSortBuffer(),
+				0,
+				_particleSystem->getSortBufferSize()
+			);
+			const RenderResource particleCounters = graph.importBuffer(
+				"Particle counters",
+				_particleSystem->getCounterBuffer(),
+				0,
+				_particleSystem->getCounterBufferSize()
+			);
+
+			// The dispatches depend on each other, the pass places the barriers between them itself
+			graph.addPass(
+				"Particle simulation",
+				[this](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph&)
+				{
+					_particleSystem->recordSimulation(passCommandBuffer, _frameRingHandle, _uniformOffset);
+				}
+			)
+				.write(particles, ResourceUsage::StorageWriteCompute)
+				.write(particleOrder, ResourceUsage::StorageWriteCompute)
+				.write(particleCounters, ResourceUsage::StorageWriteCompute);
+
+			// Blended after the scene, into the same target
+			graph.addPass(
+				"Particles",
+				[this, backBuffer](const vk::raii::CommandBuffer& passCommandBuffer, const RenderGraph& passGraph)
+				{
+					_particleSystem->recordDraw(passCommandBuffer, passGraph.getImageView(backBuffer), _swapChainExtent);
+				}
+			)
+				.read(particles, ResourceUsage::StorageReadVertex)
+				.read(particleOrder, ResourceUsage::StorageReadVertex)
+				.read(particleCounters, ResourceUsage::IndirectRead)
+				.read(backBuffer, ResourceUsage::ColorAttachment)
+				.write(backBuffer, ResourceUsage::ColorAttachment);
+		}
+
+		graph.compile();
+		graph.execute(commandBuffer, _gpuProfiler.get());
+
+		_gpuProfiler->endScope(commandBuffer, frameScope);
+		commandBuffer.end();
+	}
+
+	void VulkanContext::recordScene(const vk::raii::CommandBuffer& commandBuffer, const vk::ImageView colorTarget) const
+	{
 		constexpr vk::ClearValue clearColor = vk::ClearColorValue(0.0f, 0.0f, 0.0f, 1.0f);
 
 		const vk::RenderingAttachmentInfo attachmentInfo(
-			_swapChainImageViews[imageIndex],
+			colorTarget,
 			vk::ImageLayout::eColorAttachmentOptimal,
 			{},
 			{},
@@ -674,8 +1252,13 @@ namespace Renderer
 
 		const vk::Rect2D renderArea({0, 0}, _swapChainExtent);
 
+		const auto objectCount = static_cast<uint32_t>(_objects.size());
+		const auto drawCount = objectCount +
+			static_cast<uint32_t>(_instanceBatches.size() + _dynamicGeometries.size());
+		const bool isParallel = !_isGpuDriven && _commandRecorder->getTaskCount(drawCount) > 1;
+
 		const vk::RenderingInfo renderingInfo(
-			{},
+			isParallel ? vk::RenderingFlagBits::eContentsSecondaryCommandBuffers : vk::RenderingFlags{},
 			renderArea,
 			1,
 			{},
@@ -683,152 +1266,336 @@ namespace Renderer
 			&attachmentInfo
 		);
 
-		const vk::Viewport viewport(
-			0.0f,
-			0.0f,
-			static_cast<float>(_swapChainExtent.width),
-			static_cast<float>(_swapChainExtent.height),
-			0.0f,
-			1.0f
-		);
+		commandBuffer.beginRendering(renderingInfo);
 
-		const vk::Rect2D scissors(
+		if(isParallel)
+		{
+			const vk::CommandBufferInheritanceRenderingInfo inheritanceRenderingInfo(
+				{},
+				0,
+				1,
+				&_swapChainImageFormat,
+				vk::Format::eUndefined,
+				vk::Format::eUndefined,
+				vk::SampleCountFlagBits::e1
+			);
+
+			const auto secondaryCommandBuffers = _commandRecorder->record(
+				_currentFrame,
+				inheritanceRenderingInfo,
+				drawCount,
+				[this](const vk::raii::CommandBuffer& secondary, const uint32_t begin, const uint32_t end)
+				{
+					recordDraws(secondary, begin, end);
+				}
+			);
+
+			commandBuffer.executeCommands(secondaryCommandBuffers);
+		}
+		else if(_isGpuDriven)
+		{
+			bindGraphicsState(commandBuffer);
+
+			commandBuffer.drawIndexedIndirectCount(
+				*_indirectBuffer,
+				static_cast<vk::DeviceSize>(_currentFrame) * objectCount * sizeof(vk::DrawIndexedIndirectCommand),
+				*_drawCountBuffer,
+				static_cast<vk::DeviceSize>(_currentFrame) * sizeof(uint32_t),
+				objectCount,
+				sizeof(vk::DrawIndexedIndirectCommand)
+			);
+
+			for(const auto& batch : _instanceBatches)
+			{
+				recordInstanceBatch(commandBuffer, batch);
+			}
+
+			for(const auto& geometry : _dynamicGeometries)
+			{
+				recordDynamicGeometry(commandBuffer, *geometry);
+			}
+		}
+		else
+		{
+			recordDraws(commandBuffer, 0, drawCount);
+		}
+
+		commandBuffer.endRendering();
+	}
+
+	void VulkanContext::bindGraphicsState(const vk::raii::CommandBuffer& commandBuffer) const
+	{
+		const vk::Viewport viewport(
+			0.0f,
+			0.0f,
+			static_cast<float>(_swapChainExtent.width),
+			static_cast<float>(_swapChainExtent.height),
+			0.0f,
+			1.0f
+		);
+
+		const vk::Rect2D scissors(
 			vk::Offset2D(0, 0),
 			_swapChainExtent
 		);
 
-		commandBuffer.beginRendering(renderingInfo);
-
 		commandBuffer.setViewport(0, viewport);
 		commandBuffer.setScissor(0, scissors);
 
 		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, _graphicsPipeline);
 
-		commandBuffer.bindVertexBuffers(0, *_vertexBuffer, {0});
-		commandBuffer.bindIndexBuffer(*_indexBuffer, 0, vk::IndexType::eUint16);
+		commandBuffer.bindVertexBuffers(0, {*_vertexBuffer, *_instanceBuffer}, {0, 0});
+		commandBuffer.bindIndexBuffer(*_indexBuffer, 0, _indexType);
 
-		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, _pipelineLayout, 0, *_descriptorSets[_currentFrame], nullptr);
+		_bindlessTable->bind(commandBuffer, vk::PipelineBindPoint::eGraphics, _pipelineLayout);
+		commandBuffer.pushConstants<ScenePushConstants>(
+			_pipelineLayout,
+			_scenePushConstantStages,
+			0,
+			makeScenePushConstants()
+		);
+	}
 
-		commandBuffer.drawIndexed(_vertexIndicies.size(), 1, 0, 0, 0);
+	void VulkanContext::recordDraws(
+		const vk::raii::CommandBuffer& commandBuffer, const uint32_t begin, const uint32_t end
+	) const
+	{
+		bindGraphicsState(commandBuffer);
 
-		commandBuffer.endRendering();
+		const auto objectCount = static_cast<uint32_t>(_objects.size());
 
-		transition_image_layout(
-			imageIndex,
-			vk::ImageLayout::eColorAttachmentOptimal,
-			vk::ImageLayout::ePresentSrcKHR,
-			vk::AccessFlagBits2::eColorAttachmentWrite,
-			{},
-			vk::PipelineStageFlagBits2::eColorAttachmentOutput,
-			vk::PipelineStageFlagBits2::eBottomOfPipe
+		// firstInstance carries the object index, same as the commands written by the cull pass
+		for(uint32_t i = begin; i < std::min(end, objectCount); i++)
+		{
+			const auto& draw = _drawCommands[_objects[i].drawCommand];
+			commandBuffer.drawIndexed(draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, i);
+		}
+
+		const auto batchEnd = objectCount + static_cast<uint32_t>(_instanceBatches.size());
+		for(uint32_t i = std::max(begin, objectCount); i < std::min(end, batchEnd); i++)
+		{
+			recordInstanceBatch(commandBuffer, _instanceBatches[i - objectCount]);
+		}
+
+		// Last, they rebind the geometry
+		for(uint32_t i = std::max(begin, batchEnd); i < end; i++)
+		{
+			recordDynamicGeometry(commandBuffer, *_dynamicGeometries[i - batchEnd]);
+		}
+	}
+
+	void VulkanContext::recordInstanceBatch(const vk::raii::CommandBuffer& commandBuffer, const InstanceBatch& batch) const
+	{
+		commandBuffer.pushConstants<glm::vec4>(
+			_pipelineLayout,
+			_scenePushConstantStages,
+			offsetof(ScenePushConstants, drawTint),
+			batch.tint
 		);
 
-		commandBuffer.end();
+		// Batch instances are stored after the one instance of every object
+		const auto& draw = _drawCommands[batch.drawCommand];
+		commandBuffer.drawIndexed(
+			draw.indexCount,
+			batch.instanceCount,
+			draw.firstIndex,
+			draw.vertexOffset,
+			static_cast<uint32_t>(_objects.size()) + batch.firstInstance
+		);
+	}
+
+	void VulkanContext::recordDynamicGeometry(
+		const vk::raii::CommandBuffer& commandBuffer, const DynamicGeometry& geometry
+	) const
+	{
+		if(geometry.getIndexCount() == 0) return;
+
+		// A batch before it may have left its tint
+		commandBuffer.pushConstants<glm::vec4>(
+			_pipelineLayout,
+			_scenePushConstantStages,
+			offsetof(ScenePushConstants, drawTint),
+			glm::vec4(1.0f)
+		);
+
+		commandBuffer.bindVertexBuffers(0, {geometry.getVertexBuffer(_currentFrame), *_instanceBuffer}, {0, 0});
+		commandBuffer.bindIndexBuffer(geometry.getIndexBuffer(_currentFrame), 0, geometry.getIndexType());
+
+		commandBuffer.drawIndexed(geometry.getIndexCount(), 1, 0, 0, _dynamicGeometryInstance);
+	}
+
+	void VulkanContext::recordCulling(const vk::raii::CommandBuffer& commandBuffer) const
+	{
+		const auto objectCount = static_cast<uint32_t>(_objects.size());
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, _cullPipeline);
+		_bindlessTable->bind(commandBuffer, vk::PipelineBindPoint::eCompute, _pipelineLayout);
+		commandBuffer.pushConstants<ScenePushConstants>(
+			_pipelineLayout,
+			_scenePushConstantStages,
+			0,
+			makeScenePushConstants()
+		);
+		commandBuffer.dispatch((objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	}
+
+	ScenePushConstants VulkanContext::makeScenePushConstants() const
+	{
+		const auto objectCount = static_cast<uint32_t>(_objects.size());
+
+		ScenePushConstants pushConstants{};
+		pushConstants.frameBuffer = _frameRingHandle;
+		pushConstants.uniformOffset = static_cast<uint32_t>(_uniformOffset);
+		pushConstants.objectBuffer = _objectBufferHandle;
+		pushConstants.meshDrawBuffer = _meshDrawBufferHandle;
+		pushConstants.drawCommandBuffer = _indirectBufferHandle;
+		pushConstants.drawCountBuffer = _drawCountBufferHandle;
+		pushConstants.objectCount = objectCount;
+		pushConstants.commandOffset = _currentFrame * objectCount;
+		pushConstants.countIndex = _currentFrame;
+		pushConstants.drawTint = glm::vec4(1.0f);
+
+		return pushConstants;
 	}
 
 	void VulkanContext::drawFrame()
 	{
-		while(vk::Result::eTimeout == _device.waitForFences(*_inFlightFences[_currentFrame], vk::True, UINT64_MAX))
+		waitForFrameSlot();
+
+		// Every frame the timeline has passed is done with its ring ranges (frame 0 retires with frame 1)
+		if(const uint64_t completedFrame = _frameTimeline.getCounterValue(); completedFrame > 0)
 		{
+			_frameRing->reclaim(completedFrame);
+			_bindlessTable->reclaim(completedFrame);
+			_textureStreamer->reclaim(completedFrame);
+			if(_shaderHotReload) _shaderHotReload->reclaim(completedFrame);
+			reclaimSwapChains(completedFrame);
 		}
 
-		auto [result, imageIndex] = _swapChain.acquireNextImage(
-			UINT64_MAX,
-			*_presentCompleteSemaphores[_semaphoreIndex],
-			VK_NULL_HANDLE
-		);
+		// Pipelines rebuilt in the background are swapped in before recording, nothing waits for the GPU
+		if(_shaderHotReload) _shaderHotReload->applyReloads(_frameNumber);
+
+		// Headless frames render into the offscreen image of their slot
+		uint32_t imageIndex = _currentFrame;
 
-		if(result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || _frameBufferResized)
+		if(!_isHeadless)
 		{
-			_frameBufferResized = false;
-			recreateSwapChain();
-			return;
-		}
+			vk::Result result;
+			try
+			{
+				std::tie(result, imageIndex) = _swapChain.acquireNextImage(
+					UINT64_MAX,
+					*_presentCompleteSemaphores[_currentFrame],
+					VK_NULL_HANDLE
+				);
+			}
+			catch(const vk::OutOfDateKHRError&)
+			{
+				// Nothing was acquired, this is the only case that can't render with the current swapchain
+				recreateSwapChain();
+				return;
+			}
 
+			if(result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR)
+				throw std::runtime_error(
+					"Failed to acquire swap chain image: result has value other than eSuccess or eSuboptimalKHR."
+				);
 
-		if(result != vk::Result::eSuccess)
-			throw std::runtime_error(
-				"Failed to acquire swap chain image: result has value other than eSuccess or eSuboptimalKHR."
-			);
+			// The acquired image is still rendered and presented, the swapchain is replaced afterward
+			if(result == vk::Result::eSuboptimalKHR || _frameBufferResized)
+			{
+				_frameBufferResized = false;
+				_isSwapChainStale = true;
+			}
+		}
 
-		_device.resetFences(*_inFlightFences[_currentFrame]);
+		_commandRecorder->beginFrame(_currentFrame);
 
-		updateUniformBuffer(_currentFrame);
+		updateUniformBuffer();
 
 		_commandBuffers[_currentFrame].reset();
 		recordCommandBuffer(_commandBuffers[_currentFrame], imageIndex);
 
-		constexpr vk::PipelineStageFlags waitDestinationStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+		// Uploads recorded since the last frame go out in one batch, the frame waits for them on the GPU
+		const UploadTicket uploadTicket = _uploadQueue->flush();
+		_uploadQueue->collect();
 
-		const vk::SubmitInfo submitInfo(
-			1,
-			&*_presentCompleteSemaphores[_semaphoreIndex],
-			&waitDestinationStageMask,
-			1,
-			&*_commandBuffers[_currentFrame],
-			1,
-			&*_renderFinishedSemaphores[imageIndex]
-		);
+		vk::SemaphoreSubmitInfo waitSemaphoreInfos[2] = {
+			{
+				_uploadQueue->getSemaphore(),
+				uploadTicket,
+				vk::PipelineStageFlagBits2::eAllCommands
+			}
+		};
+		vk::SemaphoreSubmitInfo signalSemaphoreInfos[2] = {
+			{
+				*_frameTimeline,
+				_frameNumber,
+				vk::PipelineStageFlagBits2::eAllCommands
+			}
+		};
+		uint32_t semaphoreCount = 1;
 
-		_graphics_queue.submit(submitInfo, *_inFlightFences[_currentFrame]);
+		if(!_isHeadless)
+		{
+			waitSemaphoreInfos[semaphoreCount] = vk::SemaphoreSubmitInfo(
+				*_presentCompleteSemaphores[_currentFrame],
+				0,
+				vk::PipelineStageFlagBits2::eColorAttachmentOutput
+			);
+			signalSemaphoreInfos[semaphoreCount] = vk::SemaphoreSubmitInfo(
+				*_renderFinishedSemaphores[imageIndex],
+				0,
+				vk::PipelineStageFlagBits2::eColorAttachmentOutput
+			);
+			semaphoreCount++;
+		}
 
-		const vk::PresentInfoKHR presentInfo(
-			1,
-			&*_renderFinishedSemaphores[imageIndex],
+		const vk::CommandBufferSubmitInfo commandBufferInfo(*_commandBuffers[_currentFrame]);
+
+		const vk::SubmitInfo2 submitInfo(
+			{},
+			semaphoreCount,
+			waitSemaphoreInfos,
 			1,
-			&*_swapChain,
-			&imageIndex
+			&commandBufferInfo,
+			semaphoreCount,
+			signalSemaphoreInfos
 		);
 
-		result = _present_queue.presentKHR(presentInfo);
-		if(result != vk::Result::eSuccess)
-			std::printf(
-				"Not successful present: presentKHR didn't return eSuccess bit."
+		_graphics_queue.submit2(submitInfo);
+
+		if(!_isHeadless)
+		{
+			vk::PresentInfoKHR presentInfo(
+				1,
+				&*_renderFinishedSemaphores[imageIndex],
+				1,
+				&*_swapChain,
+				&imageIndex
 			);
 
-		_semaphoreIndex = (_semaphoreIndex + 1) % _presentCompleteSemaphores.size();
-		_currentFrame = (_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-	}
+			const uint64_t presentId = _frameNumber;
+			const vk::PresentIdKHR presentIdInfo(1, &presentId);
+			if(_isPresentWaitSupported) presentInfo.setPNext(&presentIdInfo);
 
-	void VulkanContext::transition_image_layout(
-		const uint32_t imageIndex, const vk::ImageLayout oldLayout,
-		const vk::ImageLayout newLayout, const vk::AccessFlags2 srcAccessMask,
-		const vk::AccessFlags2 dstAccessMask,
-		const vk::PipelineStageFlags2 srcStageMask,
-		const vk::PipelineStageFlags2 dstStageMask
-	) const
-	{
-		constexpr vk::ImageSubresourceRange subresourceRange(
-			vk::ImageAspectFlagBits::eColor,
-			0,
-			1,
-			0,
-			1
-		);
+			try
+			{
+				if(_present_queue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR)
+					_isSwapChainStale = true;
+			}
+			catch(const vk::OutOfDateKHRError&)
+			{
+				_isSwapChainStale = true;
+			}
+		}
 
-		vk::ImageMemoryBarrier2 imageMemoryBarrier(
-			srcStageMask,
-			srcAccessMask,
-			dstStageMask,
-			dstAccessMask,
-			oldLayout,
-			newLayout,
-			VK_QUEUE_FAMILY_IGNORED,
-			VK_QUEUE_FAMILY_IGNORED,
-			_swapChainImages[imageIndex],
-			subresourceRange
-		);
+		_currentFrame = (_currentFrame + 1) % _framesInFlight;
 
-		vk::DependencyInfo dependencyInfo(
-			{},
-			{},
-			{},
-			{},
-			{},
-			1,
-			&imageMemoryBarrier
-		);
-		_commandBuffers[_currentFrame].pipelineBarrier2(dependencyInfo);
+		_frameNumber++;
+		_frameRing->beginFrame(_frameNumber);
+
+		if(_isSwapChainStale) recreateSwapChain();
 	}
 
 	void VulkanContext::recreateSwapChain()
@@ -842,35 +1609,40 @@ namespace Renderer
 			glfwWaitEvents();
 		}
 
-		_device.waitIdle();
+		_isSwapChainStale = false;
+		_firstSwapChainPresentId = _frameNumber;
 
-		_presentCompleteSemaphores.clear();
-		_renderFinishedSemaphores.clear();
+		// The last frame that used it was _frameNumber - 1, its present is only ordered before the next submit,
+		// so the swapchain lives until one more frame has completed
+		auto& retired = _retiredSwapChains.emplace_back();
+		retired.frameNumber = _frameNumber;
+		retired.swapChain = std::move(_swapChain);
+		retired.imageViews = std::move(_swapChainImageViews);
+		retired.presentCompleteSemaphores = std::move(_presentCompleteSemaphores);
+		retired.renderFinishedSemaphores = std::move(_renderFinishedSemaphores);
 
+		// Moved-from vectors are only valid, not empty
 		_swapChainImageViews.clear();
-		_swapChain = nullptr;
+		_presentCompleteSemaphores.clear();
+		_renderFinishedSemaphores.clear();
 
-		createSwapChain(_window);
+		createSwapChain(_window, *retired.swapChain);
 		createImageViews();
-		createSyncObjects();
+		createSwapChainSemaphores();
+
+		std::printf(
+			"Swapchain -> recreated at %ux%u, %s (%zu retired)\n",
+			_swapChainExtent.width,
+			_swapChainExtent.height,
+			vk::to_string(_presentMode).c_str(),
+			_retiredSwapChains.size()
+		);
 	}
 
-	uint32_t VulkanContext::findMemoryType(const uint32_t typeFilter, const vk::MemoryPropertyFlags properties) const
+	void VulkanContext::reclaimSwapChains(const uint64_t completedFrameNumber)
 	{
-		const vk::PhysicalDeviceMemoryProperties memProperties = _physical_device.getMemoryProperties();
-
-		for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-		{
-			if(
-				(typeFilter & (1 << i)) &&
-				(memProperties.memoryTypes[i].propertyFlags & properties) == properties
-			)
-			{
-				return i;
-			}
-		}
-
-		throw std::runtime_error("Failed to find suitable memory type: for loop didn't return index.");
+		while(!_retiredSwapChains.empty() && _retiredSwapChains.front().frameNumber <= completedFrameNumber)
+			_retiredSwapChains.pop_front();
 	}
 
 	void VulkanContext::framebufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -882,178 +1654,432 @@ namespace Renderer
 
 	void VulkanContext::createVertexBuffer()
 	{
-		vk::DeviceSize bufferSize = sizeof(_vertices[0]) * _vertices.size();
+		// A mesh cooked in the packed layout goes from its mapping straight into staging memory,
+		// full precision vertices are packed first
+		std::vector<SceneVertexLayout::Packed> packedVertices;
+		const void* vertexData;
+		vk::DeviceSize bufferSize;
 
-		const vk::BufferCreateInfo stagingInfo(
-			{},
-			bufferSize,
-			vk::BufferUsageFlagBits::eTransferSrc,
-			vk::SharingMode::eExclusive
-		);
-		vk::raii::Buffer stagingBuffer(_device, stagingInfo);
-		const vk::MemoryRequirements memRequirementsStaging = stagingBuffer.getMemoryRequirements();
-		const vk::MemoryAllocateInfo memoryAllocateInfoStaging(
-			memRequirementsStaging.size,
-			findMemoryType(
-				memRequirementsStaging.memoryTypeBits,
-				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
-			)
-		);
-		const vk::raii::DeviceMemory stagingBufferMemory(_device, memoryAllocateInfoStaging);
+		if(_mesh && _mesh->header->vertexStride == SceneVertexLayout::STRIDE)
+		{
+			vertexData = _mesh->vertices.data();
+			bufferSize = _mesh->vertices.size();
+		}
+		else
+		{
+			const std::span<const Vertex> vertices = _mesh
+				? std::span(reinterpret_cast<const Vertex*>(_mesh->vertices.data()), _mesh->header->vertexCount)
+				: std::span<const Vertex>(_vertices);
 
-		stagingBuffer.bindMemory(stagingBufferMemory, 0);
-		void* dataStaging = stagingBufferMemory.mapMemory(0, stagingInfo.size);
-		memcpy(dataStaging, _vertices.data(), stagingInfo.size);
-		stagingBufferMemory.unmapMemory();
+			packedVertices.reserve(vertices.size());
+			for(const auto& vertex : vertices)
+				packedVertices.push_back(vertex.pack());
 
-		const vk::BufferCreateInfo bufferInfo(
-			{},
+			vertexData = packedVertices.data();
+			bufferSize = sizeof(SceneVertexLayout::Packed) * packedVertices.size();
+		}
+
+		createBuffer(
 			bufferSize,
 			vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-			vk::SharingMode::eExclusive
-		);
-		_vertexBuffer = vk::raii::Buffer(_device, bufferInfo);
-
-		const vk::MemoryRequirements memRequirements = _vertexBuffer.getMemoryRequirements();
-		const vk::MemoryAllocateInfo memoryAllocateInfo(
-			memRequirements.size,
-			findMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal)
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			_vertexBuffer,
+			_vertexBufferAllocation
 		);
-		_vertexBufferMemory = vk::raii::DeviceMemory(_device, memoryAllocateInfo);
-
-		_vertexBuffer.bindMemory(*_vertexBufferMemory, 0);
 
-		copyBuffer(stagingBuffer, _vertexBuffer, stagingInfo.size);
+		uploadBuffer(vertexData, bufferSize, _vertexBuffer);
 	}
 
 	void VulkanContext::createBuffer(
 		const vk::DeviceSize size, const vk::BufferUsageFlags usage, const vk::MemoryPropertyFlags properties,
-		vk::raii::Buffer& buffer, vk::raii::DeviceMemory& bufferMemory
+		vk::raii::Buffer& buffer, Allocation& allocation
 	) const
 	{
+		const uint32_t queueFamilyIndices[] = {_graphics_family_index, _transfer_family_index};
+
+		// Copies from a separate transfer family would otherwise need queue family ownership transfers
+		const bool isSharedWithTransfer =
+			(usage & vk::BufferUsageFlagBits::eTransferDst) && _transfer_family_index != _graphics_family_index;
+
 		const vk::BufferCreateInfo bufferInfo(
 			{},
 			size,
 			usage,
-			vk::SharingMode::eExclusive
+			isSharedWithTransfer ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+			isSharedWithTransfer ? 2u : 0u,
+			isSharedWithTransfer ? queueFamilyIndices : nullptr
 		);
 		buffer = vk::raii::Buffer(_device, bufferInfo);
 
-		const vk::MemoryRequirements memRequirements = buffer.getMemoryRequirements();
-		const vk::MemoryAllocateInfo allocInfo(
-			memRequirements.size,
-			findMemoryType(memRequirements.memoryTypeBits, properties)
-		);
+		allocation = _allocator->allocateForBuffer(buffer, properties);
+	}
 
-		bufferMemory = vk::raii::DeviceMemory(_device, allocInfo);
-		buffer.bindMemory(*bufferMemory, 0);
+	SceneVertexLayout::Packed Vertex::pack() const
+	{
+		SceneVertexLayout::Packed packed;
+		packed.set<0>(pos);
+		packed.set<1>(glm::vec4(color, 1.0f));
+		return packed;
 	}
 
-	vk::VertexInputBindingDescription Vertex::getBindingDescription()
+	void VulkanContext::fillVertices(const std::vector<Vertex>& inVert, const std::vector<uint32_t>& indicies)
 	{
-		return {
-			0,
-			sizeof(Vertex),
-			vk::VertexInputRate::eVertex
-		};
+		_vertices = inVert;
+		_vertexIndicies = indicies;
+		_mesh.reset();
+		_drawBounds.clear();
+
+		_drawCommands = {{static_cast<uint32_t>(indicies.size()), 0, 0}};
+		_objects = {{glm::mat4(1.0f), 0}};
 	}
 
-	std::array<vk::VertexInputAttributeDescription, 2> Vertex::getAttributeDescriptions()
+	void VulkanContext::setObjects(const std::vector<ObjectInstance>& objects)
 	{
-		return {
-			vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, pos)),
-			vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color))
-		};
+		_objects = objects;
 	}
 
-	void VulkanContext::fillVertices(const std::vector<Vertex>& inVert, const std::vector<uint16_t>& indicies)
+	uint32_t VulkanContext::addInstanceBatch(
+		const uint32_t drawCommand, const std::vector<InstanceData>& instances, const glm::vec4& tint
+	)
 	{
-		_vertices = inVert;
-		_vertexIndicies = indicies;
+		_instanceBatches.push_back({
+			drawCommand,
+			static_cast<uint32_t>(_batchInstances.size()),
+			static_cast<uint32_t>(instances.size()),
+			tint
+		});
+		_batchInstances.insert(_batchInstances.end(), instances.begin(), instances.end());
+
+		return static_cast<uint32_t>(_instanceBatches.size() - 1);
+	}
+
+	void VulkanContext::setDrawCommands(const std::vector<DrawCommand>& drawCommands)
+	{
+		_drawCommands = drawCommands;
+		_drawBounds.clear();
 	}
 
-	void VulkanContext::copyBuffer(vk::raii::Buffer& srcBuffer, vk::raii::Buffer& dstBuffer, vk::DeviceSize size) const
+	void VulkanContext::setMesh(std::shared_ptr<const Assets::AssetType::Mesh> mesh)
 	{
-		const vk::CommandBufferAllocateInfo allocInfo(_commandPool, vk::CommandBufferLevel::ePrimary, 1);
-		const vk::raii::CommandBuffer commandCopyBuffer = std::move(_device.allocateCommandBuffers(allocInfo).front());
+		if(mesh->header->vertexStride != sizeof(Vertex) && mesh->header->vertexStride != SceneVertexLayout::STRIDE)
+			throw std::runtime_error("Failed to set mesh: its vertex stride matches neither Vertex nor SceneVertexLayout.");
 
-		commandCopyBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
-		commandCopyBuffer.copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy(0, 0, size));
-		commandCopyBuffer.end();
+		_vertices.clear();
+		_vertexIndicies.clear();
+		_drawCommands.clear();
+		_drawBounds.clear();
+		_objects.clear();
 
-		_graphics_queue.submit(vk::SubmitInfo({}, {}, {}, 1, &*commandCopyBuffer), nullptr);
-		_graphics_queue.waitIdle();
+		// The cooked bounds are used as they are, the geometry is never read on the CPU
+		for(const auto& submesh : mesh->submeshes)
+		{
+			_drawCommands.push_back({submesh.indexCount, submesh.firstIndex, submesh.vertexOffset});
+			_drawBounds.emplace_back(
+				submesh.boundingSphere[0],
+				submesh.boundingSphere[1],
+				submesh.boundingSphere[2],
+				submesh.boundingSphere[3]
+			);
+			_objects.push_back({glm::mat4(1.0f), static_cast<uint32_t>(_drawCommands.size() - 1)});
+		}
+
+		_mesh = std::move(mesh);
 	}
 
-	void VulkanContext::createIndexBuffer()
+	void VulkanContext::setFramesInFlight(const uint32_t framesInFlight)
 	{
-		vk::DeviceSize bufferSize = sizeof(_vertexIndicies[0]) * _vertexIndicies.size();
+		// The command buffers, acquire semaphores and per-frame regions are all sized once with this count
+		if(*_device)
+			throw std::runtime_error("Failed to set frames in flight: the context is already initialized.");
 
-		vk::raii::Buffer stagingBuffer({});
-		vk::raii::DeviceMemory stagingBufferMemory({});
-		createBuffer(
-			bufferSize,
-			vk::BufferUsageFlagBits::eTransferSrc,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-			stagingBuffer,
-			stagingBufferMemory
+		_framesInFlight = std::clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+	}
+
+	uint32_t VulkanContext::getFramesInFlight() const
+	{
+		return _framesInFlight;
+	}
+
+	GpuProfiler& VulkanContext::getGpuProfiler() const
+	{
+		return *_gpuProfiler;
+	}
+
+	TextureStreamer& VulkanContext::getTextureStreamer() const
+	{
+		return *_textureStreamer;
+	}
+
+	float VulkanContext::getProjectedSize(const glm::vec3& center, const float radius) const
+	{
+		const float focal = std::abs(_cameraProjection[1][1]);
+		if(focal == 0.0f) return 0.0f;
+
+		// The camera looks down -z, a sphere that reaches the near side covers the whole screen
+		const float depth = -(_cameraView * glm::vec4(center, 1.0f)).z;
+		if(depth <= radius)
+			return static_cast<float>(std::max(_swapChainExtent.width, _swapChainExtent.height));
+
+		// proj[1][1] is cot(fov / 2): the sphere spans 2 * radius * focal / depth of the [-1, 1] viewport height
+		return radius * focal / depth * static_cast<float>(_swapChainExtent.height);
+	}
+
+	DynamicGeometry& VulkanContext::createDynamicGeometry(const uint32_t vertexCapacity, const uint32_t indexCapacity)
+	{
+		if(!_frameRing)
+			throw std::runtime_error("Failed to create dynamic geometry: the renderer isn't initialized.");
+
+		return *_dynamicGeometries.emplace_back(std::make_unique<DynamicGeometry>(
+			_device,
+			*_allocator,
+			*_frameRing,
+			_framesInFlight,
+			SceneVertexLayout::STRIDE,
+			vertexCapacity,
+			indexCapacity
+		));
+	}
+
+	ParticleSystem& VulkanContext::createParticleSystem(const uint32_t capacity)
+	{
+		if(!_shaderLibrary)
+			throw std::runtime_error("Failed to create particle system: the renderer isn't initialized.");
+
+		if(_particleSystem)
+			throw std::runtime_error("Failed to create particle system: the context already has one.");
+
+		_particleSystem = std::make_unique<ParticleSystem>(
+			_device,
+			*_allocator,
+			*_frameRing,
+			*_bindlessTable,
+			*_shaderLibrary,
+			*_pipelineCache,
+			_swapChainImageFormat,
+			capacity
 		);
 
-		void* data = stagingBufferMemory.mapMemory(0, bufferSize);
-		memcpy(data, _vertexIndicies.data(), (size_t)bufferSize);
-		stagingBufferMemory.unmapMemory();
+		return *_particleSystem;
+	}
+
+	void VulkanContext::enableShaderHotReload()
+	{
+		if(_shaderHotReload) return;
+
+		// The Slang sources are only found when running from the build tree
+#ifdef ENDURA_SHADER_SOURCE_DIR
+		constexpr auto sourceDirectory = ENDURA_SHADER_SOURCE_DIR;
+#else
+		constexpr auto sourceDirectory = "";
+#endif
+
+		_shaderHotReload = std::make_unique<ShaderHotReload>("Shaders", sourceDirectory);
+
+		_shaderHotReload->addShader("shader", {"vertMain", "fragMain"});
+		_shaderHotReload->addPipeline({"shader"}, _graphicsPipeline, [this] { return buildGraphicsPipeline(); });
+
+		if(_isGpuDriven)
+		{
+			_shaderHotReload->addShader("cull", {"cullMain"});
+			_shaderHotReload->addPipeline({"cull"}, _cullPipeline, [this] { return buildCullPipeline(); });
+		}
+
+		if(_particleSystem) _particleSystem->addToHotReload(*_shaderHotReload);
+
+		_shaderHotReload->start();
+	}
+
+	void VulkanContext::setPresentPolicy(const PresentPolicy policy)
+	{
+		if(_presentPolicy == policy) return;
+
+		_presentPolicy = policy;
+		if(*_swapChain) _isSwapChainStale = true;
+	}
+
+	vk::PresentModeKHR VulkanContext::getPresentMode() const
+	{
+		return _presentMode;
+	}
+
+	bool VulkanContext::isPresentWaitSupported() const
+	{
+		return _isPresentWaitSupported;
+	}
+
+	void VulkanContext::waitForPresent()
+	{
+		// The last submitted frame is _frameNumber - 1, the one before it leaves one frame queued
+		if(!_isPresentWaitSupported || _frameNumber < _firstSwapChainPresentId + 2) return;
+
+		try
+		{
+			// Bounded: a present that failed never completes its id
+			(void)_swapChain.waitForPresent(_frameNumber - 2, PRESENT_WAIT_TIMEOUT_NS);
+		}
+		catch(const vk::OutOfDateKHRError&)
+		{
+			_isSwapChainStale = true;
+		}
+	}
+
+	FramePacingStats VulkanContext::getFramePacingStats() const
+	{
+		return _framePacingStats;
+	}
+
+	void VulkanContext::resetFramePacingStats()
+	{
+		_framePacingStats = {};
+	}
+
+	void VulkanContext::createIndexBuffer()
+	{
+		// Cooked meshes already store the smallest size, given indices are narrowed here when they fit
+		std::vector<uint16_t> narrowedIndices;
+		const void* indexData;
+		vk::DeviceSize bufferSize;
+
+		if(_mesh)
+		{
+			_indexType = _mesh->header->indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+			indexData = _mesh->indices.data();
+			bufferSize = _mesh->indices.size();
+		}
+		else if(std::ranges::all_of(_vertexIndicies, [](const uint32_t index) { return index <= UINT16_MAX; }))
+		{
+			_indexType = vk::IndexType::eUint16;
+			narrowedIndices.assign(_vertexIndicies.begin(), _vertexIndicies.end());
+			indexData = narrowedIndices.data();
+			bufferSize = sizeof(uint16_t) * narrowedIndices.size();
+		}
+		else
+		{
+			_indexType = vk::IndexType::eUint32;
+			indexData = _vertexIndicies.data();
+			bufferSize = sizeof(uint32_t) * _vertexIndicies.size();
+		}
 
 		createBuffer(
 			bufferSize,
 			vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
 			vk::MemoryPropertyFlagBits::eDeviceLocal,
 			_indexBuffer,
-			_indexBufferMemory
+			_indexBufferAllocation
 		);
 
-		copyBuffer(stagingBuffer, _indexBuffer, bufferSize);
+		uploadBuffer(indexData, bufferSize, _indexBuffer);
 	}
 
-	void VulkanContext::createDescriptorSetLayout()
+	void VulkanContext::createBindlessTable()
 	{
-		constexpr vk::DescriptorSetLayoutBinding uboLayoutBinding(
-			0,
-			vk::DescriptorType::eUniformBuffer,
-			1,
-			vk::ShaderStageFlagBits::eVertex,
-			nullptr
-		);
-
-		const vk::DescriptorSetLayoutCreateInfo layoutInfo({}, 1, &uboLayoutBinding);
-
-		_descriptorSetLayout = vk::raii::DescriptorSetLayout(_device, layoutInfo);
+		_bindlessTable = std::make_unique<BindlessTable>(_physical_device, _device);
 	}
 
-	void VulkanContext::createUniformBuffers()
+	void VulkanContext::createSceneBuffers()
 	{
-		_uniformBuffers.clear();
-		_uniformBuffersMemory.clear();
-		_uniformBuffersMapped.clear();
+		if(_objects.empty())
+			throw std::runtime_error("Failed to create scene buffers: there are no objects to draw.");
 
-		for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		std::vector<GpuObjectData> objectData;
+		objectData.reserve(_objects.size());
+		for(const auto& object : _objects)
 		{
-			constexpr vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
-			vk::raii::Buffer buffer({});
-			vk::raii::DeviceMemory bufferMem({});
-			createBuffer(
-				bufferSize,
-				vk::BufferUsageFlagBits::eUniformBuffer,
-				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-				buffer,
-				bufferMem
-			);
-			_uniformBuffers.emplace_back(std::move(buffer));
-			_uniformBuffersMemory.emplace_back(std::move(bufferMem));
-			_uniformBuffersMapped.emplace_back(_uniformBuffersMemory[i].mapMemory(0, bufferSize));
+			objectData.push_back({object.model, object.drawCommand, {}});
+		}
+
+		std::vector<InstanceData> instances;
+		instances.reserve(_objects.size() + _batchInstances.size() + 1);
+		for(const auto& object : _objects)
+		{
+			instances.push_back({object.model, object.color});
 		}
+		instances.insert(instances.end(), _batchInstances.begin(), _batchInstances.end());
+
+		_dynamicGeometryInstance = static_cast<uint32_t>(instances.size());
+		instances.push_back({glm::mat4(1.0f), glm::vec4(1.0f)});
+
+		// Bounding spheres are computed once from the geometry (or cooked), the cull pass only transforms them
+		std::vector<GpuMeshDraw> meshDraws;
+		meshDraws.reserve(_drawCommands.size());
+		for(const auto& draw : _drawCommands)
+		{
+			if(_drawBounds.size() == _drawCommands.size())
+			{
+				const glm::vec4& bounds = _drawBounds[meshDraws.size()];
+				meshDraws.push_back({draw.indexCount, draw.firstIndex, draw.vertexOffset, 0, bounds});
+				continue;
+			}
+
+			glm::vec3 minimum(std::numeric_limits<float>::max());
+			glm::vec3 maximum(std::numeric_limits<float>::lowest());
+			for(uint32_t i = 0; i < draw.indexCount; i++)
+			{
+				const auto& vertex = _vertices[_vertexIndicies[draw.firstIndex + i] + draw.vertexOffset];
+				minimum = glm::min(minimum, glm::vec3(vertex.pos, 0.0f));
+				maximum = glm::max(maximum, glm::vec3(vertex.pos, 0.0f));
+			}
+
+			const glm::vec3 center = (minimum + maximum) * 0.5f;
+			float radius = 0.0f;
+			for(uint32_t i = 0; i < draw.indexCount; i++)
+			{
+				const auto& vertex = _vertices[_vertexIndicies[draw.firstIndex + i] + draw.vertexOffset];
+				radius = std::max(radius, glm::length(glm::vec3(vertex.pos, 0.0f) - center));
+			}
+
+			meshDraws.push_back({draw.indexCount, draw.firstIndex, draw.vertexOffset, 0, glm::vec4(center, radius)});
+		}
+
+		const vk::DeviceSize objectBufferSize = sizeof(GpuObjectData) * objectData.size();
+		createBuffer(
+			objectBufferSize,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			_objectBuffer,
+			_objectBufferAllocation
+		);
+		uploadBuffer(objectData.data(), objectBufferSize, _objectBuffer);
+
+		const vk::DeviceSize instanceBufferSize = sizeof(InstanceData) * instances.size();
+		createBuffer(
+			instanceBufferSize,
+			vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			_instanceBuffer,
+			_instanceBufferAllocation
+		);
+		uploadBuffer(instances.data(), instanceBufferSize, _instanceBuffer);
+
+		const vk::DeviceSize meshDrawBufferSize = sizeof(GpuMeshDraw) * meshDraws.size();
+		createBuffer(
+			meshDrawBufferSize,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			_meshDrawBuffer,
+			_meshDrawBufferAllocation
+		);
+		uploadBuffer(meshDraws.data(), meshDrawBufferSize, _meshDrawBuffer);
+
+		createBuffer(
+			sizeof(vk::DrawIndexedIndirectCommand) * _objects.size() * _framesInFlight,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			_indirectBuffer,
+			_indirectBufferAllocation
+		);
+
+		createBuffer(
+			sizeof(uint32_t) * _framesInFlight,
+			vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+			vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal,
+			_drawCountBuffer,
+			_drawCountBufferAllocation
+		);
 	}
 
-	void VulkanContext::updateUniformBuffer(uint32_t currentImage) const
+	void VulkanContext::updateUniformBuffer()
 	{
 		static auto startTime = std::chrono::high_resolution_clock::now();
 
@@ -1072,55 +2098,64 @@ namespace Renderer
 
 		ubo.proj[1][1] *= -1; // Y flip
 
-		memcpy(_uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
-	}
-
+		// Gribb-Hartmann: planes are sums/differences of the rows of the view-projection matrix
+		const glm::mat4 viewProj = ubo.proj * ubo.view;
+		const glm::vec4 rows[4] = {
+			{viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]},
+			{viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]},
+			{viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]},
+			{viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]}
+		};
 
-	void VulkanContext::createDescriptorPool()
-	{
-		constexpr vk::DescriptorPoolSize poolSize(vk::DescriptorType::eUniformBuffer, MAX_FRAMES_IN_FLIGHT);
+		const glm::vec4 planes[6] = {
+			rows[3] + rows[0],
+			rows[3] - rows[0],
+			rows[3] + rows[1],
+			rows[3] - rows[1],
+			rows[2], // Vulkan depth range starts at 0
+			rows[3] - rows[2]
+		};
+		for(uint32_t i = 0; i < 6; i++)
+		{
+			ubo.frustumPlanes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+		}
 
-		const vk::DescriptorPoolCreateInfo poolInfo(
-			vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-			MAX_FRAMES_IN_FLIGHT,
-			1,
-			&poolSize
-		);
+		const auto uniformRange = _frameRing->write(&ubo, sizeof(ubo), _minUniformAlignment);
+		if(!uniformRange)
+			throw std::runtime_error("Failed to write uniform data: frame ring buffer is full.");
 
-		_descriptorPool = vk::raii::DescriptorPool(_device, poolInfo);
+		_uniformOffset = uniformRange.offset;
+		_cameraView = ubo.view;
+		_cameraProjection = ubo.proj;
 	}
 
-	void VulkanContext::createDescriptorSets()
+
+	void VulkanContext::createTextureStreamer()
 	{
-		const std::vector<vk::DescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, *_descriptorSetLayout);
-		const vk::DescriptorSetAllocateInfo allocInfo(
-			_descriptorPool,
-			static_cast<uint32_t>(layouts.size()),
-			layouts.data()
-		);
+		_textureStreamer = std::make_unique<TextureStreamer>(_device, *_allocator, *_frameRing, *_bindlessTable);
+	}
 
-		_descriptorSets.clear();
-		_descriptorSets = _device.allocateDescriptorSets(allocInfo);
+	void VulkanContext::registerBindlessResources()
+	{
+		// Written once, the frames only push the handles (and the ring offset of their uniform data)
+		_frameRingHandle = _bindlessTable->addStorageBuffer(_frameRing->getBuffer());
+		_objectBufferHandle = _bindlessTable->addStorageBuffer(_objectBuffer);
+		_meshDrawBufferHandle = _bindlessTable->addStorageBuffer(_meshDrawBuffer);
+		_indirectBufferHandle = _bindlessTable->addStorageBuffer(_indirectBuffer);
+		_drawCountBufferHandle = _bindlessTable->addStorageBuffer(_drawCountBuffer);
+	}
 
-		for(size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	void VulkanContext::uploadBuffer(
+		const void* data, const vk::DeviceSize size, const vk::Buffer dstBuffer, const vk::DeviceSize dstOffset
+	)
+	{
+		// The frame that consumes the ring range waits for the upload, so the range retires with the frame
+		if(const auto staging = _frameRing->write(data, size))
 		{
-			vk::DescriptorBufferInfo bufferInfo(
-				_uniformBuffers[i],
-				0,
-				sizeof(UniformBufferObject)
-			);
-			vk::WriteDescriptorSet descriptorWrite(
-				_descriptorSets[i],
-				0,
-				0,
-				1,
-				vk::DescriptorType::eUniformBuffer,
-				{},
-				&bufferInfo
-			);
-
-			_device.updateDescriptorSets(descriptorWrite, {});
+			_uploadQueue->enqueueCopy(staging.buffer, staging.offset, size, dstBuffer, dstOffset);
+			return;
 		}
 
+		_uploadQueue->enqueue(data, size, dstBuffer, dstOffset);
 	}
 }
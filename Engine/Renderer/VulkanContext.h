@@ -6,16 +6,46 @@
 #include <vulkan/vulkan_raii.hpp>
 #include <glm/glm.hpp>
 
+#include <deque>
+
+#include <AssetManager.h>
+
+#include "BindlessTable.h"
+#include "DynamicGeometry.h"
+#include "GpuProfiler.h"
+#include "MemoryAllocator.h"
+#include "ParallelCommandRecorder.h"
+#include "ParticleSystem.h"
+#include "PipelineCache.h"
+#include "RenderGraph.h"
+#include "RingBuffer.h"
+#include "ShaderHotReload.h"
+#include "ShaderLibrary.h"
+#include "TextureStreamer.h"
+#include "UploadQueue.h"
+#include "VertexLayout.h"
+
 #ifdef NDEBUG
 constexpr bool enableValidationLayers = false;
 #else
 constexpr bool enableValidationLayers = true;
 #endif
 
-constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+// Upper bound of VulkanContext::setFramesInFlight
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
 
 constexpr int IMAGE_ARRAY_LAYERS = 1;
 
+constexpr auto PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// Longest VulkanContext::waitForPresent blocks, a frame that was never presented doesn't hang the loop
+constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;
+
+// Color format of the offscreen targets, supported as attachment by every implementation (lavapipe included)
+constexpr auto HEADLESS_IMAGE_FORMAT = vk::Format::eR8G8B8A8Unorm;
+
 inline std::vector validationLayers = {
 	"VK_LAYER_KHRONOS_validation",
 
@@ -32,13 +62,49 @@ inline std::vector deviceExtensions = {
 
 namespace Renderer
 {
+	/**
+	 * Per-instance vertex data (binding 1), fetched at firstInstance + instance index of the draw
+	 */
+	struct InstanceData
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+	};
+
+	/**
+	 * Vertex as the GPU reads it (binding 0): half float position and 8 bit color, 8 bytes per vertex
+	 */
+	using SceneVertexLayout = VertexLayout<
+		0, vk::VertexInputRate::eVertex,
+		VertexAttribute<0, Half2Format>,
+		VertexAttribute<1, Unorm8x4Format>
+	>;
+
+	/**
+	 * InstanceData as the GPU reads it (binding 1), the model matrix takes one location per column
+	 */
+	using InstanceLayout = VertexLayout<
+		1, vk::VertexInputRate::eInstance,
+		VertexAttribute<2, Float4Format>,
+		VertexAttribute<3, Float4Format>,
+		VertexAttribute<4, Float4Format>,
+		VertexAttribute<5, Float4Format>,
+		VertexAttribute<6, Float4Format>
+	>;
+
+	static_assert(InstanceLayout::STRIDE == sizeof(InstanceData));
+
+	using SceneVertexInput = VertexInputDescription<SceneVertexLayout, InstanceLayout>;
+
+	/**
+	 * Full precision vertex the geometry is given (and cooked) in, packed into SceneVertexLayout on upload
+	 */
 	struct Vertex
 	{
 		glm::vec2 pos;
 		glm::vec3 color;
 
-		static vk::VertexInputBindingDescription getBindingDescription();
-		static std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions();
+		[[nodiscard]] SceneVertexLayout::Packed pack() const;
 	};
 
 	struct UniformBufferObject
@@ -46,6 +112,7 @@ namespace Renderer
 		glm::mat4 model;
 		glm::mat4 view;
 		glm::mat4 proj;
+		glm::vec4 frustumPlanes[6];
 	};
 
 	struct TimeUBO
@@ -53,6 +120,121 @@ namespace Renderer
 		float time;
 	};
 
+	/**
+	 * Range of the shared vertex/index buffers drawn with one drawIndexed
+	 */
+	struct DrawCommand
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+	};
+
+	/**
+	 * Object placed in the scene, every object is one draw of its DrawCommand
+	 */
+	struct ObjectInstance
+	{
+		glm::mat4 model;
+		uint32_t drawCommand;
+		glm::vec4 color = glm::vec4(1.0f);
+	};
+
+	/**
+	 * Copies of one DrawCommand drawn with a single instanced draw (not culled)
+	 */
+	struct InstanceBatch
+	{
+		uint32_t drawCommand;
+		// Range of the batch in the instance buffer, after the objects
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+		glm::vec4 tint;
+	};
+
+	/**
+	 * ObjectData of cull.slang (std430)
+	 */
+	struct GpuObjectData
+	{
+		glm::mat4 model;
+		uint32_t drawIndex;
+		uint32_t padding[3];
+	};
+
+	/**
+	 * MeshDraw of cull.slang (std430)
+	 */
+	struct GpuMeshDraw
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t padding;
+		glm::vec4 boundingSphere;
+	};
+
+	/**
+	 * SceneConstants of cull.slang/shader.slang, bindless handles of everything the scene reads
+	 */
+	struct ScenePushConstants
+	{
+		BindlessHandle frameBuffer;
+		uint32_t uniformOffset;
+		BindlessHandle objectBuffer;
+		BindlessHandle meshDrawBuffer;
+		BindlessHandle drawCommandBuffer;
+		BindlessHandle drawCountBuffer;
+		uint32_t objectCount;
+		uint32_t commandOffset;
+		uint32_t countIndex;
+		uint32_t padding[3];
+		// Per-draw parameter, pushed again for every instance batch
+		glm::vec4 drawTint;
+	};
+
+	constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+	/**
+	 * Time the CPU spent blocked on the GPU before recording, accumulated since the last reset
+	 */
+	struct FramePacingStats
+	{
+		uint64_t frameCount = 0;
+		double totalWaitMs = 0.0;
+		double maxWaitMs = 0.0;
+	};
+
+	/**
+	 * What the present mode is picked for, a mode the surface doesn't support falls back toward FIFO
+	 * (Immediate -> Mailbox -> FIFO, FIFO relaxed -> FIFO)
+	 */
+	enum class PresentPolicy
+	{
+		// Lowest latency, tears
+		Immediate,
+		// Low latency without tearing, renders frames that are never shown
+		Mailbox,
+		// Capped at the refresh rate, lowest power
+		Fifo,
+		// FIFO that tears instead of waiting for the next refresh when a frame is late
+		FifoRelaxed
+	};
+
+	/**
+	 * Swapchain replaced by a recreation with everything created for its images,
+	 * destroyed once the frame numbered frameNumber has completed
+	 */
+	struct RetiredSwapChain
+	{
+		uint64_t frameNumber = 0;
+
+		vk::raii::SwapchainKHR swapChain = VK_NULL_HANDLE;
+		std::vector<vk::raii::ImageView> imageViews;
+		std::vector<vk::raii::Semaphore> presentCompleteSemaphores;
+		std::vector<vk::raii::Semaphore> renderFinishedSemaphores;
+	};
+
 	class VulkanContext
 	{
 	public:
@@ -64,6 +246,21 @@ namespace Renderer
 		 */
 		void InitializeVulkan(GLFWwindow* window);
 
+		/**
+		 * Initializes the renderer without window, surface and swapchain
+		 * Frames are rendered through the same path into offscreen images and never presented.
+		 *
+		 * @param extent Size of the offscreen images
+		 */
+		void InitializeHeadless(vk::Extent2D extent);
+
+		[[nodiscard]] bool isHeadless() const;
+
+		/**
+		 * Blocks until the GPU has finished every submitted frame
+		 */
+		void waitIdle() const;
+
 		/**
 		 * Cleans every resource that requires manual destruction for successful exit
 		 */
@@ -74,7 +271,126 @@ namespace Renderer
 		 */
 		void drawFrame();
 
-		void fillVertices(const std::vector<Vertex>& inVert, const std::vector<uint16_t>& indicies);
+		/**
+		 * Replaces the geometry, the index buffer is 16 bit whenever every index fits
+		 */
+		void fillVertices(const std::vector<Vertex>& inVert, const std::vector<uint32_t>& indicies);
+
+		/**
+		 * Replaces the draws recorded every frame (fillVertices sets one draw covering every index)
+		 *
+		 * @param drawCommands Ranges of the geometry passed to fillVertices
+		 */
+		void setDrawCommands(const std::vector<DrawCommand>& drawCommands);
+
+		/**
+		 * Replaces the geometry with a cooked mesh: one draw command and one object per submesh
+		 * Only valid before InitializeVulkan, the streams are copied from the mapping into staging memory
+		 * during initialization and the asset is released afterwards.
+		 *
+		 * @param mesh Mesh with the Vertex (packed on upload) or SceneVertexLayout layout
+		 */
+		void setMesh(std::shared_ptr<const Assets::AssetType::Mesh> mesh);
+
+		/**
+		 * Replaces the objects of the scene (fillVertices places one object with identity transform)
+		 * Only valid before InitializeVulkan, the object buffer is static for now.
+		 *
+		 * @param objects Objects referencing the draw commands
+		 */
+		void setObjects(const std::vector<ObjectInstance>& objects);
+
+		/**
+		 * Adds copies of a draw command that are drawn with one draw call
+		 * Only valid before InitializeVulkan, the instances are uploaded with the scene buffers.
+		 *
+		 * @param drawCommand Range of the geometry passed to fillVertices
+		 * @param instances Transform and color of every copy
+		 * @param tint Color every instance of the batch is multiplied with
+		 * @return Index of the batch
+		 */
+		uint32_t addInstanceBatch(
+			uint32_t drawCommand,
+			const std::vector<InstanceData>& instances,
+			const glm::vec4& tint = glm::vec4(1.0f)
+		);
+
+		/**
+		 * Sets how many frames the CPU may record ahead of the GPU, more frames trade latency for throughput
+		 * Throws once the context is initialized (InitializeVulkan or InitializeHeadless).
+		 *
+		 * @param framesInFlight Clamped to [1, MAX_FRAMES_IN_FLIGHT]
+		 */
+		void setFramesInFlight(uint32_t framesInFlight);
+
+		[[nodiscard]] uint32_t getFramesInFlight() const;
+
+		/**
+		 * @return Per-pass GPU timings, results lag getFramesInFlight() frames behind
+		 */
+		[[nodiscard]] GpuProfiler& getGpuProfiler() const;
+
+		/**
+		 * @return Streamer the textures are added to and report their screen size to (valid after initialization)
+		 */
+		[[nodiscard]] TextureStreamer& getTextureStreamer() const;
+
+		/**
+		 * Screen-space size of a bounding sphere with the camera of the last frame, the feedback of requestSize
+		 *
+		 * @param center World space center of the sphere
+		 * @param radius World space radius of the sphere
+		 * @return Diameter on screen in pixels, 0 before the first frame
+		 */
+		[[nodiscard]] float getProjectedSize(const glm::vec3& center, float radius) const;
+
+		/**
+		 * Watches the shaders and rebuilds the pipelines when they change, without stalling the frames
+		 * Only valid after initialization.
+		 */
+		void enableShaderHotReload();
+
+		/**
+		 * Adds geometry that's rewritten at runtime, drawn after the scene with an identity transform
+		 * Only valid after initialization. Its vertices are in the SceneVertexLayout (Vertex::pack builds one).
+		 *
+		 * @param vertexCapacity Most vertices it holds
+		 * @param indexCapacity Most indices it holds
+		 * @return Geometry owned by the context, written by the game code between frames
+		 */
+		DynamicGeometry& createDynamicGeometry(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+		/**
+		 * Adds the GPU particle system, simulated every frame and blended over the scene
+		 * Only valid after initialization, create it before enableShaderHotReload to have its shaders reloaded.
+		 *
+		 * @param capacity Most particles alive at once
+		 * @return Particle system owned by the context, its emitter is set by the game code
+		 */
+		ParticleSystem& createParticleSystem(uint32_t capacity);
+
+		/**
+		 * Picks the present mode of the swapchain, the current one is replaced after the next frame
+		 */
+		void setPresentPolicy(PresentPolicy policy);
+
+		[[nodiscard]] vk::PresentModeKHR getPresentMode() const;
+
+		/**
+		 * @return Whether waitForPresent can wait (VK_KHR_present_id and VK_KHR_present_wait are enabled)
+		 */
+		[[nodiscard]] bool isPresentWaitSupported() const;
+
+		/**
+		 * Blocks until the frame before the last submitted one is on screen, called before reading input
+		 * so the next frame starts just in time instead of queueing behind the display
+		 * Does nothing headless or when present wait isn't supported.
+		 */
+		void waitForPresent();
+
+		[[nodiscard]] FramePacingStats getFramePacingStats() const;
+
+		void resetFramePacingStats();
 
 	private:
 		vk::raii::Context _context;
@@ -87,6 +403,13 @@ namespace Renderer
 
 		vk::raii::Device _device = VK_NULL_HANDLE;
 
+		// Declared right after the device: every Allocation below must be returned before it dies
+		std::unique_ptr<MemoryAllocator> _allocator;
+		std::unique_ptr<UploadQueue> _uploadQueue;
+		std::unique_ptr<RingBuffer> _frameRing;
+		// After the ring: they stage through it
+		std::vector<std::unique_ptr<DynamicGeometry>> _dynamicGeometries;
+
 		vk::raii::SurfaceKHR _surface = VK_NULL_HANDLE;
 
 		vk::raii::Queue _graphics_queue = VK_NULL_HANDLE;
@@ -95,47 +418,144 @@ namespace Renderer
 		uint32_t _graphics_family_index = UINT32_MAX;
 		uint32_t _present_family_index = UINT32_MAX;
 
+		// Falls back to the graphics family when the device has no dedicated transfer family
+		uint32_t _transfer_family_index = UINT32_MAX;
+		uint32_t _transfer_queue_index = 0;
+
 		vk::raii::SwapchainKHR _swapChain = VK_NULL_HANDLE;
 		vk::Extent2D _swapChainExtent;
+
+		// Swapchains replaced by a recreation, oldest first
+		std::deque<RetiredSwapChain> _retiredSwapChains;
+
+		// Suboptimal (or resized): the current swapchain still presents, it's replaced after this frame
+		bool _isSwapChainStale = false;
+
+		PresentPolicy _presentPolicy = PresentPolicy::Mailbox;
+		vk::PresentModeKHR _presentMode = vk::PresentModeKHR::eFifo;
+
+		// Frames are presented with their frame number as present id
+		bool _isPresentWaitSupported = false;
+		// Ids are per swapchain, older ones went to a retired swapchain
+		uint64_t _firstSwapChainPresentId = 1;
+
+		// Headless mode: one offscreen image per frame in flight stands in for the swapchain images
+		bool _isHeadless = false;
+		std::vector<Allocation> _offscreenImageAllocations;
+		std::vector<vk::raii::Image> _offscreenImages;
+
 		std::vector<vk::Image> _swapChainImages;
 		std::vector<vk::raii::ImageView> _swapChainImageViews;
 		vk::Format _swapChainImageFormat = vk::Format::eUndefined;
 
-		vk::raii::DescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+		std::unique_ptr<BindlessTable> _bindlessTable;
+		std::unique_ptr<TextureStreamer> _textureStreamer;
+
+		std::unique_ptr<PipelineCache> _pipelineCache;
+		std::unique_ptr<ShaderLibrary> _shaderLibrary;
 
-		vk::raii::PipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+		// Reflected from the scene shaders, owned by _shaderLibrary
+		vk::PipelineLayout _pipelineLayout;
+		vk::ShaderStageFlags _scenePushConstantStages;
 		vk::raii::Pipeline _graphicsPipeline = VK_NULL_HANDLE;
 
+		// GPU-driven path: the cull pass writes the indirect draws, one drawIndexedIndirectCount draws them
+		bool _isGpuDriven = false;
+		vk::raii::Pipeline _cullPipeline = VK_NULL_HANDLE;
+
+		// Owns pipelines too, declared before the reloader for the same reason
+		std::unique_ptr<ParticleSystem> _particleSystem;
+
+		// Declared after the pipelines it replaces, its thread is joined first
+		std::unique_ptr<ShaderHotReload> _shaderHotReload;
+
 		vk::raii::CommandPool _commandPool = VK_NULL_HANDLE;
 		std::vector<vk::raii::CommandBuffer> _commandBuffers;
 
+		std::unique_ptr<Core::ThreadPool> _threadPool;
+		std::unique_ptr<ParallelCommandRecorder> _commandRecorder;
+
+		std::unique_ptr<GpuProfiler> _gpuProfiler;
+		std::unique_ptr<RenderGraph> _renderGraph;
+
 		std::vector<vk::raii::Semaphore> _presentCompleteSemaphores;
 		std::vector<vk::raii::Semaphore> _renderFinishedSemaphores;
-		std::vector<vk::raii::Fence> _inFlightFences;
+		// Signaled with the frame number when the frame's commands complete
+		vk::raii::Semaphore _frameTimeline = VK_NULL_HANDLE;
 
+		uint32_t _framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
 		uint32_t _currentFrame = 0;
-		uint32_t _semaphoreIndex = 0;
+
+		// Frame being built, frame 0 is everything written during initialization
+		uint64_t _frameNumber = 1;
+
+		FramePacingStats _framePacingStats;
 
 		GLFWwindow* _window = nullptr; // I hate this, but whatever
 
 		bool _frameBufferResized = false;
 
 
+		// Every Allocation is declared before the resource it backs, so the resource dies first
+		Allocation _vertexBufferAllocation;
 		vk::raii::Buffer _vertexBuffer = VK_NULL_HANDLE;
-		vk::raii::DeviceMemory _vertexBufferMemory = VK_NULL_HANDLE;
 
+		Allocation _indexBufferAllocation;
 		vk::raii::Buffer _indexBuffer = VK_NULL_HANDLE;
-		vk::raii::DeviceMemory _indexBufferMemory = VK_NULL_HANDLE;
 
-		std::vector<vk::raii::Buffer> _uniformBuffers;
-		std::vector<vk::raii::DeviceMemory> _uniformBuffersMemory;
-		std::vector<void*> _uniformBuffersMapped;
+		// The uniform data lives in _frameRing, shaders read it at this offset through _frameRingHandle
+		vk::DeviceSize _uniformOffset = 0;
+		// Camera of the last uniform data, the projection is zero until the first frame
+		glm::mat4 _cameraView{1.0f};
+		glm::mat4 _cameraProjection{0.0f};
+		vk::DeviceSize _minUniformAlignment = 256;
 
-		vk::raii::DescriptorPool _descriptorPool = nullptr;
-		std::vector<vk::raii::DescriptorSet> _descriptorSets;
+		BindlessHandle _frameRingHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _objectBufferHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _meshDrawBufferHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _indirectBufferHandle = INVALID_BINDLESS_HANDLE;
+		BindlessHandle _drawCountBufferHandle = INVALID_BINDLESS_HANDLE;
 
 		std::vector<Vertex> _vertices;
-		std::vector<uint16_t> _vertexIndicies;
+		std::vector<uint32_t> _vertexIndicies;
+		// Picked by createIndexBuffer from the indices (or the mesh)
+		vk::IndexType _indexType = vk::IndexType::eUint16;
+
+		std::vector<DrawCommand> _drawCommands;
+		// Cooked bounding sphere of every draw command, empty when they are computed from _vertices
+		std::vector<glm::vec4> _drawBounds;
+		std::vector<ObjectInstance> _objects;
+
+		// Only held until its streams are uploaded
+		std::shared_ptr<const Assets::AssetType::Mesh> _mesh;
+
+		std::vector<InstanceBatch> _instanceBatches;
+		std::vector<InstanceData> _batchInstances;
+
+		// Identity instance after the batch instances, the dynamic geometry is drawn with it
+		uint32_t _dynamicGeometryInstance = 0;
+
+		Allocation _objectBufferAllocation;
+		vk::raii::Buffer _objectBuffer = VK_NULL_HANDLE;
+
+		// Vertex binding 1: one InstanceData per object, then the instances of every batch, then the identity instance
+		Allocation _instanceBufferAllocation;
+		vk::raii::Buffer _instanceBuffer = VK_NULL_HANDLE;
+
+		Allocation _meshDrawBufferAllocation;
+		vk::raii::Buffer _meshDrawBuffer = VK_NULL_HANDLE;
+
+		// One region of objects.size() commands and one counter per frame in flight
+		Allocation _indirectBufferAllocation;
+		vk::raii::Buffer _indirectBuffer = VK_NULL_HANDLE;
+
+		Allocation _drawCountBufferAllocation;
+		vk::raii::Buffer _drawCountBuffer = VK_NULL_HANDLE;
+
+		/**
+		 * Creates every resource, shared by the windowed and the headless mode
+		 */
+		void initialize();
 
 		/**
 		 * Creates Vulkan instance
@@ -168,7 +588,8 @@ namespace Renderer
 		void pickPhysicalDevice();
 
 		/**
-		 * Finds the best queue family (with both present and graphics queue)
+		 * Finds the best queue family (with both present and graphics queue),
+		 * and a transfer-only family for uploads if the device has one
 		 */
 		void findBestQueueFamilyIndexes();
 
@@ -188,6 +609,21 @@ namespace Renderer
 		 */
 		void createQueues();
 
+		/**
+		 * Creates the GPU memory allocator every buffer and image is allocated from
+		 */
+		void createMemoryAllocator();
+
+		/**
+		 * Creates the upload queue, which batches staging copies on the transfer queue
+		 */
+		void createUploadQueue();
+
+		/**
+		 * Creates the persistently mapped ring buffer for per-frame dynamic data
+		 */
+		void createFrameRingBuffer();
+
 		/**
 		 *  This is a helper function
 		 *  Picks the swap surface format for the swap chain
@@ -202,9 +638,13 @@ namespace Renderer
 		 * Picks the present mode
 		 *
 		 * @param presentModes Available present modes
+		 * @param policy Mode asked for
 		 * @return Chosen present mode
 		 */
-		static vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& presentModes);
+		static vk::PresentModeKHR chooseSwapPresentMode(
+			const std::vector<vk::PresentModeKHR>& presentModes,
+			PresentPolicy policy
+		);
 		/**
 		 * This is a helper function
 		 * Returns swap extend in 2 dimension (width, height)
@@ -220,19 +660,61 @@ namespace Renderer
 
 		/**
 		 * Creates swap chain
+		 *
+		 * @param oldSwapChain Swapchain being replaced (its images can still be presenting), or VK_NULL_HANDLE
 		 */
-		void createSwapChain(GLFWwindow* window);
+		void createSwapChain(GLFWwindow* window, vk::SwapchainKHR oldSwapChain);
+
+		/**
+		 * Creates the offscreen images used instead of the swapchain in headless mode
+		 */
+		void createOffscreenTargets();
 
 		/**
 		 * Create image views
 		 */
 		void createImageViews();
 
+		/**
+		 * Loads the pipeline cache from the previous run
+		 */
+		void createPipelineCache();
+
+		/**
+		 * Creates the shader library and the layout shared by the graphics and cull pipelines
+		 */
+		void createPipelineLayout();
+
 		/**
 		 * Creates graphical pipeline
 		 */
 		void createGraphicsPipeline();
 
+		/**
+		 * Creates the frustum culling compute pipeline of the GPU-driven path
+		 */
+		void createCullPipeline();
+
+		/**
+		 * @return Vertex and fragment stage of "shader", compute stage of "cull", from the cached shader assets
+		 */
+		[[nodiscard]] std::vector<ShaderStage> loadSceneStages() const;
+
+		/**
+		 * Layout of the scene stages, throws if it isn't _pipelineLayout (the interface changed since initialization)
+		 */
+		void checkSceneLayout(std::span<const ShaderStage> stages) const;
+
+		/**
+		 * Builds the graphics pipeline from the cached "shader" asset (also used by the shader reload thread)
+		 */
+		[[nodiscard]] vk::raii::Pipeline buildGraphicsPipeline() const;
+
+		/**
+		 * Builds the cull pipeline from the cached "cull" asset (also used by the shader reload thread)
+		 */
+		[[nodiscard]] vk::raii::Pipeline buildCullPipeline() const;
+
 		/**
 		 * Creates command pools
 		 */
@@ -244,40 +726,83 @@ namespace Renderer
 		void createCommandBuffer();
 
 		/**
-		 * Creates sync objects such as: semaphores, and fences (only for now)
+		 * Creates the recording thread pool and its per-thread, per-frame command pools
+		 */
+		void createCommandRecorder();
+
+		/**
+		 * Creates the timestamp query profiler of the graphics queue
+		 */
+		void createGpuProfiler();
+
+		/**
+		 * Creates the render graph the frame is recorded through
+		 */
+		void createRenderGraph();
+
+		/**
+		 * Creates the acquire/present semaphores and the frame timeline semaphore
 		 */
 		void createSyncObjects();
 
+		/**
+		 * Creates the acquire/present semaphores of the current swapchain (one of each per image)
+		 */
+		void createSwapChainSemaphores();
+
+		/**
+		 * Blocks until the frame that last used the current frame slot has completed on the GPU
+		 */
+		void waitForFrameSlot();
+
 		/**
 		 * Records a command buffer (it will be deleted after making decisions)
+		 * Builds the frame's render graph, which places the barriers and layout transitions between the passes.
 		 */
 		void recordCommandBuffer(const vk::raii::CommandBuffer& commandBuffer, uint32_t imageIndex) const;
 
 		/**
-		 *
+		 * Renders the objects into the color target
+		 * Draws are recorded in parallel into secondary command buffers once there are enough of them.
 		 */
-		void transition_image_layout(
-			const uint32_t imageIndex,
-			const vk::ImageLayout oldLayout,
-			const vk::ImageLayout newLayout,
-			const vk::AccessFlags2 srcAccessMask,
-			const vk::AccessFlags2 dstAccessMask,
-			const vk::PipelineStageFlags2 srcStageMask,
-			const vk::PipelineStageFlags2 dstStageMask
-		) const;
+		void recordScene(const vk::raii::CommandBuffer& commandBuffer, vk::ImageView colorTarget) const;
 
 		/**
-		 *
+		 * Binds the pipeline, geometry, descriptors and dynamic state for drawing the scene
+		 */
+		void bindGraphicsState(const vk::raii::CommandBuffer& commandBuffer) const;
+
+		/**
+		 * Binds the graphics state and records the draws [begin, end): objects, instance batches, then dynamic geometry
+		 * It's called from the recording threads, so it must only read the context.
+		 */
+		void recordDraws(const vk::raii::CommandBuffer& commandBuffer, uint32_t begin, uint32_t end) const;
+
+		/**
+		 * Pushes the batch's tint and draws all of its instances
+		 */
+		void recordInstanceBatch(const vk::raii::CommandBuffer& commandBuffer, const InstanceBatch& batch) const;
+
+		/**
+		 * Binds the current slot of the geometry and draws its index range, the scene buffers have to be bound again after
+		 */
+		void recordDynamicGeometry(const vk::raii::CommandBuffer& commandBuffer, const DynamicGeometry& geometry) const;
+
+		/**
+		 * Dispatches the cull pass into this frame's indirect commands (the draw count is reset by its own pass)
+		 */
+		void recordCulling(const vk::raii::CommandBuffer& commandBuffer) const;
+
+		/**
+		 * Replaces the swapchain without waiting for the device: the old one is passed as oldSwapchain
+		 * and retired with its image views and semaphores until the frames that used it are done
 		 */
 		void recreateSwapChain();
 
 		/**
-		 *
-		 * @param typeFilter
-		 * @param properties
-		 * @return
+		 * Destroys the retired swapchains whose last frame has completed
 		 */
-		uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+		void reclaimSwapChains(uint64_t completedFrameNumber);
 
 		/**
 		 *
@@ -298,51 +823,59 @@ namespace Renderer
 		void createIndexBuffer();
 
 		/**
+		 * Creates and uploads the object, instance and mesh draw buffers, and the indirect draw buffers
+		 */
+		void createSceneBuffers();
+
+		/**
+		 * Creates a buffer and binds it to memory sub-allocated from _allocator
 		 *
 		 * @param size
 		 * @param usage
 		 * @param properties
 		 * @param buffer
-		 * @param bufferMemory
+		 * @param allocation
 		 */
 		void createBuffer(
 			vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
 			vk::raii::Buffer& buffer,
-			vk::raii::DeviceMemory& bufferMemory
+			Allocation& allocation
 		) const;
 
 		/**
-		 *
-		 * @param srcBuffer
-		 * @param dstBuffer
-		 * @param size
+		 * Creates the bindless descriptor set every pipeline uses as set 0
 		 */
-		void copyBuffer(vk::raii::Buffer& srcBuffer, vk::raii::Buffer& dstBuffer, vk::DeviceSize size) const;
+		void createBindlessTable();
 
 		/**
-		 *
+		 * Creates the texture streamer, its images are sampled through the bindless table
 		 */
-		void createDescriptorSetLayout();
+		void createTextureStreamer();
 
 		/**
-		 *
+		 * Writes this frame's uniform data into the frame ring
 		 */
-		void createUniformBuffers();
+		void updateUniformBuffer();
 
 		/**
+		 * Uploads data into a device local buffer.
+		 * Staging comes from the frame ring when it fits, from the upload queue's own chunks otherwise.
 		 *
-		 * @param currentImage
+		 * @param data
+		 * @param size
+		 * @param dstBuffer
+		 * @param dstOffset
 		 */
-		void updateUniformBuffer(uint32_t currentImage) const;
+		void uploadBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuffer, vk::DeviceSize dstOffset = 0);
 
 		/**
-		 *
+		 * Adds the frame ring and the scene buffers to the bindless table
 		 */
-		void createDescriptorPool();
+		void registerBindlessResources();
 
 		/**
-		 *
+		 * @return Handles and per-frame offsets pushed before culling and drawing
 		 */
-		void createDescriptorSets();
+		[[nodiscard]] ScenePushConstants makeScenePushConstants() const;
 	};
 }